@@ -168,7 +168,7 @@ namespace m2::ilink
             uint32_t SeqNum,
             const std::string &Text,
             uint64_t SendingTime,
-            uint16_t BusinessRejectRefID,
+            uint64_t BusinessRejectRefID,
             uint32_t RefSeqNum,
             uint16_t TagId,
             uint16_t BusinessRejectReason,
@@ -216,6 +216,11 @@ namespace m2::ilink
             bool AggressorIndicator;
             // for addendum
             uint64_t OrigSideTradeID;
+            // for status
+            uint64_t OrdStatusReqID;
+            uint64_t MassStatusReqID;
+            uint32_t TotNumReports;
+            bool LastRptRequested;
         };
 
         /**
@@ -262,6 +267,121 @@ namespace m2::ilink
         virtual void cancelReject(
             const canc_rej_param_t &param) = 0;
 
+        struct mass_action_report_param_t
+        {
+            uint64_t UUID;
+            uint32_t SeqNum;
+            std::string ExecID;
+            std::string SenderID;
+            uint64_t MassActionReportID;
+            uint64_t TransactTime;
+            uint64_t SendingTime;
+            uint64_t OrderRequestID;
+            uint64_t PartyDetailsListReqID;
+            std::string Location;
+            std::string SecurityGroup;
+            int32_t SecurityID;
+            uint8_t MarketSegmentID;
+            sbe::MassActionScope::Value MassActionScope;
+            sbe::MassActionResponse::Value MassActionResponse;
+            uint8_t MassActionRejectReason;
+            sbe::ManualOrdIndReq::Value ManualOrderIndicator;
+            sbe::SideNULL::Value Side;
+            uint32_t TotalAffectedOrders;
+            bool LastFragment;
+            bool PossRetransFlag;
+        };
+
+        /**
+         * @brief orderMassActionReport
+         * Called once per report. Each order cancelled by the mass action
+         * is then passed to massActionAffectedOrder().
+         * A large mass action may be split into several reports, the last
+         * one has LastFragment set.
+         * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Order+Mass+Action+Report
+         */
+        virtual void orderMassActionReport(
+            const mass_action_report_param_t &param) = 0;
+
+        /**
+         * @brief massActionAffectedOrder
+         * One order cancelled by the mass action identified by MassActionReportID
+         */
+        virtual void massActionAffectedOrder(
+            uint64_t MassActionReportID,
+            const std::string &OrigClOrdID,
+            uint64_t AffectedOrderID,
+            uint32_t CxlQuantity) = 0;
+
+        //
+        // Quote acks carry one entry per quoted instrument. To avoid
+        // allocating on every requote the header and the entries are
+        // passed as plain values with no strings.
+        //
+
+        struct mass_quote_ack_param_t
+        {
+            uint64_t UUID;
+            uint32_t SeqNum;
+            uint32_t QuoteID;
+            uint64_t PartyDetailsListReqID;
+            uint64_t SendingTime;
+            uint64_t RequestTime;
+            sbe::QuoteAckStatus::Value QuoteStatus;
+            uint16_t QuoteRejectReason;
+            uint8_t TotNoQuoteEntries;
+            bool PossRetransFlag;
+        };
+
+        /**
+         * @brief massQuoteAck
+         * Called once per ack, followed by massQuoteAckEntry() for each entry
+         * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Mass+Quote+Acknowledgment
+         */
+        virtual void massQuoteAck(
+            const mass_quote_ack_param_t &param) = 0;
+
+        /**
+         * @brief massQuoteAckEntry
+         * QuoteEntryRejectReason is UINT8_NULL for accepted entries
+         */
+        virtual void massQuoteAckEntry(
+            uint32_t QuoteID,
+            uint32_t QuoteEntryID,
+            int32_t SecurityID,
+            uint16_t QuoteSetID,
+            uint8_t QuoteEntryRejectReason) = 0;
+
+        struct quote_cancel_ack_param_t
+        {
+            uint64_t UUID;
+            uint32_t SeqNum;
+            uint32_t QuoteID;
+            uint64_t PartyDetailsListReqID;
+            uint64_t SendingTime;
+            sbe::QuoteCxlStatus::Value QuoteStatus;
+            uint16_t QuoteRejectReason;
+            uint8_t TotNoQuoteEntries;
+            bool PossRetransFlag;
+        };
+
+        /**
+         * @brief quoteCancelAck
+         * Called once per ack, followed by quoteCancelAckEntry() for each
+         * cancelled instrument and quoteCancelAckSet() for each quote set
+         * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Quote+Cancel+Acknowledgment
+         */
+        virtual void quoteCancelAck(
+            const quote_cancel_ack_param_t &param) = 0;
+
+        virtual void quoteCancelAckEntry(
+            uint32_t QuoteID,
+            int32_t SecurityID) = 0;
+
+        virtual void quoteCancelAckSet(
+            uint32_t QuoteID,
+            uint16_t QuoteSetID) = 0;
+
         /**
          * @brief partyDetailAck
          *
@@ -301,4 +421,41 @@ namespace m2::ilink
             const std::string &Reason) = 0;
         
     };
+
+    /**
+     * @brief CBIF that ignores every message
+     * 
+     * Used by the benchmarks and tools, or as a base when
+     * only a few messages are of interest.
+     * 
+    */
+    struct NullCBIF : CBIF
+    {
+        void sequence(uint32_t, sbe::FTI::Value, sbe::KeepAliveLapsed::Value) override {}
+        void negotiationResponse(uint64_t, uint64_t, sbe::FTI::Value, uint32_t, uint64_t) override {}
+        void negotiationReject(uint64_t, uint64_t, sbe::FTI::Value, uint16_t, const std::string &) override {}
+        void establishementAck(uint64_t, uint64_t, sbe::FTI::Value, uint32_t, uint64_t, uint32_t, uint16_t) override {}
+        void establishmentReject(uint64_t, uint64_t, sbe::FTI::Value, uint32_t, uint16_t, const std::string &) override {}
+        void notApplied(uint64_t, uint32_t, uint32_t) override {}
+        void retransmission(uint64_t, uint64_t, uint64_t, uint32_t, uint32_t) override {}
+        void retransmitReject(uint64_t, uint64_t, uint64_t, uint16_t, const std::string &) override {}
+        void businessReject(uint64_t, uint32_t, const std::string &, uint64_t, uint64_t, uint32_t, uint16_t, uint16_t, const std::string &, bool) override {}
+        void executionReport(const exec_report_param_t &) override {}
+        void cancelReject(const canc_rej_param_t &) override {}
+        void orderMassActionReport(const mass_action_report_param_t &) override {}
+        void massActionAffectedOrder(uint64_t, const std::string &, uint64_t, uint32_t) override {}
+        void massQuoteAck(const mass_quote_ack_param_t &) override {}
+        void massQuoteAckEntry(uint32_t, uint32_t, int32_t, uint16_t, uint8_t) override {}
+        void quoteCancelAck(const quote_cancel_ack_param_t &) override {}
+        void quoteCancelAckEntry(uint32_t, int32_t) override {}
+        void quoteCancelAckSet(uint32_t, uint16_t) override {}
+        void partyDetailAck(uint64_t, uint32_t, uint64_t, uint64_t, uint8_t, bool,
+                            const std::vector<std::string> &,
+                            const std::vector<std::string> &,
+                            const std::vector<sbe::PartyDetailRole::Value> &) override {}
+        void partyDetailReport(uint64_t, uint32_t, uint64_t, uint64_t,
+                               const std::vector<std::string> &,
+                               const std::vector<std::string> &) override {}
+        void terminate(uint64_t, uint16_t, const std::string &) override {}
+    };
 }
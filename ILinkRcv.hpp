@@ -39,6 +39,9 @@ https://opensource.org/licenses/MIT
 #pragma once
 
 #include <assert.h>
+#include <string.h>
+
+#include <array>
 
 #include "ilink_v8/NegotiationResponse501.h"
 #include "ilink_v8/NegotiationReject502.h"
@@ -64,6 +67,9 @@ https://opensource.org/licenses/MIT
 #include "ilink_v8/OrderCancelReject535.h"
 #include "ilink_v8/OrderCancelReplaceReject536.h"
 #include "ilink_v8/ExecutionReportReject523.h"
+#include "ilink_v8/OrderMassActionReport562.h"
+#include "ilink_v8/MassQuoteAck545.h"
+#include "ilink_v8/QuoteCancelAck563.h"
 #include "ilink_v8/Terminate507.h"
 #include "ilink_v8/PartyDetailsDefinitionRequestAck519.h"
 #include "ilink_v8/PartyDetailsListReport538.h"
@@ -71,25 +77,216 @@ https://opensource.org/licenses/MIT
 
 #include "ILinkCBIF.hpp"
 #include "sock_help.hpp"
+#include "latency.hpp"
+#include "capture.hpp"
+
+/***************************************************************
+ *
+ * Decode policies
+ *
+ * DefaultDecode trusts the SBE flyweights: wrapForDecode and the group
+ * and var data accessors check every access against MsgSize, and
+ * debug printing is decided per message.
+ *
+ * TrustedDecode checks each frame once up front against FRAME_SPECS,
+ * a compile time table of SchemaID, Version, BlockLength and repeating
+ * group layout per template (validate_frame()). Frames that fail are
+ * reported and dropped. Debug printing is compiled out.
+ *
+ * The per access checks in the generated code are removed by building
+ * with -DSBE_NO_BOUNDS_CHECK (before any SBE header is included). Do
+ * that only where every frame goes through TrustedDecode, or comes
+ * from this library (inproc, replay of a validated capture):
+ *
+ *   g++ -O3 -DSBE_NO_BOUNDS_CHECK ...
+ *   receiver::process_message<receiver::TrustedDecode>(header, msg_buf, cbif);
+ *   receiver::process_message_from_msgw<Transport, receiver::TrustedDecode>(...);
+ *
+ * DefaultDecode validates frames too when built with SBE_NO_BOUNDS_CHECK.
+ *
+ * *************************************************************/
 
 namespace m2::ilink::receiver
 {
+#ifdef SBE_NO_BOUNDS_CHECK
+    static constexpr bool SBE_BOUNDS_CHECKED = false;
+#else
+    static constexpr bool SBE_BOUNDS_CHECKED = true;
+#endif
 
+    struct DefaultDecode
+    {
+        static constexpr bool validate = !SBE_BOUNDS_CHECKED;
+        static constexpr bool debug = true;
+    };
+
+    struct TrustedDecode
+    {
+        static constexpr bool validate = true;
+        static constexpr bool debug = false;
+    };
 
     /**
-     * @brief process message from msgw if available
+     * @brief what a received template must look like
+     */
+    struct frame_spec_t
+    {
+        bool known;
+        uint16_t BlockLength; // at least
+        uint16_t SchemaID;
+        uint16_t Version; // at least
+        uint8_t groups;   // repeating groups the decoder reads, in order
+        uint8_t group_header_size;
+        uint16_t group_block_length[2];
+    };
+
+    static constexpr uint16_t FIRST_TEMPLATE_ID = 500;
+    static constexpr size_t TEMPLATE_ID_RANGE = 64;
+
+    template <typename M>
+    static constexpr frame_spec_t fixed_spec() noexcept
+    {
+        return {true, M::sbeBlockLength(), M::sbeSchemaId(), M::sbeSchemaVersion(), 0, 0, {0, 0}};
+    }
+
+    template <typename M, typename G>
+    static constexpr frame_spec_t group_spec() noexcept
+    {
+        auto s = fixed_spec<M>();
+        s.groups = 1;
+        s.group_header_size = uint8_t(G::sbeHeaderSize());
+        s.group_block_length[0] = G::sbeBlockLength();
+        return s;
+    }
+
+    template <typename M, typename G1, typename G2>
+    static constexpr frame_spec_t group_spec() noexcept
+    {
+        auto s = group_spec<M, G1>();
+        static_assert(G1::sbeHeaderSize() == G2::sbeHeaderSize());
+        s.groups = 2;
+        s.group_block_length[1] = G2::sbeBlockLength();
+        return s;
+    }
+
+    static constexpr std::array<frame_spec_t, TEMPLATE_ID_RANGE> make_frame_specs() noexcept
+    {
+        std::array<frame_spec_t, TEMPLATE_ID_RANGE> t{};
+        auto set = [&t](uint16_t id, frame_spec_t s)
+        { t[id - FIRST_TEMPLATE_ID] = s; };
+
+        set(sbe::NegotiationResponse501::sbeTemplateId(), fixed_spec<sbe::NegotiationResponse501>());
+        set(sbe::NegotiationReject502::sbeTemplateId(), fixed_spec<sbe::NegotiationReject502>());
+        set(sbe::EstablishmentAck504::sbeTemplateId(), fixed_spec<sbe::EstablishmentAck504>());
+        set(sbe::EstablishmentReject505::sbeTemplateId(), fixed_spec<sbe::EstablishmentReject505>());
+        set(sbe::Sequence506::sbeTemplateId(), fixed_spec<sbe::Sequence506>());
+        set(sbe::Terminate507::sbeTemplateId(), fixed_spec<sbe::Terminate507>());
+        set(sbe::Retransmission509::sbeTemplateId(), fixed_spec<sbe::Retransmission509>());
+        set(sbe::RetransmitReject510::sbeTemplateId(), fixed_spec<sbe::RetransmitReject510>());
+        set(sbe::NotApplied513::sbeTemplateId(), fixed_spec<sbe::NotApplied513>());
+        set(sbe::PartyDetailsDefinitionRequestAck519::sbeTemplateId(),
+            group_spec<sbe::PartyDetailsDefinitionRequestAck519, sbe::PartyDetailsDefinitionRequestAck519::NoPartyDetails>());
+        set(sbe::BusinessReject521::sbeTemplateId(), fixed_spec<sbe::BusinessReject521>());
+        set(sbe::ExecutionReportNew522::sbeTemplateId(), fixed_spec<sbe::ExecutionReportNew522>());
+        set(sbe::ExecutionReportReject523::sbeTemplateId(), fixed_spec<sbe::ExecutionReportReject523>());
+        set(sbe::ExecutionReportElimination524::sbeTemplateId(), fixed_spec<sbe::ExecutionReportElimination524>());
+        set(sbe::ExecutionReportTradeOutright525::sbeTemplateId(), fixed_spec<sbe::ExecutionReportTradeOutright525>());
+        set(sbe::ExecutionReportTradeSpread526::sbeTemplateId(), fixed_spec<sbe::ExecutionReportTradeSpread526>());
+        set(sbe::ExecutionReportTradeSpreadLeg527::sbeTemplateId(), fixed_spec<sbe::ExecutionReportTradeSpreadLeg527>());
+        set(sbe::ExecutionReportModify531::sbeTemplateId(), fixed_spec<sbe::ExecutionReportModify531>());
+        set(sbe::ExecutionReportStatus532::sbeTemplateId(), fixed_spec<sbe::ExecutionReportStatus532>());
+        set(sbe::ExecutionReportCancel534::sbeTemplateId(), fixed_spec<sbe::ExecutionReportCancel534>());
+        set(sbe::OrderCancelReject535::sbeTemplateId(), fixed_spec<sbe::OrderCancelReject535>());
+        set(sbe::OrderCancelReplaceReject536::sbeTemplateId(), fixed_spec<sbe::OrderCancelReplaceReject536>());
+        set(sbe::PartyDetailsListReport538::sbeTemplateId(),
+            group_spec<sbe::PartyDetailsListReport538, sbe::PartyDetailsListReport538::NoPartyDetails>());
+        set(sbe::MassQuoteAck545::sbeTemplateId(),
+            group_spec<sbe::MassQuoteAck545, sbe::MassQuoteAck545::NoQuoteEntries>());
+        set(sbe::ExecutionReportTradeAddendumOutright548::sbeTemplateId(), fixed_spec<sbe::ExecutionReportTradeAddendumOutright548>());
+        set(sbe::ExecutionReportTradeAddendumSpread549::sbeTemplateId(), fixed_spec<sbe::ExecutionReportTradeAddendumSpread549>());
+        set(sbe::OrderMassActionReport562::sbeTemplateId(),
+            group_spec<sbe::OrderMassActionReport562, sbe::OrderMassActionReport562::NoAffectedOrders>());
+        set(sbe::QuoteCancelAck563::sbeTemplateId(),
+            group_spec<sbe::QuoteCancelAck563, sbe::QuoteCancelAck563::NoQuoteEntries, sbe::QuoteCancelAck563::NoQuoteSets>());
+        return t;
+    }
+
+    static constexpr auto FRAME_SPECS = make_frame_specs();
+
+    /**
+     * @brief check a received frame against FRAME_SPECS, so it can be
+     * decoded without further bounds checks
+     *
+     * The body (msg_buf) must hold MsgSize - SOFH_AND_SBE_HEADER_SIZE bytes.
+     */
+    static bool validate_frame(const sockhelp::cme_msg_header_t *header, const char *msg_buf) noexcept
+    {
+        auto index = size_t(header->TemplateID) - FIRST_TEMPLATE_ID;
+        if (header->TemplateID < FIRST_TEMPLATE_ID || index >= TEMPLATE_ID_RANGE)
+            return false;
+        const auto &spec = FRAME_SPECS[index];
+        if (!spec.known ||
+            header->SchemaID != spec.SchemaID ||
+            header->Version < spec.Version ||
+            header->BlockLength < spec.BlockLength ||
+            header->MsgSize < sockhelp::SOFH_AND_SBE_HEADER_SIZE + header->BlockLength)
+            return false;
+
+        size_t body = header->MsgSize - sockhelp::SOFH_AND_SBE_HEADER_SIZE;
+        size_t pos = header->BlockLength;
+        for (uint8_t g = 0; g < spec.groups; ++g)
+        {
+            // groupSize: blockLength uint16, numInGroup uint8 (uint16 in a 4 byte header)
+            if (pos + spec.group_header_size > body)
+                return false;
+            uint16_t block_length;
+            memcpy(&block_length, msg_buf + pos, sizeof block_length);
+            size_t count = uint8_t(msg_buf[pos + 2]);
+            if (spec.group_header_size > 3)
+            {
+                uint16_t count16;
+                memcpy(&count16, msg_buf + pos + 2, sizeof count16);
+                count = count16;
+            }
+            if (block_length < spec.group_block_length[g])
+                return false;
+            pos += spec.group_header_size + size_t(block_length) * count;
+            if (pos > body)
+                return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief decode a message already received into msg_buf
      * call message handler
      *
+     * Policy is DefaultDecode or TrustedDecode, see above.
+     *
      */
-    static bool process_message_from_msgw(int sock, char *msg_buf, CBIF *cbif, bool block = true, bool debug = false) noexcept
+    template <typename Policy = DefaultDecode>
+    static void process_message(const sockhelp::cme_msg_header_t *header, char *msg_buf, CBIF *cbif, bool debug = false, latency::Stats *stats = nullptr) noexcept
     {
-        auto header = sockhelp::recv_message(sock, msg_buf, block);
-        if (!header)
+        ILINK_LATENCY_DECL(t_received);
+        ILINK_LATENCY_DECL(t_decoded);
+
+        if constexpr (Policy::validate)
         {
-            return false;
+            if (!validate_frame(header, msg_buf))
+            {
+                std::cerr << "*** Invalid frame, template id: " << header->TemplateID
+                          << " size: " << header->MsgSize
+                          << " block: " << header->BlockLength
+                          << " schema: " << header->SchemaID
+                          << " version: " << header->Version << std::endl;
+                return;
+            }
         }
 
-        if (debug)
+        // constant false without Policy::debug, the printing is compiled out
+        const bool print = Policy::debug && debug;
+
+        if (print)
         {
             std::cerr << "Received message: " << header->TemplateID << std::endl;
         }
@@ -105,7 +302,7 @@ namespace m2::ilink::receiver
         {
             sbe::Sequence506 sequence;
             auto msg = sequence.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -113,6 +310,7 @@ namespace m2::ilink::receiver
             auto NextSeqNo = msg.nextSeqNo();
             auto FaultToleranceIndicator = msg.faultToleranceIndicator();
             auto KeepAliveIntervalLapsed = msg.keepAliveIntervalLapsed();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->sequence(NextSeqNo, FaultToleranceIndicator, KeepAliveIntervalLapsed);
             break;
         }
@@ -121,7 +319,7 @@ namespace m2::ilink::receiver
         {
             sbe::NegotiationResponse501 negotiateResponse;
             auto msg = negotiateResponse.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -131,6 +329,7 @@ namespace m2::ilink::receiver
             auto FaultToleranceIndicator = msg.faultToleranceIndicator();
             auto PreviousSeqNo = msg.previousSeqNo();
             auto PreviousUUID = msg.previousUUID();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->negotiationResponse(RequestTimeStamp, UUID, FaultToleranceIndicator, PreviousSeqNo, PreviousUUID);
             break;
         }
@@ -139,7 +338,7 @@ namespace m2::ilink::receiver
         {
             sbe::NegotiationReject502 negotiateReject;
             auto msg = negotiateReject.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -149,6 +348,7 @@ namespace m2::ilink::receiver
             auto UUID = msg.uUID();
             auto errorCodes = msg.errorCodes();
             auto FaultToleranceIndicator = msg.faultToleranceIndicator();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->negotiationReject(RequestTimeStamp, UUID, FaultToleranceIndicator, errorCodes, Reason);
             break;
         }
@@ -157,7 +357,7 @@ namespace m2::ilink::receiver
         {
             sbe::EstablishmentAck504 establishmentAck;
             auto msg = establishmentAck.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -169,6 +369,7 @@ namespace m2::ilink::receiver
             auto FaultToleranceIndicator = msg.faultToleranceIndicator();
             auto PreviousSeqNo = msg.previousSeqNo();
             auto PreviousUUID = msg.previousUUID();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->establishementAck(RequestTimeStamp, UUID, FaultToleranceIndicator, PreviousSeqNo, PreviousUUID, NextSeqNo, KeepAliveInterval);
             break;
         }
@@ -177,7 +378,7 @@ namespace m2::ilink::receiver
         {
             sbe::EstablishmentReject505 establishmentReject;
             auto msg = establishmentReject.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -188,6 +389,7 @@ namespace m2::ilink::receiver
             auto NextSeqNo = msg.nextSeqNo();
             auto errorCodes = msg.errorCodes();
             auto FaultToleranceIndicator = msg.faultToleranceIndicator();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->establishmentReject(
                 RequestTimeStamp,
                 UUID,
@@ -202,7 +404,7 @@ namespace m2::ilink::receiver
         {
             sbe::NotApplied513 notApplied;
             auto msg = notApplied.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -210,6 +412,7 @@ namespace m2::ilink::receiver
             auto UUID = msg.uUID();
             auto FromSeqNo = msg.fromSeqNo();
             auto MsgCount = msg.msgCount();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->notApplied(UUID, FromSeqNo, MsgCount);
             break;
         }
@@ -218,7 +421,7 @@ namespace m2::ilink::receiver
         {
             sbe::Retransmission509 retransmission;
             auto msg = retransmission.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -228,6 +431,7 @@ namespace m2::ilink::receiver
             auto RequestTimestamp = msg.requestTimestamp();
             auto FromSeqNo = msg.fromSeqNo();
             auto MsgCount = msg.msgCount();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->retransmission(UUID, LastUUID, RequestTimestamp, FromSeqNo, MsgCount);
             break;
         }
@@ -236,7 +440,7 @@ namespace m2::ilink::receiver
         {
             sbe::RetransmitReject510 retransmitReject;
             auto msg = retransmitReject.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -246,6 +450,7 @@ namespace m2::ilink::receiver
             auto LastUUID = msg.lastUUID();
             auto RequestTimestamp = msg.requestTimestamp();
             auto ErrorCodes = msg.errorCodes();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->retransmitReject(UUID, LastUUID, RequestTimestamp, ErrorCodes, Reason);
             break;
         }
@@ -258,7 +463,7 @@ namespace m2::ilink::receiver
         {
             sbe::BusinessReject521 businessReject;
             auto msg = businessReject.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -273,6 +478,7 @@ namespace m2::ilink::receiver
             auto BusinessRejectReason = msg.businessRejectReason();
             auto RefMsgType = msg.getRefMsgTypeAsString();
             auto PossRetransFlag = msg.possRetransFlag();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->businessReject(UUID, SeqNum, Text, SendingTime, BusinessRejectRefID, RefSeqNum, TagId, BusinessRejectReason, RefMsgType, PossRetransFlag);
             break;
         }
@@ -282,7 +488,7 @@ namespace m2::ilink::receiver
             sbe::ExecutionReportNew522 executionReportNew;
             CBIF::exec_report_param_t param;
             auto msg = executionReportNew.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -313,6 +519,7 @@ namespace m2::ilink::receiver
             param.PossRetransFlag = msg.possRetransFlag();
             param.OrdStatus = msg.getOrdStatusAsString();
             param.ExecType = msg.getExecTypeAsString();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->executionReport(param);
             break;
         }
@@ -322,7 +529,7 @@ namespace m2::ilink::receiver
             sbe::ExecutionReportModify531 executionReportModify;
             CBIF::exec_report_param_t param;
             auto msg = executionReportModify.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -355,6 +562,7 @@ namespace m2::ilink::receiver
             param.PossRetransFlag = msg.possRetransFlag();
             param.OrdStatus = msg.getOrdStatusAsString();
             param.ExecType = msg.getExecTypeAsString();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->executionReport(param);
             break;
         }
@@ -364,7 +572,7 @@ namespace m2::ilink::receiver
             sbe::ExecutionReportCancel534 executionReportCancel;
             CBIF::exec_report_param_t param;
             auto msg = executionReportCancel.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -396,6 +604,7 @@ namespace m2::ilink::receiver
             param.PossRetransFlag = msg.possRetransFlag();
             param.OrdStatus = msg.getOrdStatusAsString();
             param.ExecType = msg.getExecTypeAsString();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->executionReport(param);
             break;
         }
@@ -405,7 +614,7 @@ namespace m2::ilink::receiver
             sbe::ExecutionReportStatus532 executionReportStatus;
             CBIF::exec_report_param_t param;
             auto msg = executionReportStatus.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -436,7 +645,13 @@ namespace m2::ilink::receiver
             param.TimeInForce = msg.timeInForce();
             param.ManualOrderIndicator = msg.manualOrderIndicator();
             param.PossRetransFlag = msg.possRetransFlag();
+            param.OrdStatus = std::string(1, (char)msg.ordStatus());
             param.ExecType = msg.getExecTypeAsString();
+            param.OrdStatusReqID = msg.ordStatusReqID();
+            param.MassStatusReqID = msg.massStatusReqID();
+            param.TotNumReports = msg.totNumReports();
+            param.LastRptRequested = msg.lastRptRequested() == sbe::BooleanNULL::True;
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->executionReport(param);
             break;
         }
@@ -446,7 +661,7 @@ namespace m2::ilink::receiver
             sbe::ExecutionReportTradeOutright525 executionReportTradeOutright;
             CBIF::exec_report_param_t param;
             auto msg = executionReportTradeOutright.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -481,6 +696,7 @@ namespace m2::ilink::receiver
             param.lastPx_mantissa = msg.lastPx().mantissa();
             param.lastPx_exponent = msg.lastPx().exponent();
             param.SideTradeID = msg.sideTradeID();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->executionReport(param);
 
             break;
@@ -491,7 +707,7 @@ namespace m2::ilink::receiver
             sbe::ExecutionReportTradeSpread526 executionReportTradeSpread;
             CBIF::exec_report_param_t param;
             auto msg = executionReportTradeSpread.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -514,6 +730,7 @@ namespace m2::ilink::receiver
             param.Location = msg.getLocationAsString();
             param.SecurityID = msg.securityID();
             param.OrderQty = msg.orderQty();
+            param.LastQty = msg.lastQty();
             param.CumQty = msg.cumQty();
             param.LeavesQty = msg.leavesQty();
             param.OrdType = msg.ordType();
@@ -525,14 +742,44 @@ namespace m2::ilink::receiver
             param.lastPx_mantissa = msg.lastPx().mantissa();
             param.lastPx_exponent = msg.lastPx().exponent();
             param.SideTradeID = msg.sideTradeID();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->executionReport(param);
             break;
         }
 
         case sbe::ExecutionReportTradeSpreadLeg527::sbeTemplateId():
         {
-            std::cerr << "ExecutionReportTradeSpreadLeg527 not implemented" << std::endl;
-            assert(false);
+            sbe::ExecutionReportTradeSpreadLeg527 executionReportTradeSpreadLeg;
+            CBIF::exec_report_param_t param;
+            auto msg = executionReportTradeSpreadLeg.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            if (print)
+            {
+                std::cerr << "msg: " << msg << std::endl;
+            }
+
+            // one leg of a spread fill, SecurityID is the leg instrument
+            param.templateId = sbe::ExecutionReportTradeSpreadLeg527::sbeTemplateId();
+            param.UUID = msg.uUID();
+            param.SeqNum = msg.seqNum();
+            param.ExecID = msg.getExecIDAsString();
+            param.SenderID = msg.getSenderIDAsString();
+            param.ClOrdID = msg.getClOrdIDAsString();
+            param.PartyDetailsListReqID = msg.partyDetailsListReqID();
+            param.OrderID = msg.orderID();
+            param.TransactTime = msg.transactTime();
+            param.SendingTime = msg.sendingTimeEpoch();
+            param.Location = msg.getLocationAsString();
+            param.SecurityID = msg.securityID();
+            param.LastQty = msg.lastQty();
+            param.Side = msg.side();
+            param.PossRetransFlag = msg.possRetransFlag();
+            param.ExecType = msg.getExecTypeAsString();
+            param.lastPx_mantissa = msg.lastPx().mantissa();
+            param.lastPx_exponent = msg.lastPx().exponent();
+            param.SideTradeID = msg.sideTradeID();
+            ILINK_LATENCY_MARK(t_decoded);
+            cbif->executionReport(param);
+            break;
         }
 
         case sbe::ExecutionReportElimination524::sbeTemplateId():
@@ -540,7 +787,7 @@ namespace m2::ilink::receiver
             sbe::ExecutionReportElimination524 executionReportElimination;
             CBIF::exec_report_param_t param;
             auto msg = executionReportElimination.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -575,6 +822,7 @@ namespace m2::ilink::receiver
             param.lastPx_mantissa = 0;
             param.lastPx_exponent = 0;
             param.SideTradeID = 0;
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->executionReport(param);
             break;
         }
@@ -584,7 +832,7 @@ namespace m2::ilink::receiver
             sbe::ExecutionReportReject523 executionReportReject;
             CBIF::exec_report_param_t param;
             auto msg = executionReportReject.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -615,6 +863,7 @@ namespace m2::ilink::receiver
             param.PossRetransFlag = msg.possRetransFlag();
             param.OrdStatus = msg.getOrdStatusAsString();
             param.ExecType = msg.getExecTypeAsString();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->executionReport(param);
             break;
         }
@@ -624,7 +873,7 @@ namespace m2::ilink::receiver
             sbe::ExecutionReportTradeAddendumOutright548 executionReportTradeAddendumOutright;
             CBIF::exec_report_param_t param;
             auto msg = executionReportTradeAddendumOutright.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -642,13 +891,16 @@ namespace m2::ilink::receiver
             param.OrderRequestID = 0;
             param.Location = msg.getLocationAsString();
             param.SecurityID = msg.securityID();
+            param.LastQty = msg.lastQty();
             param.Side = msg.side();
             param.ManualOrderIndicator = msg.manualOrderIndicator();
             param.PossRetransFlag = msg.possRetransFlag();
+            param.ExecType = std::string(1, (char)msg.execType());
             param.lastPx_mantissa = msg.lastPx().mantissa();
             param.lastPx_exponent = msg.lastPx().exponent();
             param.SideTradeID = msg.sideTradeID();
             param.OrigSideTradeID = msg.origSideTradeID();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->executionReport(param);
             break;
         }
@@ -658,7 +910,7 @@ namespace m2::ilink::receiver
             sbe::ExecutionReportTradeAddendumSpread549 executionReportTradeAddendumSpread;
             CBIF::exec_report_param_t param;
             auto msg = executionReportTradeAddendumSpread.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -675,14 +927,17 @@ namespace m2::ilink::receiver
             param.SendingTime = msg.sendingTimeEpoch();
             param.Location = msg.getLocationAsString();
             param.SecurityID = msg.securityID();
+            param.LastQty = msg.lastQty();
             param.OrdType = msg.ordType();
             param.Side = msg.side();
             param.ManualOrderIndicator = msg.manualOrderIndicator();
             param.PossRetransFlag = msg.possRetransFlag();
+            param.ExecType = std::string(1, (char)msg.execType());
             param.lastPx_mantissa = msg.lastPx().mantissa();
             param.lastPx_exponent = msg.lastPx().exponent();
             param.SideTradeID = msg.sideTradeID();
             param.OrigSideTradeID = msg.origSideTradeID();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->executionReport(param);
             break;
         }
@@ -692,7 +947,7 @@ namespace m2::ilink::receiver
             sbe::OrderCancelReject535 orderCancelReject;
             CBIF::canc_rej_param_t param;
             auto msg = orderCancelReject.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -714,6 +969,7 @@ namespace m2::ilink::receiver
             param.OrdStatus = msg.getOrdStatusAsString();
             param.CxlRejResponseTo = msg.getCxlRejResponseToAsString();
             param.CxlRejReason = msg.cxlRejReason();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->cancelReject(param);
             break;
         }
@@ -723,7 +979,7 @@ namespace m2::ilink::receiver
             sbe::OrderCancelReplaceReject536 orderCancelReplaceReject;
             CBIF::canc_rej_param_t param;
             auto msg = orderCancelReplaceReject.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -743,15 +999,136 @@ namespace m2::ilink::receiver
             param.ManualOrderIndicator = msg.manualOrderIndicator();
             param.PossRetransFlag = msg.possRetransFlag();
             param.OrdStatus = msg.getOrdStatusAsString();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->cancelReject(param);
             break;
         }
 
+        case sbe::OrderMassActionReport562::sbeTemplateId():
+        {
+            sbe::OrderMassActionReport562 orderMassActionReport;
+            CBIF::mass_action_report_param_t param;
+            auto msg = orderMassActionReport.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            if (print)
+            {
+                std::cerr << "msg: " << msg << std::endl;
+            }
+
+            param.UUID = msg.uUID();
+            param.SeqNum = msg.seqNum();
+            param.ExecID = msg.getExecIDAsString();
+            param.SenderID = msg.getSenderIDAsString();
+            param.MassActionReportID = msg.massActionReportID();
+            param.TransactTime = msg.transactTime();
+            param.SendingTime = msg.sendingTimeEpoch();
+            param.OrderRequestID = msg.orderRequestID();
+            param.PartyDetailsListReqID = msg.partyDetailsListReqID();
+            param.Location = msg.getLocationAsString();
+            param.SecurityGroup = msg.getSecurityGroupAsString();
+            param.SecurityID = msg.securityID();
+            param.MarketSegmentID = msg.marketSegmentID();
+            param.MassActionScope = msg.massActionScope();
+            param.MassActionResponse = msg.massActionResponse();
+            param.MassActionRejectReason = msg.massActionRejectReason();
+            param.ManualOrderIndicator = msg.manualOrderIndicator();
+            param.Side = msg.side();
+            param.TotalAffectedOrders = msg.totalAffectedOrders();
+            param.LastFragment = msg.lastFragment();
+            param.PossRetransFlag = msg.possRetransFlag();
+            ILINK_LATENCY_MARK(t_decoded);
+            cbif->orderMassActionReport(param);
+
+            auto noAffectedOrders = msg.noAffectedOrders();
+            while (noAffectedOrders.hasNext())
+            {
+                noAffectedOrders.next();
+                auto OrigClOrdID = noAffectedOrders.getOrigCIOrdIDAsString();
+                auto AffectedOrderID = noAffectedOrders.affectedOrderID();
+                auto CxlQuantity = noAffectedOrders.cxlQuantity();
+                cbif->massActionAffectedOrder(param.MassActionReportID, OrigClOrdID, AffectedOrderID, CxlQuantity);
+            }
+            break;
+        }
+
+        case sbe::MassQuoteAck545::sbeTemplateId():
+        {
+            sbe::MassQuoteAck545 massQuoteAck;
+            CBIF::mass_quote_ack_param_t param;
+            auto msg = massQuoteAck.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            if (print)
+            {
+                std::cerr << "msg: " << msg << std::endl;
+            }
+
+            param.UUID = msg.uUID();
+            param.SeqNum = msg.seqNum();
+            param.QuoteID = msg.quoteID();
+            param.PartyDetailsListReqID = msg.partyDetailsListReqID();
+            param.SendingTime = msg.sendingTimeEpoch();
+            param.RequestTime = msg.requestTime();
+            param.QuoteStatus = msg.quoteStatus();
+            param.QuoteRejectReason = msg.quoteRejectReason();
+            param.TotNoQuoteEntries = msg.totNoQuoteEntries();
+            param.PossRetransFlag = msg.possRetransFlag();
+            ILINK_LATENCY_MARK(t_decoded);
+            cbif->massQuoteAck(param);
+
+            auto noQuoteEntries = msg.noQuoteEntries();
+            while (noQuoteEntries.hasNext())
+            {
+                noQuoteEntries.next();
+                cbif->massQuoteAckEntry(
+                    param.QuoteID,
+                    noQuoteEntries.quoteEntryID(),
+                    noQuoteEntries.securityID(),
+                    noQuoteEntries.quoteSetID(),
+                    noQuoteEntries.quoteEntryRejectReason());
+            }
+            break;
+        }
+
+        case sbe::QuoteCancelAck563::sbeTemplateId():
+        {
+            sbe::QuoteCancelAck563 quoteCancelAck;
+            CBIF::quote_cancel_ack_param_t param;
+            auto msg = quoteCancelAck.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            if (print)
+            {
+                std::cerr << "msg: " << msg << std::endl;
+            }
+
+            param.UUID = msg.uUID();
+            param.SeqNum = msg.seqNum();
+            param.QuoteID = msg.quoteID();
+            param.PartyDetailsListReqID = msg.partyDetailsListReqID();
+            param.SendingTime = msg.sendingTimeEpoch();
+            param.QuoteStatus = msg.quoteStatus();
+            param.QuoteRejectReason = msg.quoteRejectReason();
+            param.TotNoQuoteEntries = msg.totNoQuoteEntries();
+            param.PossRetransFlag = msg.possRetransFlag();
+            ILINK_LATENCY_MARK(t_decoded);
+            cbif->quoteCancelAck(param);
+
+            auto noQuoteEntries = msg.noQuoteEntries();
+            while (noQuoteEntries.hasNext())
+            {
+                noQuoteEntries.next();
+                cbif->quoteCancelAckEntry(param.QuoteID, noQuoteEntries.securityID());
+            }
+            auto noQuoteSets = msg.noQuoteSets();
+            while (noQuoteSets.hasNext())
+            {
+                noQuoteSets.next();
+                cbif->quoteCancelAckSet(param.QuoteID, noQuoteSets.quoteSetID());
+            }
+            break;
+        }
+
         case sbe::Terminate507::sbeTemplateId():
         {
             sbe::Terminate507 terminate;
             auto msg = terminate.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -759,6 +1136,7 @@ namespace m2::ilink::receiver
             auto UUID = msg.uUID();
             auto err = msg.errorCodes();
             auto reason = msg.getReasonAsString();
+            ILINK_LATENCY_MARK(t_decoded);
             cbif->terminate(UUID, err, reason);
             break;
         }
@@ -767,7 +1145,7 @@ namespace m2::ilink::receiver
         {
             sbe::PartyDetailsDefinitionRequestAck519 partyDetailsDefinitionRequestAck;
             auto msg = partyDetailsDefinitionRequestAck.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -791,7 +1169,8 @@ namespace m2::ilink::receiver
                 partyDetailSource.push_back(partyDetailSource_);
                 partyDetailRole.push_back(partyDetailRole_);
             }
-            cbif->partyDetailAck(SeqNum, UUID, PartyDetailsListReqID, SendingTime, PartyRequestStatus, PossRetransFlag, partyDetailID, partyDetailSource, partyDetailRole);
+            ILINK_LATENCY_MARK(t_decoded);
+            cbif->partyDetailAck(UUID, SeqNum, PartyDetailsListReqID, SendingTime, PartyRequestStatus, PossRetransFlag, partyDetailID, partyDetailSource, partyDetailRole);
             break;
         }
 
@@ -799,7 +1178,7 @@ namespace m2::ilink::receiver
         {
             sbe::PartyDetailsListReport538 partyDetailsListReport;
             auto msg = partyDetailsListReport.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
-            if (debug)
+            if (print)
             {
                 std::cerr << "msg: " << msg << std::endl;
             }
@@ -818,7 +1197,8 @@ namespace m2::ilink::receiver
                 partyDetailID.push_back(partyDetailID_);
                 partyDetailSource.push_back(partyDetailSource_);
             }
-            cbif->partyDetailReport(SeqNum, UUID, PartyDetailsListReqID, SendingTime, partyDetailID, partyDetailSource);
+            ILINK_LATENCY_MARK(t_decoded);
+            cbif->partyDetailReport(UUID, SeqNum, PartyDetailsListReqID, SendingTime, partyDetailID, partyDetailSource);
             break;
         }
 
@@ -829,6 +1209,37 @@ namespace m2::ilink::receiver
 
         }
 
+        ILINK_LATENCY_DECL(t_handled);
+        ILINK_LATENCY_RECORD(stats, latency::Decode, t_received, t_decoded);
+        ILINK_LATENCY_RECORD(stats, latency::Handler, t_decoded, t_handled);
+    }
+
+    /**
+     * @brief process message from msgw if available
+     * call message handler
+     *
+     * Transport is the I/O policy the message is read with,
+     * sockhelp::SocketTransport (a TCP socket) by default.
+     * Policy is the decode policy passed to process_message.
+     *
+     */
+    template <typename Transport = sockhelp::SocketTransport, typename Policy = DefaultDecode>
+    static bool process_message_from_msgw(typename Transport::handle_t sock, char *msg_buf, CBIF *cbif, bool block = true, bool debug = false, latency::Stats *stats = nullptr, capture::Writer *capture = nullptr) noexcept
+    {
+        static_assert(sockhelp::is_recv_transport<Transport>::value,
+                      "Transport needs handle_t and recv_message(handle_t, char *, bool)");
+        auto header = Transport::recv_message(sock, msg_buf, block);
+        if (!header)
+        {
+            return false;
+        }
+
+        if (capture)
+        {
+            capture->append(*header, msg_buf);
+        }
+
+        process_message<Policy>(&*header, msg_buf, cbif, debug, stats);
         return true;
     }
 
@@ -45,6 +45,7 @@ https://opensource.org/licenses/MIT
 #include <unistd.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <assert.h>
 
 #include <iostream>
 #include <string>
@@ -52,6 +53,7 @@ https://opensource.org/licenses/MIT
 #include <vector>
 
 #include "sock_help.hpp"
+#include "latency.hpp"
 
 #include "ilink_v8/Negotiate500.h"
 #include "ilink_v8/Establish503.h"
@@ -62,6 +64,11 @@ https://opensource.org/licenses/MIT
 #include "ilink_v8/SideReq.h"
 #include "ilink_v8/OrderCancelReplaceRequest515.h"
 #include "ilink_v8/OrderCancelRequest516.h"
+#include "ilink_v8/OrderMassActionRequest529.h"
+#include "ilink_v8/MassQuote517.h"
+#include "ilink_v8/QuoteCancel528.h"
+#include "ilink_v8/OrderStatusRequest533.h"
+#include "ilink_v8/OrderMassStatusRequest530.h"
 #include "ilink_v8/PartyDetailsDefinitionRequest518.h"
 #include "ilink_v8/PartyDetailsListRequest537.h"
 #include "ilink_v8/ListUpdAct.h"
@@ -73,26 +80,88 @@ https://opensource.org/licenses/MIT
 #include "sign.hpp"
 #include "ilink/audit.hpp"
 #include "ilink/ilink_null.hpp"
+#include "ilink/session_state.hpp"
 
 /***************************************************************
  *
  * For message definitions see:
  * https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Binary+Order+Entry
  *
- * We only implement new UUID negotiation. No reuse of UUID from previous session
+ * A new UUID is negotiated unless the session is continued from its
+ * state file, see set_session_state() and session_state.hpp
+ *
+ * Application messages are encoded into one buffer per ILinkSndT, send
+ * them from one thread. Session messages are encoded on the stack, a
+ * heartbeat thread may send Sequence506 next to order entry.
  *
  * Option specific functionality is not implemented
+ * except for mass quoting (MassQuote517 and QuoteCancel528)
  *
  * *************************************************************/
 
 namespace m2::ilink
 {
 
-  class ILinkSnd
+  /**
+   * @brief one instrument of a mass quote
+   * prices are PRICE9 mantissas (price * 1e9),
+   * use PRICENULL9::mantissaNullValue() and 0 size for a one sided quote
+   */
+  struct quote_entry_t
+  {
+    int64_t BidPx;
+    int64_t OfferPx;
+    uint32_t QuoteEntryID;
+    int32_t SecurityID;
+    uint32_t BidSize;
+    uint32_t OfferSize;
+    int32_t UnderlyingSecurityID;
+    uint16_t QuoteSetID;
+  };
+
+  /**
+   * @brief a buy and a sell NewOrderSingle514 encoded ahead of time
+   * @see ILinkSndT::arm(), ILinkSndT::fire()
+   */
+  struct armed_order_t
   {
+    static constexpr size_t FRAME_SIZE = 256;
+
+    // framed messages, [0] buy [1] sell, each on its own cache lines
+    alignas(64) char frame[2][FRAME_SIZE];
+    int length; // as passed to send_message, body without headers
+    int32_t SecurityID;
+
+    /**
+     * @brief pull both frames into cache, e.g. from the idle loop
+     */
+    void prefetch() const noexcept
+    {
+      for (size_t i = 0; i < sizeof frame; i += 64)
+        __builtin_prefetch(&frame[0][0] + i, 1, 3);
+    }
+  };
+
+  /**
+   * @brief iLink message encoder
+   *
+   * Transport is the I/O policy messages are sent with,
+   * sockhelp::SocketTransport (a TCP socket) by default.
+   * @see sock_help.hpp
+   */
+  template <typename Transport = sockhelp::SocketTransport>
+  class ILinkSndT
+  {
+    static_assert(sockhelp::is_send_transport<Transport>::value,
+                  "Transport needs handle_t and send_message(handle_t, const char *, int, bool)");
 
   public:
-    ILinkSnd(
+    using handle_t = typename Transport::handle_t;
+
+    // largest message encoded, a mass quote
+    static constexpr size_t SEND_BUFFER_SIZE = 4096;
+
+    ILinkSndT(
         uint16_t _KeepAliveInterval,
         const std::string &_Account,
         const std::string &_AccessKeyId,
@@ -117,13 +186,45 @@ namespace m2::ilink
           SenderId(_SenderId),
           Location(_Location),
           PartyDetailsListReqID(_PartyDetailsListReqID),
-          KeepAliveInterval(_KeepAliveInterval)
+          KeepAliveInterval(_KeepAliveInterval),
+          signer(_SecretKey)
     {
       // Initialize UUID to time since epoch in milliseconds
       UUID = generate_time_stamp_milliseconds();
     }
 
+    /**
+     * @brief encoder for the same session over another transport
+     * e.g. one per producer thread in submit.hpp
+     * The session state file, if any, stays with o.
+     */
+    template <typename Other>
+    explicit ILinkSndT(const ILinkSndT<Other> &o)
+        : Account(o.Account),
+          AccessKeyId(o.AccessKeyId),
+          SecretKey(o.SecretKey),
+          SessionID(o.SessionID),
+          FirmID(o.FirmID),
+          TradingSystemName(o.TradingSystemName),
+          TradingSystemVersion(o.TradingSystemVersion),
+          TradingSystemVendor(o.TradingSystemVendor),
+          NextSeqNo(o.NextSeqNo),
+          KeepAliveInterval(o.KeepAliveInterval),
+          UUID(o.UUID),
+          OrderRequestID(o.OrderRequestID),
+          SenderId(o.SenderId),
+          PartyDetailsListReqID(o.PartyDetailsListReqID),
+          Location(o.Location),
+          FTI(o.FTI),
+          latency_stats(o.latency_stats),
+          signer(o.SecretKey)
+    {
+    }
+
   private:
+    template <typename>
+    friend class ILinkSndT;
+
 
     const bool debug = false;
     std::string Account;
@@ -142,6 +243,66 @@ namespace m2::ilink
     uint64_t PartyDetailsListReqID;
     std::string Location;
     const std::string New_Line = "\n";
+    sbe::FTI::Value FTI = sbe::FTI::Primary;
+    latency::Stats *latency_stats = nullptr;
+    session_state::State *state = nullptr;
+    mutable HMACSigner signer;
+    char *send_buf = nullptr;
+    alignas(64) mutable char own_send_buf[SEND_BUFFER_SIZE];
+    // warm_up() encodes here so it never touches a message in send_buffer()
+    alignas(64) char warm_buf[1024];
+
+    /**
+     * @brief SeqNum of the next message, persisted if there is a session state
+     */
+    uint32_t take_seq_no() noexcept
+    {
+      auto seq_no = NextSeqNo++;
+      if (state)
+        state->NextSeqNo.store(NextSeqNo, std::memory_order_relaxed);
+      return seq_no;
+    }
+
+    /**
+     * @brief OrderRequestID of the next request, persisted if there is a session state
+     */
+    uint64_t take_order_request_id() noexcept
+    {
+      auto order_request_id = OrderRequestID++;
+      if (state)
+        state->OrderRequestID.store(OrderRequestID, std::memory_order_relaxed);
+      return order_request_id;
+    }
+
+    void save_state() noexcept
+    {
+      if (state)
+        state->save(UUID, NextSeqNo, OrderRequestID);
+    }
+
+    /**
+     * @brief buffer application messages are encoded in, see set_send_buffer()
+     *
+     * One per encoder, so the send_* calls of application messages must
+     * come from one thread. Session messages (Negotiate500, Establish503,
+     * Sequence506, Terminate507, RetransmitRequest508) are encoded on the
+     * stack and may be sent from another thread, e.g. a heartbeat thread.
+     */
+    char *send_buffer() const noexcept
+    {
+      return send_buf ? send_buf : own_send_buf;
+    }
+
+    /**
+     * @brief zero the SOFH, message header and root block of an M, plus
+     * extra bytes of groups or credentials, so fields a send_* leaves
+     * unset go out as 0 without clearing the whole buffer
+     */
+    template <typename M>
+    static void clear_frame(char *buffer, size_t extra = 0) noexcept
+    {
+      memset(buffer, 0, sockhelp::SOFH_AND_SBE_HEADER_SIZE + M::sbeBlockLength() + extra);
+    }
 
     /**
      * @brief genrate ts in nanoseconds
@@ -217,6 +378,59 @@ namespace m2::ilink
     }
 
   public:
+    /**
+     * @brief record encode and send latency of this session
+     * only used when compiled with ILINK_LATENCY
+     * @see latency.hpp
+     */
+    void set_latency_stats(latency::Stats *stats) noexcept
+    {
+      latency_stats = stats;
+    }
+
+    /**
+     * @brief encode messages in buf instead of a buffer inside this object,
+     * e.g. one from arena::Arena so it is pre-faulted and NUMA local
+     *
+     * @param buf SEND_BUFFER_SIZE bytes used by this encoder only,
+     * nullptr to go back to the own buffer
+     */
+    void set_send_buffer(char *buf) noexcept
+    {
+      send_buf = buf;
+    }
+
+    /**
+     * @brief keep UUID, NextSeqNo and OrderRequestID in a session state file
+     * @see session_state.hpp
+     *
+     * @param _state from session_state::State::open() for this SessionID
+     * and FirmID, nullptr to stop persisting. A file of another session
+     * is refused.
+     * @return true if it held a previous session, which is continued:
+     * send Establish503 without negotiating
+     */
+    bool set_session_state(session_state::State *_state) noexcept
+    {
+      if (_state && !_state->matches(SessionID, FirmID))
+      {
+        std::cerr << "session state of another session, not used for " << SessionID << std::endl;
+        _state = nullptr;
+      }
+      state = _state;
+      if (!state)
+        return false;
+      if (state->resumable())
+      {
+        UUID = state->UUID.load(std::memory_order_relaxed);
+        NextSeqNo = state->NextSeqNo.load(std::memory_order_relaxed);
+        OrderRequestID = state->OrderRequestID.load(std::memory_order_relaxed);
+        return true;
+      }
+      save_state();
+      return false;
+    }
+
     void reset_uuid(u_int64_t _uuid = 0, uint32_t _next_seq_no = 1)
     {
       if (_uuid)
@@ -229,6 +443,59 @@ namespace m2::ilink
         UUID = generate_time_stamp_milliseconds();
       }
       NextSeqNo = _next_seq_no;
+      save_state();
+    }
+
+    uint32_t get_next_seq_no() const noexcept
+    {
+      return NextSeqNo;
+    }
+
+    /**
+     * @brief the state file set with set_session_state(), may be nullptr
+     */
+    session_state::State *get_session_state() const noexcept
+    {
+      return state;
+    }
+
+    uint64_t get_order_request_id() const noexcept
+    {
+      return OrderRequestID;
+    }
+
+    /**
+     * @brief FaultToleranceIndicator sent with Sequence506, the one CME
+     * gave the current connection in EstablishmentAck504 or Sequence506
+     */
+    void set_fault_tolerance_indicator(sbe::FTI::Value _FTI) noexcept
+    {
+      FTI = _FTI;
+    }
+
+    sbe::FTI::Value get_fault_tolerance_indicator() const noexcept
+    {
+      return FTI;
+    }
+
+    /**
+     * @brief PartyDetailsListReqID sent with application messages from now on,
+     * e.g. one found in party_registry::Registry
+     */
+    void set_party_details_list_req_id(uint64_t reqid) noexcept
+    {
+      PartyDetailsListReqID = reqid;
+    }
+
+    /**
+     * @brief set the numbers the next application message is sent with
+     * only for a caller that assigns them itself, see submit.hpp
+     */
+    void set_next_ids(uint32_t _next_seq_no, uint64_t _order_request_id) noexcept
+    {
+      NextSeqNo = _next_seq_no;
+      OrderRequestID = _order_request_id;
+      save_state();
     }
 
     /**
@@ -236,11 +503,12 @@ namespace m2::ilink
      * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/Negotiate
      *
      */
-    void send_nogotiate_message(int sock) const noexcept
+    void send_nogotiate_message(handle_t sock) const noexcept
     {
+      ILINK_LATENCY_DECL(t_encode);
       auto RequestTimeStamp = generate_time_stamp_nanoseconds();
       char buffer[1024];
-      memset(buffer, 0, sizeof buffer);
+      clear_frame<sbe::Negotiate500>(buffer, sockhelp::CRED_SZ);
       sbe::Negotiate500 negotiate;
       auto msg = negotiate.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, sizeof buffer);
       msg.putAccessKeyID(AccessKeyId);
@@ -248,7 +516,7 @@ namespace m2::ilink
       msg.putSession(SessionID);
       msg.requestTimestamp(RequestTimeStamp);
       auto canonicalMsg = create_canonical_negotiate_message(RequestTimeStamp);
-      auto signature = calculateHMAC(SecretKey, canonicalMsg, debug);
+      auto signature = signer.sign(canonicalMsg);
       msg.putHMACSignature(signature);
       msg.uUID(UUID);
       if (debug)
@@ -256,7 +524,9 @@ namespace m2::ilink
         std::cerr << "sending: " << msg << std::endl;
       }
 
-      sockhelp::send_message(sock, buffer, msg.encodedLength(), true);
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength(), true);
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
     }
 
     /**
@@ -264,11 +534,12 @@ namespace m2::ilink
      * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/Establish
      *
      */
-    void send_establish_message(int sock) noexcept
+    void send_establish_message(handle_t sock) noexcept
     {
+      ILINK_LATENCY_DECL(t_encode);
       auto RequestTimeStamp = generate_time_stamp_nanoseconds();
       char buffer[1024];
-      memset(buffer, 0, sizeof buffer);
+      clear_frame<sbe::Establish503>(buffer, sockhelp::CRED_SZ);
       sbe::Establish503 establish;
       auto msg = establish.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, sizeof buffer);
       msg.putAccessKeyID(AccessKeyId);
@@ -276,7 +547,7 @@ namespace m2::ilink
       msg.putSession(SessionID);
       msg.requestTimestamp(RequestTimeStamp);
       auto canonicalMsg = create_canonical_establish_message(RequestTimeStamp);
-      auto sig = calculateHMAC(SecretKey, canonicalMsg, debug);
+      auto sig = signer.sign(canonicalMsg);
       msg.putHMACSignature(sig);
       msg.uUID(UUID);
       msg.putTradingSystemName(TradingSystemName);
@@ -289,7 +560,9 @@ namespace m2::ilink
         std::cerr << "sending: " << msg << std::endl;
       }
 
-      sockhelp::send_message(sock, buffer, msg.encodedLength(), true);
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength(), true);
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
     }
 
     /**
@@ -297,15 +570,16 @@ namespace m2::ilink
      * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/Sequence
      * @return void
      */
-    void send_sequence(int sock, bool lapsed = false) const noexcept
+    void send_sequence(handle_t sock, bool lapsed = false) const noexcept
     {
+      ILINK_LATENCY_DECL(t_encode);
       char buffer[1024];
-      memset(buffer, 0, sizeof buffer);
+      clear_frame<sbe::Sequence506>(buffer);
       sbe::Sequence506 sequence;
       auto msg = sequence.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, sizeof buffer);
       msg.nextSeqNo(NextSeqNo);
       msg.uUID(UUID);
-      msg.faultToleranceIndicator(sbe::FTI::Primary);
+      msg.faultToleranceIndicator(FTI);
       if (lapsed)
         msg.keepAliveIntervalLapsed(sbe::KeepAliveLapsed::Lapsed);
       else
@@ -315,18 +589,21 @@ namespace m2::ilink
         std::cerr << "sending: " << msg << std::endl;
       }
 
-      sockhelp::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
     }
 
     /**
      * @brief send terminate message
      * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/Terminate
      */
-    void send_terminate(int sock, uint16_t errorCodes = 0) const noexcept
+    void send_terminate(handle_t sock, uint16_t errorCodes = 0) const noexcept
     {
+      ILINK_LATENCY_DECL(t_encode);
       auto RequestTimeStamp = generate_time_stamp_nanoseconds();
       char buffer[1024];
-      memset(buffer, 0, sizeof buffer);
+      clear_frame<sbe::Terminate507>(buffer);
       sbe::Terminate507 terminate;
       auto msg = terminate.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, sizeof buffer);
       msg.uUID(UUID);
@@ -337,7 +614,9 @@ namespace m2::ilink
         std::cerr << "sending: " << msg << std::endl;
       }
 
-      sockhelp::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
     }
 
     /**
@@ -345,7 +624,7 @@ namespace m2::ilink
      * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+New+Order+-+Single
      */
     void send_new_order_single(
-        int sock,
+        handle_t sock,
         double price,
         uint32_t qty,
         int32_t securityID,
@@ -357,12 +636,139 @@ namespace m2::ilink
         sbe::OrderTypeReq::Value ord_type,
         sbe::TimeInForce::Value time_in_force) noexcept
     {
+      new_order_single(sock, price, qty, securityID, side, cloid, stop_px, min_qty, display_qty, ord_type, time_in_force, false);
+    }
 
-      auto RequestTimeStamp = generate_time_stamp_nanoseconds();
-      char buffer[1024];
-      memset(buffer, 0, sizeof buffer);
-      sbe::NewOrderSingle514 newOrderSingle;
-      auto msg = newOrderSingle.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, sizeof buffer);
+    /**
+     * @brief keep the new order path in cache during quiet periods
+     *
+     * Runs send_new_order_single() for a dummy limit order: the same
+     * encode and audit staging, into a scratch buffer of its own so
+     * send_buffer() is left as it was. Nothing is sent and nothing is
+     * audited, NextSeqNo and OrderRequestID are left as they were. If
+     * the transport has warm_message() (the socket transports) the
+     * framing and a zero length send() are run too.
+     *
+     * Call it from the idle branch of the session loop, e.g. when a
+     * non blocking receive returns nothing and no order went out for
+     * some tens of microseconds. Not thread safe with the send_* calls.
+     *
+     * @param price, securityID of an instrument you trade, so the
+     * encoded values look like a real order's
+     */
+    void warm_up(handle_t sock, int32_t securityID, double price) noexcept
+    {
+      static const std::string cloid = "WARMUP";
+      new_order_single(sock, price, 1, securityID, sbe::SideReq::Buy, cloid, 0, 0, 0,
+                       sbe::OrderTypeReq::Limit, sbe::TimeInForce::Day, true);
+    }
+
+    /**
+     * @brief pre-encode a buy and a sell new order single for fire()
+     *
+     * Everything but price, qty, SeqNum, OrderRequestID,
+     * SendingTimeEpoch (and optionally ClOrdID) is fixed here.
+     * Nothing is sent and no ids are used up.
+     *
+     * @param cloid ClOrdID used when fire() is not given one
+     */
+    void arm(
+        armed_order_t &armed,
+        int32_t securityID,
+        const std::string &cloid,
+        uint32_t min_qty = 0,
+        uint32_t display_qty = 0,
+        sbe::OrderTypeReq::Value ord_type = sbe::OrderTypeReq::Limit,
+        sbe::TimeInForce::Value time_in_force = sbe::TimeInForce::Day) const noexcept
+    {
+      static_assert(armed_order_t::FRAME_SIZE >=
+                    sockhelp::SOFH_AND_SBE_HEADER_SIZE + sbe::NewOrderSingle514::sbeBlockLength());
+      sbe::SideReq::Value sides[2] = {sbe::SideReq::Buy, sbe::SideReq::Sell};
+      for (int i = 0; i < 2; ++i)
+      {
+        auto msg = encode_new_order_single(armed.frame[i], armed_order_t::FRAME_SIZE, 0, 0, securityID, sides[i], cloid, 0,
+                                           min_qty, display_qty, ord_type, time_in_force, 0, 0, 0);
+        armed.length = msg.encodedLength();
+        sockhelp::frame_message(armed.frame[i], armed.length);
+      }
+      armed.SecurityID = securityID;
+    }
+
+    /**
+     * @brief send an armed order
+     *
+     * Writes price, qty, SeqNum, OrderRequestID, SendingTimeEpoch and
+     * ClOrdID into the pre-encoded frame and sends it. The audit record
+     * is made after the send.
+     *
+     * @param price PRICE9 mantissa (price * 1e9)
+     * @param sending_time ns since epoch, e.g. the signal time, 0 for now
+     * @param cloid ClOrdID, 20 bytes padded with 0, nullptr to keep the armed one
+     */
+    void fire(
+        handle_t sock,
+        armed_order_t &armed,
+        sbe::SideReq::Value side,
+        int64_t price,
+        uint32_t qty,
+        uint64_t sending_time = 0,
+        const char *cloid = nullptr) noexcept
+    {
+      using M = sbe::NewOrderSingle514;
+      ILINK_LATENCY_DECL(t_encode);
+      auto frame = armed.frame[side == sbe::SideReq::Buy ? 0 : 1];
+      auto body = frame + sockhelp::SOFH_AND_SBE_HEADER_SIZE;
+      auto seq_no = take_seq_no();
+      auto order_request_id = take_order_request_id();
+      if (!sending_time)
+        sending_time = generate_time_stamp_nanoseconds();
+      memcpy(body + M::priceEncodingOffset(), &price, sizeof price);
+      memcpy(body + M::orderQtyEncodingOffset(), &qty, sizeof qty);
+      memcpy(body + M::seqNumEncodingOffset(), &seq_no, sizeof seq_no);
+      memcpy(body + M::orderRequestIDEncodingOffset(), &order_request_id, sizeof order_request_id);
+      memcpy(body + M::sendingTimeEpochEncodingOffset(), &sending_time, sizeof sending_time);
+      if (cloid)
+        memcpy(body + M::clOrdIDEncodingOffset(), cloid, M::clOrdIDLength());
+
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, frame, armed.length);
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
+
+      M msg;
+      msg.wrapForDecode(frame, sockhelp::SOFH_AND_SBE_HEADER_SIZE, M::sbeBlockLength(), M::sbeSchemaVersion(),
+                        armed_order_t::FRAME_SIZE);
+      if (debug)
+      {
+        std::cerr << "sending: " << msg << std::endl;
+      }
+      audit_new_order_single(msg, false);
+    }
+
+  private:
+    /**
+     * @brief encode a new order single into buffer
+     * used by send_new_order_single(), warm_up() and arm()
+     */
+    sbe::NewOrderSingle514 encode_new_order_single(
+        char *buffer,
+        size_t buffer_size,
+        double price,
+        uint32_t qty,
+        int32_t securityID,
+        sbe::SideReq::Value side,
+        const std::string &cloid,
+        double stop_px,
+        uint32_t min_qty,
+        uint32_t display_qty,
+        sbe::OrderTypeReq::Value ord_type,
+        sbe::TimeInForce::Value time_in_force,
+        uint32_t seq_no,
+        uint64_t order_request_id,
+        uint64_t sending_time) const noexcept
+    {
+      clear_frame<sbe::NewOrderSingle514>(buffer);
+      sbe::NewOrderSingle514 msg;
+      msg.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, buffer_size);
       auto &p = msg.price();
 
       //
@@ -375,12 +781,12 @@ namespace m2::ilink
       msg.orderQty(qty);
       msg.securityID(securityID);
       msg.side(side);
-      msg.seqNum(NextSeqNo++);
+      msg.seqNum(seq_no);
       msg.putSenderID(SenderId);
       msg.putClOrdID(cloid);
       msg.partyDetailsListReqID(PartyDetailsListReqID);
-      msg.orderRequestID(OrderRequestID++);
-      msg.sendingTimeEpoch(RequestTimeStamp);
+      msg.orderRequestID(order_request_id);
+      msg.sendingTimeEpoch(sending_time);
       msg.expireDate(UINT16_NULL);
       auto &rp = msg.reservationPrice();
       rp.mantissa(sbe::PRICENULL9::mantissaNullValue());
@@ -399,8 +805,6 @@ namespace m2::ilink
       }
       else
       {
-        // NOT TESTED
-        abort();
         auto &p = msg.stopPx();
         p.mantissa(sbe::PRICENULL9::mantissaNullValue());
       }
@@ -441,16 +845,17 @@ namespace m2::ilink
       em.u8 = 0;
       msg.executionMode(em.em);
 
-      if (debug)
-      {
-        std::cerr << "sending: " << msg << std::endl;
-      }
-
-      sockhelp::send_message(sock, buffer, msg.encodedLength());
+      return msg;
+    }
 
+    /**
+     * @brief fill the audit record of a new order single, send it unless warm
+     */
+    void audit_new_order_single(sbe::NewOrderSingle514 &msg, bool warm) const noexcept
+    {
       std::vector<std::any> vals;
       vals.resize(size_t(m2::ilink::Audit::END));
-      vals[size_t(m2::ilink::Audit::SendingTimestamps)] = // set to something printable
+      vals[size_t(m2::ilink::Audit::SendingTimestamps)] = msg.sendingTimeEpoch();
       vals[size_t(m2::ilink::Audit::MessageDirection)] = m2::ilink::TO_CME;
       vals[size_t(m2::ilink::Audit::OperatorID)] = FirmID;
       vals[size_t(m2::ilink::Audit::SessionID)] = SessionID;
@@ -468,21 +873,71 @@ namespace m2::ilink
       vals[size_t(m2::ilink::Audit::OrderQualifier)] = (uint8_t)msg.timeInForce();
       vals[size_t(m2::ilink::Audit::ManualOrderIndicator)] = (uint8_t)msg.manualOrderIndicator();
 
-      if (display_qty)
+      if (msg.displayQty() != UINT32_NULL)
       {
         vals[size_t(m2::ilink::Audit::DisplayQuantity)] = msg.displayQty();
       }
       vals[size_t(m2::ilink::Audit::CountryofOrigin)] = "US";
       vals[size_t(m2::ilink::Audit::PartyDetailsListRequestID)] = msg.partyDetailsListReqID();
-      m2::ilink::send_audit_msg(vals);
+      if (!warm)
+        m2::ilink::send_audit_msg(vals);
+    }
+
+    /**
+     * @brief send_new_order_single(), or warm_up() when warm
+     */
+    void new_order_single(
+        handle_t sock,
+        double price,
+        uint32_t qty,
+        int32_t securityID,
+        sbe::SideReq::Value side,
+        const std::string &cloid,
+        double stop_px,
+        uint32_t min_qty,
+        uint32_t display_qty,
+        sbe::OrderTypeReq::Value ord_type,
+        sbe::TimeInForce::Value time_in_force,
+        bool warm) noexcept
+    {
+      const auto seq_no = NextSeqNo;
+      const auto order_request_id = OrderRequestID;
+
+      ILINK_LATENCY_DECL(t_encode);
+      auto RequestTimeStamp = generate_time_stamp_nanoseconds();
+      auto buffer = warm ? warm_buf : send_buffer();
+      auto msg = encode_new_order_single(buffer, warm ? sizeof warm_buf : SEND_BUFFER_SIZE, price, qty, securityID, side, cloid, stop_px, min_qty, display_qty,
+                                         ord_type, time_in_force,
+                                         warm ? seq_no : take_seq_no(),
+                                         warm ? order_request_id : take_order_request_id(),
+                                         RequestTimeStamp);
+
+      if (debug)
+      {
+        std::cerr << "sending: " << msg << std::endl;
+      }
+
+      if (!warm)
+      {
+        ILINK_LATENCY_DECL(t_send);
+        Transport::send_message(sock, buffer, msg.encodedLength());
+        ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
+      }
+      else if constexpr (sockhelp::has_warm_message<Transport>::value)
+      {
+        Transport::warm_message(sock, buffer, msg.encodedLength());
+      }
+
+      audit_new_order_single(msg, warm);
     }
 
+  public:
     /**
      * @brief sendn cancel replace request message
      * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Order+Cancel+Replace+Request
      */
     void send_cancel_replace(
-        int sock,
+        handle_t sock,
         double price,
         uint32_t qty,
         int32_t securityID,
@@ -495,21 +950,22 @@ namespace m2::ilink
         sbe::OrderTypeReq::Value ord_type,
         sbe::TimeInForce::Value time_in_force) noexcept
     {
+      ILINK_LATENCY_DECL(t_encode);
       auto RequestTimeStamp = generate_time_stamp_nanoseconds();
-      char buffer[1024];
-      memset(buffer, 0, sizeof buffer);
+      auto buffer = send_buffer();
+      clear_frame<sbe::OrderCancelReplaceRequest515>(buffer);
       sbe::OrderCancelReplaceRequest515 cancelReplace;
-      auto msg = cancelReplace.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, sizeof buffer);
+      auto msg = cancelReplace.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, SEND_BUFFER_SIZE);
       auto &p = msg.price();
       p.mantissa(price * 1e9);
       msg.orderQty(qty);
       msg.securityID(securityID);
       msg.side(side);
-      msg.seqNum(NextSeqNo++);
+      msg.seqNum(take_seq_no());
       msg.putSenderID(SenderId);
       msg.putClOrdID(cloid);
       msg.partyDetailsListReqID(PartyDetailsListReqID);
-      msg.orderRequestID(OrderRequestID++);
+      msg.orderRequestID(take_order_request_id());
       msg.sendingTimeEpoch(RequestTimeStamp);
       msg.expireDate(UINT16_NULL);
       if (ord_type == sbe::OrderTypeReq::Value::StopLimit || ord_type == sbe::OrderTypeReq::Value::StopwithProtection)
@@ -566,11 +1022,13 @@ namespace m2::ilink
         std::cerr << "sending: " << msg << std::endl;
       }
 
-      sockhelp::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
 
       std::vector<std::any> vals;
       vals.resize(size_t(m2::ilink::Audit::END));
-      vals[size_t(m2::ilink::Audit::SendingTimestamps)] = // set to something printable
+      vals[size_t(m2::ilink::Audit::SendingTimestamps)] = msg.sendingTimeEpoch();
       vals[size_t(m2::ilink::Audit::MessageDirection)] = m2::ilink::TO_CME;
       vals[size_t(m2::ilink::Audit::OperatorID)] = FirmID;
       vals[size_t(m2::ilink::Audit::SessionID)] = SessionID;
@@ -602,23 +1060,24 @@ namespace m2::ilink
      * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Order+Cancel+Request
      */
     void send_cancel(
-        int sock,
+        handle_t sock,
         uint64_t orig_ordid,
         std::string cloid,
         int32_t securityID,
         sbe::SideReq::Value side) noexcept
     {
+      ILINK_LATENCY_DECL(t_encode);
       auto RequestTimeStamp = generate_time_stamp_nanoseconds();
 
-      char buffer[1024];
-      memset(buffer, 0, sizeof buffer);
+      auto buffer = send_buffer();
+      clear_frame<sbe::OrderCancelRequest516>(buffer);
       sbe::OrderCancelRequest516 cancel;
-      auto msg = cancel.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, sizeof buffer);
-      msg.seqNum(NextSeqNo++);
+      auto msg = cancel.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, SEND_BUFFER_SIZE);
+      msg.seqNum(take_seq_no());
       msg.putSenderID(SenderId);
       msg.putClOrdID(cloid);
       msg.partyDetailsListReqID(PartyDetailsListReqID);
-      msg.orderRequestID(OrderRequestID++);
+      msg.orderRequestID(take_order_request_id());
       msg.sendingTimeEpoch(RequestTimeStamp);
       msg.putLocation(Location);
       if (orig_ordid)
@@ -636,11 +1095,13 @@ namespace m2::ilink
       ss << msg;
       log_inf("msg: %s", ss.str());
 
-      sockhelp::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
 
       std::vector<std::any> vals;
       vals.resize(size_t(m2::ilink::Audit::END));
-      vals[size_t(m2::ilink::Audit::SendingTimestamps)] = // set to something printable
+      vals[size_t(m2::ilink::Audit::SendingTimestamps)] = msg.sendingTimeEpoch();
       vals[size_t(m2::ilink::Audit::MessageDirection)] = m2::ilink::TO_CME;
       vals[size_t(m2::ilink::Audit::OperatorID)] = FirmID;
       vals[size_t(m2::ilink::Audit::SessionID)] = SessionID;
@@ -657,6 +1118,351 @@ namespace m2::ilink
       m2::ilink::send_audit_msg(vals);
     }
 
+    /**
+     * @brief send order mass action request message
+     * Cancels every working order matching the scope in one message.
+     * scope Instrument uses securityID, InstrumentGroup uses security_group,
+     * MarketSegmentID uses market_segment_id. side, ord_type and time_in_force
+     * narrow the scope further and are ignored when NULL_VALUE.
+     * cancel_request_type narrows it to the orders of this SenderID
+     * (SenderSubID) or of the account behind PartyDetailsListReqID
+     * (Account), NULL_VALUE cancels for the whole session.
+     * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Order+Mass+Action+Request
+     * iLink responds with
+     * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Order+Mass+Action+Report
+     */
+    void send_order_mass_action(
+        handle_t sock,
+        sbe::MassActionScope::Value scope,
+        int32_t securityID,
+        const std::string &security_group,
+        uint8_t market_segment_id,
+        sbe::SideNULL::Value side = sbe::SideNULL::NULL_VALUE,
+        sbe::MassActionOrdTyp::Value ord_type = sbe::MassActionOrdTyp::NULL_VALUE,
+        sbe::MassCxlTIF::Value time_in_force = sbe::MassCxlTIF::NULL_VALUE,
+        sbe::MassCxlReqTyp::Value cancel_request_type = sbe::MassCxlReqTyp::NULL_VALUE) noexcept
+    {
+      ILINK_LATENCY_DECL(t_encode);
+      auto RequestTimeStamp = generate_time_stamp_nanoseconds();
+      auto buffer = send_buffer();
+      clear_frame<sbe::OrderMassActionRequest529>(buffer);
+      sbe::OrderMassActionRequest529 massAction;
+      auto msg = massAction.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, SEND_BUFFER_SIZE);
+      msg.partyDetailsListReqID(PartyDetailsListReqID);
+      msg.orderRequestID(take_order_request_id());
+      msg.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+      msg.seqNum(take_seq_no());
+      msg.putSenderID(SenderId);
+      msg.sendingTimeEpoch(RequestTimeStamp);
+      msg.putLocation(Location);
+      msg.massActionScope(scope);
+      if (scope == sbe::MassActionScope::Instrument)
+        msg.securityID(securityID);
+      else
+        msg.securityID(INT32_NULL);
+      if (scope == sbe::MassActionScope::InstrumentGroup)
+        msg.putSecurityGroup(security_group);
+      if (scope == sbe::MassActionScope::MarketSegmentID)
+        msg.marketSegmentID(market_segment_id);
+      else
+        msg.marketSegmentID(UINT8_NULL);
+      msg.massCancelRequestType(cancel_request_type);
+      msg.side(side);
+      msg.ordType(ord_type);
+      msg.timeInForce(time_in_force);
+      msg.liquidityFlag(sbe::BooleanNULL::NULL_VALUE);
+      if (debug)
+      {
+        std::cerr << "sending: " << msg << std::endl;
+      }
+
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
+
+      std::vector<std::any> vals;
+      vals.resize(size_t(m2::ilink::Audit::END));
+      vals[size_t(m2::ilink::Audit::SendingTimestamps)] = msg.sendingTimeEpoch();
+      vals[size_t(m2::ilink::Audit::MessageDirection)] = m2::ilink::TO_CME;
+      vals[size_t(m2::ilink::Audit::OperatorID)] = FirmID;
+      vals[size_t(m2::ilink::Audit::SessionID)] = SessionID;
+      vals[size_t(m2::ilink::Audit::MessageType)] = "CA";
+      if (scope == sbe::MassActionScope::Instrument)
+      {
+        vals[size_t(m2::ilink::Audit::Instrument)] = msg.securityID();
+      }
+      vals[size_t(m2::ilink::Audit::OrderRequestID)] = msg.orderRequestID();
+      if (side != sbe::SideNULL::NULL_VALUE)
+      {
+        vals[size_t(m2::ilink::Audit::BuySellIndicator)] = (uint8_t)msg.side();
+      }
+      vals[size_t(m2::ilink::Audit::ManualOrderIndicator)] = (uint8_t)msg.manualOrderIndicator();
+      vals[size_t(m2::ilink::Audit::CountryofOrigin)] = "US";
+      vals[size_t(m2::ilink::Audit::PartyDetailsListRequestID)] = msg.partyDetailsListReqID();
+
+      m2::ilink::send_audit_msg(vals);
+    }
+
+    /**
+     * @brief send order status request message
+     * iLink responds with one ExecutionReportStatus532 carrying ord_status_req_id
+     * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Order+Status+Request
+     */
+    void send_order_status_request(
+        handle_t sock,
+        uint64_t ord_id,
+        uint64_t ord_status_req_id) noexcept
+    {
+      ILINK_LATENCY_DECL(t_encode);
+      auto RequestTimeStamp = generate_time_stamp_nanoseconds();
+      auto buffer = send_buffer();
+      clear_frame<sbe::OrderStatusRequest533>(buffer);
+      sbe::OrderStatusRequest533 orderStatusRequest;
+      auto msg = orderStatusRequest.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, SEND_BUFFER_SIZE);
+      msg.partyDetailsListReqID(PartyDetailsListReqID);
+      msg.sendingTimeEpoch(RequestTimeStamp);
+      msg.orderID(ord_id);
+      msg.putSenderID(SenderId);
+      msg.seqNum(take_seq_no());
+      msg.ordStatusReqID(ord_status_req_id);
+      msg.putLocation(Location);
+      msg.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+      if (debug)
+      {
+        std::cerr << "sending: " << msg << std::endl;
+      }
+
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
+    }
+
+    /**
+     * @brief send order mass status request message
+     * iLink responds with one ExecutionReportStatus532 per working order,
+     * each carrying mass_status_req_id and the total number of reports.
+     * req_type Instrument uses securityID, InstrumentGroup uses security_group,
+     * MarketSegment uses market_segment_id.
+     * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Order+Mass+Status+Request
+     */
+    void send_order_mass_status_request(
+        handle_t sock,
+        uint64_t mass_status_req_id,
+        sbe::MassStatusReqTyp::Value req_type,
+        int32_t securityID,
+        const std::string &security_group,
+        uint8_t market_segment_id,
+        sbe::MassStatusTIF::Value time_in_force = sbe::MassStatusTIF::NULL_VALUE) noexcept
+    {
+      ILINK_LATENCY_DECL(t_encode);
+      auto RequestTimeStamp = generate_time_stamp_nanoseconds();
+      auto buffer = send_buffer();
+      clear_frame<sbe::OrderMassStatusRequest530>(buffer);
+      sbe::OrderMassStatusRequest530 orderMassStatusRequest;
+      auto msg = orderMassStatusRequest.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, SEND_BUFFER_SIZE);
+      msg.partyDetailsListReqID(PartyDetailsListReqID);
+      msg.massStatusReqID(mass_status_req_id);
+      msg.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+      msg.seqNum(take_seq_no());
+      msg.putSenderID(SenderId);
+      msg.sendingTimeEpoch(RequestTimeStamp);
+      msg.putLocation(Location);
+      msg.massStatusReqType(req_type);
+      if (req_type == sbe::MassStatusReqTyp::Instrument)
+        msg.securityID(securityID);
+      else
+        msg.securityID(INT32_NULL);
+      if (req_type == sbe::MassStatusReqTyp::InstrumentGroup)
+        msg.putSecurityGroup(security_group);
+      if (req_type == sbe::MassStatusReqTyp::MarketSegment)
+        msg.marketSegmentID(market_segment_id);
+      else
+        msg.marketSegmentID(UINT8_NULL);
+      msg.ordStatusReqType(sbe::MassStatusOrdTyp::NULL_VALUE);
+      msg.timeInForce(time_in_force);
+      if (debug)
+      {
+        std::cerr << "sending: " << msg << std::endl;
+      }
+
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
+    }
+
+    static constexpr size_t MAX_QUOTE_ENTRIES = 100;
+
+    /**
+     * @brief send mass quote message
+     * Up to MAX_QUOTE_ENTRIES instruments are quoted in one message.
+     * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Mass+Quote
+     * iLink responds with
+     * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Mass+Quote+Acknowledgment
+     * @return false, nothing sent, unless 0 < count <= MAX_QUOTE_ENTRIES
+     */
+    bool send_mass_quote(
+        handle_t sock,
+        uint32_t quote_id,
+        const quote_entry_t *entries,
+        size_t count,
+        bool mm_protection_reset = false) noexcept
+    {
+      if (count == 0 || count > MAX_QUOTE_ENTRIES || !entries)
+      {
+        std::cerr << "mass quote of " << count << " entries not sent, 1 to " << MAX_QUOTE_ENTRIES << " are allowed" << std::endl;
+        return false;
+      }
+      ILINK_LATENCY_DECL(t_encode);
+      auto RequestTimeStamp = generate_time_stamp_nanoseconds();
+      auto buffer = send_buffer();
+      clear_frame<sbe::MassQuote517>(buffer,
+                                       sbe::MassQuote517::NoQuoteEntries::sbeHeaderSize() +
+                                       count * sbe::MassQuote517::NoQuoteEntries::sbeBlockLength());
+      sbe::MassQuote517 massQuote;
+      auto msg = massQuote.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, SEND_BUFFER_SIZE);
+      msg.partyDetailsListReqID(PartyDetailsListReqID);
+      msg.sendingTimeEpoch(RequestTimeStamp);
+      msg.quoteReqID(UINT64_NULL);
+      msg.quoteID(quote_id);
+      msg.putSenderID(SenderId);
+      msg.seqNum(take_seq_no());
+      msg.putLocation(Location);
+      msg.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+      msg.totNoQuoteEntries(uint8_t(count));
+      if (mm_protection_reset)
+        msg.mMProtectionReset(sbe::BooleanNULL::True);
+      else
+        msg.mMProtectionReset(sbe::BooleanNULL::NULL_VALUE);
+      msg.liquidityFlag(sbe::BooleanNULL::NULL_VALUE);
+      msg.shortSaleType(sbe::ShortSaleType::NULL_VALUE);
+      auto noQuoteEntries = msg.noQuoteEntriesCount(uint8_t(count));
+      for (size_t i = 0; i < count; ++i)
+      {
+        const auto &e = entries[i];
+        noQuoteEntries.next();
+        noQuoteEntries.bidPx().mantissa(e.BidPx);
+        noQuoteEntries.offerPx().mantissa(e.OfferPx);
+        noQuoteEntries.quoteEntryID(e.QuoteEntryID);
+        noQuoteEntries.securityID(e.SecurityID);
+        noQuoteEntries.bidSize(e.BidSize ? e.BidSize : UINT32_NULL);
+        noQuoteEntries.offerSize(e.OfferSize ? e.OfferSize : UINT32_NULL);
+        noQuoteEntries.underlyingSecurityID(e.UnderlyingSecurityID);
+        noQuoteEntries.quoteSetID(e.QuoteSetID);
+      }
+      if (debug)
+      {
+        std::cerr << "len:" << msg.encodedLength() << " sending " << msg << std::endl;
+      }
+
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
+
+      //
+      // one audit record per quote entry
+      //
+      for (size_t i = 0; i < count; ++i)
+      {
+        const auto &e = entries[i];
+        std::vector<std::any> vals;
+        vals.resize(size_t(m2::ilink::Audit::END));
+        vals[size_t(m2::ilink::Audit::SendingTimestamps)] = msg.sendingTimeEpoch();
+        vals[size_t(m2::ilink::Audit::MessageDirection)] = m2::ilink::TO_CME;
+        vals[size_t(m2::ilink::Audit::OperatorID)] = FirmID;
+        vals[size_t(m2::ilink::Audit::SessionID)] = SessionID;
+        vals[size_t(m2::ilink::Audit::MessageType)] = "i";
+        vals[size_t(m2::ilink::Audit::Instrument)] = e.SecurityID;
+        vals[size_t(m2::ilink::Audit::ManualOrderIndicator)] = (uint8_t)msg.manualOrderIndicator();
+        vals[size_t(m2::ilink::Audit::MessageQuoteID)] = quote_id;
+        vals[size_t(m2::ilink::Audit::QuoteSetID)] = e.QuoteSetID;
+        vals[size_t(m2::ilink::Audit::QuoteEntryID)] = e.QuoteEntryID;
+        if (e.BidSize)
+        {
+          vals[size_t(m2::ilink::Audit::BidPrice)] = e.BidPx / 1e9;
+          vals[size_t(m2::ilink::Audit::BidSize)] = e.BidSize;
+        }
+        if (e.OfferSize)
+        {
+          vals[size_t(m2::ilink::Audit::OfferPrice)] = e.OfferPx / 1e9;
+          vals[size_t(m2::ilink::Audit::OfferSize)] = e.OfferSize;
+        }
+        vals[size_t(m2::ilink::Audit::CountryofOrigin)] = "US";
+        vals[size_t(m2::ilink::Audit::PartyDetailsListRequestID)] = msg.partyDetailsListReqID();
+        m2::ilink::send_audit_msg(vals);
+      }
+      return true;
+    }
+
+    /**
+     * @brief send quote cancel message
+     * With CancelAllQuotes no instruments are needed, otherwise
+     * the quotes for each of the security_ids are cancelled.
+     * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Quote+Cancel
+     * iLink responds with
+     * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Quote+Cancel+Acknowledgment
+     * @return false, nothing sent, if count > MAX_QUOTE_ENTRIES
+     */
+    bool send_quote_cancel(
+        handle_t sock,
+        uint32_t quote_id,
+        sbe::QuoteCxlTyp::Value cancel_type,
+        const int32_t *security_ids = nullptr,
+        size_t count = 0) noexcept
+    {
+      if (count > MAX_QUOTE_ENTRIES || (count && !security_ids))
+      {
+        std::cerr << "quote cancel of " << count << " instruments not sent, up to " << MAX_QUOTE_ENTRIES << " are allowed" << std::endl;
+        return false;
+      }
+      ILINK_LATENCY_DECL(t_encode);
+      auto RequestTimeStamp = generate_time_stamp_nanoseconds();
+      auto buffer = send_buffer();
+      clear_frame<sbe::QuoteCancel528>(buffer,
+                                         sbe::QuoteCancel528::NoQuoteEntries::sbeHeaderSize() +
+                                         count * sbe::QuoteCancel528::NoQuoteEntries::sbeBlockLength() +
+                                         sbe::QuoteCancel528::NoQuoteSets::sbeHeaderSize());
+      sbe::QuoteCancel528 quoteCancel;
+      auto msg = quoteCancel.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, SEND_BUFFER_SIZE);
+      msg.partyDetailsListReqID(PartyDetailsListReqID);
+      msg.sendingTimeEpoch(RequestTimeStamp);
+      msg.quoteID(quote_id);
+      msg.putSenderID(SenderId);
+      msg.seqNum(take_seq_no());
+      msg.putLocation(Location);
+      msg.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+      msg.quoteCancelType(cancel_type);
+      msg.liquidityFlag(sbe::BooleanNULL::NULL_VALUE);
+      auto noQuoteEntries = msg.noQuoteEntriesCount(uint8_t(count));
+      for (size_t i = 0; i < count; ++i)
+      {
+        noQuoteEntries.next();
+        noQuoteEntries.securityID(security_ids[i]);
+      }
+      msg.noQuoteSetsCount(0);
+      if (debug)
+      {
+        std::cerr << "len:" << msg.encodedLength() << " sending " << msg << std::endl;
+      }
+
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
+
+      std::vector<std::any> vals;
+      vals.resize(size_t(m2::ilink::Audit::END));
+      vals[size_t(m2::ilink::Audit::SendingTimestamps)] = msg.sendingTimeEpoch();
+      vals[size_t(m2::ilink::Audit::MessageDirection)] = m2::ilink::TO_CME;
+      vals[size_t(m2::ilink::Audit::OperatorID)] = FirmID;
+      vals[size_t(m2::ilink::Audit::SessionID)] = SessionID;
+      vals[size_t(m2::ilink::Audit::MessageType)] = "Z";
+      vals[size_t(m2::ilink::Audit::ManualOrderIndicator)] = (uint8_t)msg.manualOrderIndicator();
+      vals[size_t(m2::ilink::Audit::MessageQuoteID)] = quote_id;
+      vals[size_t(m2::ilink::Audit::CountryofOrigin)] = "US";
+      vals[size_t(m2::ilink::Audit::PartyDetailsListRequestID)] = msg.partyDetailsListReqID();
+      m2::ilink::send_audit_msg(vals);
+      return true;
+    }
+
     /**
      * @brief send party details request message
      * For message definitions:
@@ -664,21 +1470,25 @@ namespace m2::ilink
      * onfluence/disp
      * iLink responds with
      * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Party+Details+Definition+Request+Acknowledgment
+     * @return the PartyDetailsListReqID sent, see party_registry.hpp to keep it
      */
-    void send_party_details_definition(
-        int sock,
+    uint64_t send_party_details_definition(
+        handle_t sock,
         sbe::ListUpdAct::Value list_update_action,
         const std::string &party_detail_id) noexcept
     {
+      ILINK_LATENCY_DECL(t_encode);
       auto RequestTimeStamp = generate_time_stamp_nanoseconds();
-      char buffer[1024];
-      memset(buffer, 0, sizeof buffer);
+      auto buffer = send_buffer();
+      clear_frame<sbe::PartyDetailsDefinitionRequest518>(buffer,
+                                                           sbe::PartyDetailsDefinitionRequest518::NoPartyDetails::sbeHeaderSize() +
+                                                           3 * sbe::PartyDetailsDefinitionRequest518::NoPartyDetails::sbeBlockLength());
       sbe::PartyDetailsDefinitionRequest518 partyDetailsDefinitionRequest;
-      auto msg = partyDetailsDefinitionRequest.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, sizeof buffer);
+      auto msg = partyDetailsDefinitionRequest.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, SEND_BUFFER_SIZE);
       msg.partyDetailsListReqID(RequestTimeStamp);
       msg.sendingTimeEpoch(RequestTimeStamp);
       msg.listUpdateAction(list_update_action);
-      msg.seqNum(NextSeqNo++);
+      msg.seqNum(take_seq_no());
       msg.custOrderHandlingInst(sbe::CustOrdHandlInst::ClientElectronic);
       msg.custOrderCapacity(sbe::CustOrderCapacity::Value::Membertradingfortheirownaccount);
       msg.clearingTradePriceType(sbe::SLEDS::TradeClearingatExecutionPrice);
@@ -705,11 +1515,13 @@ namespace m2::ilink
         std::cerr << "len:" << msg.encodedLength() << " sending " << msg << std::endl;
       }
 
-      sockhelp::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
 
       std::vector<std::any> vals;
       vals.resize(size_t(m2::ilink::Audit::END));
-      vals[size_t(m2::ilink::Audit::SendingTimestamps)] = // set tosomething printable
+      vals[size_t(m2::ilink::Audit::SendingTimestamps)] = msg.sendingTimeEpoch();
       vals[size_t(m2::ilink::Audit::MessageDirection)] = m2::ilink::TO_CME;
       vals[size_t(m2::ilink::Audit::OperatorID)] = FirmID;
       vals[size_t(m2::ilink::Audit::SessionID)] = SessionID;
@@ -728,6 +1540,7 @@ namespace m2::ilink
       vals[size_t(m2::ilink::Audit::TakeupAccountIdentifier)] = party_detail_id;
 
       m2::ilink::send_audit_msg(vals);
+      return msg.partyDetailsListReqID();
     }
 
     /**
@@ -735,13 +1548,14 @@ namespace m2::ilink
      * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/Retransmission
      */
     void send_retransmission_request(
-        int sock,
+        handle_t sock,
         uint32_t from_seq_no,
         uint16_t msg_count) noexcept
     {
+      ILINK_LATENCY_DECL(t_encode);
       auto RequestTimeStamp = generate_time_stamp_nanoseconds();
       char buffer[1024];
-      memset(buffer, 0, sizeof buffer);
+      clear_frame<sbe::RetransmitRequest508>(buffer);
       sbe::RetransmitRequest508 retransmitRequest;
       auto msg = retransmitRequest.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, sizeof buffer);
       msg.uUID(UUID);
@@ -754,7 +1568,9 @@ namespace m2::ilink
         std::cerr << "sending: " << msg << std::endl;
       }
 
-      sockhelp::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
     }
 
     /**
@@ -762,18 +1578,21 @@ namespace m2::ilink
      * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Party+Details+List+Request
      */
     void send_party_details_list_request(
-        int sock,
+        handle_t sock,
         uint64_t reqid,
         const std::string &partyId)
     {
+      ILINK_LATENCY_DECL(t_encode);
       auto RequestTimeStamp = generate_time_stamp_nanoseconds();
-      char buffer[1024];
-      memset(buffer, 0, sizeof buffer);
+      auto buffer = send_buffer();
+      clear_frame<sbe::PartyDetailsListRequest537>(buffer,
+                                                     sbe::PartyDetailsListRequest537::NoRequestingPartyIDs::sbeHeaderSize() +
+                                                     sbe::PartyDetailsListRequest537::NoRequestingPartyIDs::sbeBlockLength());
       sbe::PartyDetailsListRequest537 partyDetailsListRequest;
-      auto msg = partyDetailsListRequest.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, sizeof buffer);
+      auto msg = partyDetailsListRequest.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, SEND_BUFFER_SIZE);
       msg.partyDetailsListReqID(reqid);
       msg.sendingTimeEpoch(RequestTimeStamp);
-      msg.seqNum(NextSeqNo++);
+      msg.seqNum(take_seq_no());
       sbe::PartyDetailsListRequest537::NoRequestingPartyIDs noReqPartyIds = msg.noRequestingPartyIDsCount(1);
       noReqPartyIds.next();
       noReqPartyIds.putRequestingPartyID(partyId);
@@ -784,7 +1603,11 @@ namespace m2::ilink
         std::cerr << "len:" << msg.encodedLength() << " sending " << msg << std::endl;
       }
 
-      sockhelp::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_DECL(t_send);
+      Transport::send_message(sock, buffer, msg.encodedLength());
+      ILINK_LATENCY_RECORD_SEND(latency_stats, t_encode, t_send);
     }
   };
+
+  using ILinkSnd = ILinkSndT<>;
 }
\ No newline at end of file
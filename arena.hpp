@@ -0,0 +1,284 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <iostream>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/***************************************************************
+ *
+ * Session memory arena
+ *
+ * One mapping, allocated at startup, that the session's buffers are
+ * carved from: receive buffers, pipeline rings, in-process rings,
+ * the ILinkSnd send buffer, order templates. The mapping is
+ *
+ *   - 2MB huge pages (MAP_HUGETLB) if the kernel has them reserved
+ *     (vm.nr_hugepages), else 4K pages with transparent huge pages
+ *     requested (MADV_HUGEPAGE)
+ *   - bound to one NUMA node (mbind), by default the node of the cpu
+ *     create() is called on, so create it after pinning the thread
+ *   - locked (mlock, needs RLIMIT_MEMLOCK or CAP_IPC_LOCK)
+ *   - pre-faulted, every page is written once in create()
+ *
+ * so the hot path takes no page faults on these buffers, and few TLB
+ * misses. Failing to bind or lock is reported and not fatal,
+ * huge_pages(), bound() and locked() tell what was achieved.
+ *
+ * Allocation is a bump pointer, nothing is freed until the arena is
+ * destroyed and no destructors are run. Running out of arena is a
+ * sizing error found at startup, it aborts.
+ *
+ *   auto a = arena::Arena::create(64 << 20);
+ *   snd.set_send_buffer(a->buffer(ILinkSnd::SEND_BUFFER_SIZE));
+ *   pipeline::Pipeline<> p(sock, 2, pipeline::route_by_security, a.get());
+ *   inproc::Channel ch(*a, 1 << 20);
+ *
+ * prepare() binds, locks and pre-faults a mapping made elsewhere,
+ * e.g. a capture file (capture::Writer::prefault()).
+ *
+ * *************************************************************/
+
+namespace m2::ilink::arena
+{
+    static constexpr size_t SMALL_PAGE_SIZE = 4096;
+    static constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+    static constexpr size_t round_up(size_t n, size_t align) noexcept
+    {
+        return (n + align - 1) & ~(align - 1);
+    }
+
+    /**
+     * @brief NUMA node of the cpu this thread runs on, 0 if unknown
+     */
+    static int current_node() noexcept
+    {
+        unsigned cpu = 0, node = 0;
+        if (syscall(SYS_getcpu, &cpu, &node, nullptr) < 0)
+            return 0;
+        return node;
+    }
+
+    /**
+     * @brief bind [addr, addr + len) to a node, before it is faulted in
+     *
+     * @param addr page aligned
+     */
+    static bool bind(void *addr, size_t len, int node) noexcept
+    {
+        if (node < 0)
+            return false;
+        unsigned long mask[16] = {};
+        if (size_t(node) >= sizeof mask * 8)
+            return false;
+        mask[node / (sizeof(unsigned long) * 8)] = 1UL << (node % (sizeof(unsigned long) * 8));
+        if (syscall(SYS_mbind, addr, len, MPOL_BIND, mask, sizeof mask * 8, MPOL_MF_MOVE) < 0)
+        {
+            std::cerr << "mbind node " << node << " failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    static bool lock(void *addr, size_t len) noexcept
+    {
+        if (mlock(addr, len) < 0)
+        {
+            std::cerr << "mlock " << len << " bytes failed: " << strerror(errno)
+                      << " (raise RLIMIT_MEMLOCK)" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief write every page once so it is mapped now rather than on first use
+     * keeps the content, the mapping may be a file
+     */
+    static void prefault(void *addr, size_t len, size_t page = SMALL_PAGE_SIZE) noexcept
+    {
+        auto p = static_cast<volatile char *>(addr);
+        for (size_t off = 0; off < len; off += page)
+            p[off] = p[off];
+    }
+
+    /**
+     * @brief bind, lock and pre-fault a mapping not made by an Arena
+     *
+     * @param node -1 for the node of the calling thread
+     */
+    static bool prepare(void *addr, size_t len, int node = -1) noexcept
+    {
+        bind(addr, len, node < 0 ? current_node() : node);
+        auto locked = lock(addr, len);
+        prefault(addr, len);
+        return locked;
+    }
+
+    class Arena
+    {
+    public:
+        /**
+         * @brief map, bind, lock and pre-fault an arena
+         *
+         * @param size bytes, rounded up to a huge page
+         * @param node NUMA node, -1 for the node of the calling thread
+         * @return nullptr if no memory could be mapped
+         */
+        static std::unique_ptr<Arena> create(size_t size, int node = -1)
+        {
+            if (node < 0)
+                node = current_node();
+            size = round_up(size, HUGE_PAGE_SIZE);
+
+            // huge pages are allocated when faulted, so bind first and let
+            // mlock fault them, it fails instead of raising SIGBUS if the
+            // node has none left
+            void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (p != MAP_FAILED)
+            {
+                auto bound = bind(p, size, node);
+                if (mlock(p, size) == 0)
+                {
+                    prefault(p, size, HUGE_PAGE_SIZE);
+                    return std::unique_ptr<Arena>(new Arena(p, size, node, true, bound, true));
+                }
+                munmap(p, size);
+            }
+
+            p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+            {
+                perror("arena mmap");
+                return nullptr;
+            }
+#ifdef MADV_HUGEPAGE
+            madvise(p, size, MADV_HUGEPAGE);
+#endif
+            auto bound = bind(p, size, node);
+            auto locked = lock(p, size);
+            prefault(p, size);
+            return std::unique_ptr<Arena>(new Arena(p, size, node, false, bound, locked));
+        }
+
+        ~Arena()
+        {
+            munmap(base, cap);
+        }
+
+        Arena(const Arena &) = delete;
+        Arena &operator=(const Arena &) = delete;
+
+        /**
+         * @brief bump allocate, aborts when the arena is full
+         *
+         * @param align a power of two
+         */
+        void *allocate(size_t size, size_t align = 64) noexcept
+        {
+            auto off = round_up(used, align);
+            if (off + size > cap)
+            {
+                std::cerr << "arena full: " << size << " bytes requested, "
+                          << cap - used << " free" << std::endl;
+                abort();
+            }
+            used = off + size;
+            return base + off;
+        }
+
+        /**
+         * @brief zeroed buffer, e.g. a receive msg_buf
+         */
+        char *buffer(size_t size, size_t align = 64) noexcept
+        {
+            auto p = static_cast<char *>(allocate(size, align));
+            memset(p, 0, size);
+            return p;
+        }
+
+        /**
+         * @brief construct a T in the arena, it is never destroyed
+         */
+        template <typename T, typename... Args>
+        T *make(Args &&...args)
+        {
+            static_assert(std::is_trivially_destructible_v<T>, "the arena does not run destructors");
+            void *p = allocate(sizeof(T), alignof(T) > 64 ? alignof(T) : 64);
+            return new (p) T(std::forward<Args>(args)...);
+        }
+
+        size_t size() const noexcept { return cap; }
+        size_t available() const noexcept { return cap - used; }
+        int node() const noexcept { return numa_node; }
+        bool huge_pages() const noexcept { return huge; }
+        bool bound() const noexcept { return is_bound; }
+        bool locked() const noexcept { return is_locked; }
+
+    private:
+        Arena(void *_base, size_t _cap, int _node, bool _huge, bool _bound, bool _locked)
+            : base(static_cast<char *>(_base)), cap(_cap), numa_node(_node),
+              huge(_huge), is_bound(_bound), is_locked(_locked)
+        {
+        }
+
+        char *base;
+        size_t cap;
+        size_t used = 0;
+        int numa_node;
+        bool huge;
+        bool is_bound;
+        bool is_locked;
+    };
+}
@@ -170,9 +170,27 @@ namespace m2::ilink
         return headers;
     }
 
+    /**
+     * @brief receives every audit record, one value per Audit column,
+     * empty where the column does not apply.
+     * columnar::Writer in audit_columnar.hpp stores them compactly.
+     *
+     * write() must be thread safe: every encoder audits on the thread
+     * that encodes, e.g. the producers of submit.hpp's ReserveSubmitter
+     * call it concurrently.
+     */
+    struct AuditSink
+    {
+        virtual void write(const std::vector<std::any> &val_arr) = 0;
+        virtual ~AuditSink() = default;
+    };
+
+    inline AuditSink *audit_sink = nullptr;
+
     static void send_audit_msg(const std::vector<std::any> &val_arr)
     {
-        // print the audit message
+        if (audit_sink)
+            audit_sink->write(val_arr);
     }
 
 }
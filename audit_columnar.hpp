@@ -0,0 +1,737 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <any>
+#include <charconv>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+#include "audit.hpp"
+
+/***************************************************************
+ *
+ * Columnar audit trail
+ *
+ * Audit records are 54 columns, most of them empty or repeating
+ * (FirmID, SessionID, Location, Country of Origin) and the rest
+ * mostly increasing (timestamps, OrderRequestIDs). Writer stores them
+ * column by column in blocks of BLOCK_ROWS records:
+ *
+ *   file    : file_header_t, then blocks
+ *   block   : block_header_t, then one stream per column
+ *   column  : runs, each a varint (count << 3 | kind) followed by
+ *             the items of the run
+ *
+ *   NULL    count empty cells, no items
+ *   REPEAT  count copies of the last value of the column
+ *   INT     count zigzag varint deltas from the last integer
+ *   UINT    as INT, printed unsigned
+ *   DOUBLE  count items, the bits xor the last double as a varint
+ *           of its trailing zero count + 1 (0 if equal) and a varint
+ *           of the bits above them
+ *   STRING  count items, a varint (index << 1) into the column
+ *           dictionary, or a varint (suffix length << 1 | 1), a varint
+ *           prefix length shared with the last new string, and the
+ *           suffix. New strings are added to the dictionary.
+ *
+ * The last values and dictionaries carry over from block to block.
+ * A dictionary is cleared when it reaches DICT_MAX strings, the reader
+ * does the same so both stay in step.
+ *
+ * Install a writer as the audit sink:
+ *
+ *   columnar::Writer audit_writer("audit.col");
+ *   m2::ilink::audit_sink = &audit_writer;
+ *
+ * and convert at end of day with Reader::to_csv(), see
+ * tools/ilink_audit_csv.cpp. Records are kept in memory until a block
+ * is full, flush() writes a partial block.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::columnar
+{
+    constexpr uint64_t MAGIC = 0x4c4f435449445541ULL; // AUDITCOL
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t COLUMNS = size_t(Audit::END);
+    constexpr size_t BLOCK_ROWS = 4096;
+    constexpr size_t DICT_MAX = 65536;
+
+    // const char * values are SBE String20 fields or literals
+    constexpr size_t CSTR_MAX = 20;
+
+    enum Kind : uint8_t
+    {
+        NUL = 0,
+        REPEAT = 1,
+        INT = 2,
+        UINT = 3,
+        DOUBLE = 4,
+        STRING = 5
+    };
+
+    struct file_header_t
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t columns;
+    };
+
+    struct block_header_t
+    {
+        uint32_t rows;
+        uint32_t column_bytes[COLUMNS];
+    };
+
+    static inline void put_varint(std::string &out, uint64_t v)
+    {
+        while (v >= 0x80)
+        {
+            out.push_back(char(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back(char(v));
+    }
+
+    static inline uint64_t get_varint(const char *&p, const char *end) noexcept
+    {
+        uint64_t v = 0;
+        for (int shift = 0; p < end && shift < 64; shift += 7)
+        {
+            auto b = uint8_t(*p++);
+            v |= uint64_t(b & 0x7f) << shift;
+            if (!(b & 0x80))
+                break;
+        }
+        return v;
+    }
+
+    static inline uint64_t zigzag(int64_t v) noexcept { return (uint64_t(v) << 1) ^ uint64_t(v >> 63); }
+    static inline int64_t unzigzag(uint64_t v) noexcept { return int64_t(v >> 1) ^ -int64_t(v & 1); }
+
+    /**
+     * @brief one audit value
+     */
+    struct value_t
+    {
+        Kind kind = NUL;
+        uint64_t bits = 0; // INT, UINT, DOUBLE
+        std::string_view str;
+    };
+
+    /**
+     * @brief the value held by an audit std::any
+     */
+    static value_t to_value(const std::any &a)
+    {
+        value_t v;
+        if (!a.has_value())
+            return v;
+
+        auto &t = a.type();
+        auto as_int = [&](int64_t i)
+        { v.kind = INT; v.bits = uint64_t(i); };
+        auto as_uint = [&](uint64_t u)
+        { v.kind = UINT; v.bits = u; };
+        auto as_str = [&](std::string_view s)
+        { v.kind = STRING; v.str = s; };
+
+        if (t == typeid(std::string))
+            as_str(*std::any_cast<std::string>(&a));
+        else if (t == typeid(const char *))
+        {
+            auto s = std::any_cast<const char *>(a);
+            as_str(std::string_view(s, strnlen(s, CSTR_MAX)));
+        }
+        else if (t == typeid(char *))
+        {
+            auto s = std::any_cast<char *>(a);
+            as_str(std::string_view(s, strnlen(s, CSTR_MAX)));
+        }
+        else if (t == typeid(std::string_view))
+            as_str(std::any_cast<std::string_view>(a));
+        else if (t == typeid(char))
+            as_str(std::string_view(std::any_cast<char>(&a), 1));
+        else if (t == typeid(bool))
+            as_uint(std::any_cast<bool>(a));
+        else if (t == typeid(uint8_t))
+            as_uint(std::any_cast<uint8_t>(a));
+        else if (t == typeid(uint16_t))
+            as_uint(std::any_cast<uint16_t>(a));
+        else if (t == typeid(uint32_t))
+            as_uint(std::any_cast<uint32_t>(a));
+        else if (t == typeid(unsigned long))
+            as_uint(std::any_cast<unsigned long>(a));
+        else if (t == typeid(unsigned long long))
+            as_uint(std::any_cast<unsigned long long>(a));
+        else if (t == typeid(int8_t))
+            as_int(std::any_cast<int8_t>(a));
+        else if (t == typeid(int16_t))
+            as_int(std::any_cast<int16_t>(a));
+        else if (t == typeid(int32_t))
+            as_int(std::any_cast<int32_t>(a));
+        else if (t == typeid(long))
+            as_int(std::any_cast<long>(a));
+        else if (t == typeid(long long))
+            as_int(std::any_cast<long long>(a));
+        else if (t == typeid(double) || t == typeid(float))
+        {
+            double d = t == typeid(double) ? std::any_cast<double>(a) : std::any_cast<float>(a);
+            v.kind = DOUBLE;
+            memcpy(&v.bits, &d, sizeof d);
+        }
+        return v;
+    }
+
+    /**
+     * @brief encoder state of one column
+     */
+    class ColumnWriter
+    {
+    public:
+        void add(const value_t &v)
+        {
+            if (v.kind == NUL)
+                return item(NUL, nullptr);
+            if (has_last && v.kind == last_kind && v.bits == last_bits && v.str == last_str)
+                return item(REPEAT, nullptr);
+
+            scratch.clear();
+            switch (v.kind)
+            {
+            case INT:
+            case UINT:
+                put_varint(scratch, zigzag(int64_t(v.bits - last_int)));
+                last_int = v.bits;
+                break;
+            case DOUBLE:
+            {
+                auto x = v.bits ^ last_double;
+                if (x)
+                {
+                    auto tz = __builtin_ctzll(x);
+                    put_varint(scratch, tz + 1);
+                    put_varint(scratch, x >> tz);
+                }
+                else
+                    put_varint(scratch, 0);
+                last_double = v.bits;
+                break;
+            }
+            case STRING:
+            {
+                auto it = dict.find(std::string(v.str));
+                if (it != dict.end())
+                    put_varint(scratch, uint64_t(it->second) << 1);
+                else
+                {
+                    size_t prefix = 0;
+                    while (prefix < v.str.size() && prefix < last_new.size() && v.str[prefix] == last_new[prefix])
+                        ++prefix;
+                    put_varint(scratch, (uint64_t(v.str.size() - prefix) << 1) | 1);
+                    put_varint(scratch, prefix);
+                    scratch.append(v.str.substr(prefix));
+                    last_new.assign(v.str);
+                    if (dict.size() == DICT_MAX)
+                        dict.clear();
+                    auto idx = uint32_t(dict.size());
+                    dict.emplace(std::string(v.str), idx);
+                }
+                break;
+            }
+            default:
+                break;
+            }
+            has_last = true;
+            last_kind = v.kind;
+            last_bits = v.bits;
+            last_str.assign(v.str);
+            item(v.kind, &scratch);
+        }
+
+        /**
+         * @brief encoded stream of the block, the column state carries on
+         */
+        const std::string &finish()
+        {
+            close_run();
+            return out;
+        }
+
+        void reset_block()
+        {
+            out.clear();
+        }
+
+    private:
+        void item(Kind kind, const std::string *bytes)
+        {
+            if (run_len && kind != run_kind)
+                close_run();
+            run_kind = kind;
+            ++run_len;
+            if (bytes)
+                run.append(*bytes);
+        }
+
+        void close_run()
+        {
+            if (!run_len)
+                return;
+            put_varint(out, (uint64_t(run_len) << 3) | run_kind);
+            out.append(run);
+            run.clear();
+            run_len = 0;
+        }
+
+        std::string out;
+        std::string run;
+        std::string scratch;
+        Kind run_kind = NUL;
+        uint32_t run_len = 0;
+
+        bool has_last = false;
+        Kind last_kind = NUL;
+        uint64_t last_bits = 0;
+        std::string last_str;
+        uint64_t last_int = 0;
+        uint64_t last_double = 0;
+        std::string last_new;
+        std::unordered_map<std::string, uint32_t> dict;
+    };
+
+    /**
+     * @brief audit sink appending records to a columnar file
+     */
+    class Writer : public AuditSink
+    {
+    public:
+        /**
+         * @param path audit file, truncated
+         */
+        explicit Writer(const std::string &path)
+        {
+            fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+            {
+                perror("audit open");
+                abort();
+            }
+            file_header_t fh{MAGIC, VERSION, uint32_t(COLUMNS)};
+            put(&fh, sizeof fh);
+        }
+
+        ~Writer()
+        {
+            flush();
+            ::close(fd);
+        }
+
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        void write(const std::vector<std::any> &val_arr) override
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t c = 0; c < COLUMNS; ++c)
+                columns[c].add(c < val_arr.size() ? to_value(val_arr[c]) : value_t{});
+            if (++rows == BLOCK_ROWS)
+                write_block();
+        }
+
+        /**
+         * @brief write the records held in memory as a block
+         */
+        void flush()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (rows)
+                write_block();
+        }
+
+        uint64_t records() const noexcept { return total_rows; }
+        uint64_t bytes() const noexcept { return total_bytes; }
+
+    private:
+        void write_block()
+        {
+            block_header_t bh;
+            bh.rows = rows;
+            block.clear();
+            for (size_t c = 0; c < COLUMNS; ++c)
+            {
+                auto &s = columns[c].finish();
+                bh.column_bytes[c] = uint32_t(s.size());
+                block.append(s);
+                columns[c].reset_block();
+            }
+            put(&bh, sizeof bh);
+            put(block.data(), block.size());
+            total_rows += rows;
+            rows = 0;
+        }
+
+        void put(const void *p, size_t n)
+        {
+            auto c = static_cast<const char *>(p);
+            while (n)
+            {
+                auto w = ::write(fd, c, n);
+                if (w < 0)
+                {
+                    perror("audit write");
+                    abort();
+                }
+                c += w;
+                n -= w;
+                total_bytes += w;
+            }
+        }
+
+        int fd = -1;
+        std::mutex mutex;
+        ColumnWriter columns[COLUMNS];
+        std::string block;
+        uint32_t rows = 0;
+        uint64_t total_rows = 0;
+        uint64_t total_bytes = 0;
+    };
+
+    /**
+     * @brief streaming decoder of a columnar audit file
+     */
+    class Reader
+    {
+    public:
+        explicit Reader(const std::string &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                perror("audit open");
+                return;
+            }
+            struct stat st;
+            if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(file_header_t))
+            {
+                void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    base = static_cast<const char *>(p);
+                    mapped = st.st_size;
+                }
+            }
+            ::close(fd);
+            if (!base)
+                return;
+            auto fh = reinterpret_cast<const file_header_t *>(base);
+            if (fh->magic != MAGIC || fh->version != VERSION || fh->columns != COLUMNS)
+            {
+                std::cerr << "audit: bad file header " << path << std::endl;
+                munmap(const_cast<char *>(base), mapped);
+                base = nullptr;
+                return;
+            }
+            madvise(const_cast<char *>(base), mapped, MADV_SEQUENTIAL);
+        }
+
+        ~Reader()
+        {
+            if (base)
+                munmap(const_cast<char *>(base), mapped);
+        }
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        bool ok() const noexcept { return base != nullptr; }
+
+        /**
+         * @brief call f(const value_t *row) for every record, COLUMNS values per row.
+         * Strings are valid during the call.
+         * @return records decoded
+         */
+        template <typename F>
+        uint64_t for_each(F &&f)
+        {
+            if (!base)
+                return 0;
+            for (auto &c : columns)
+                c = column_state_t{};
+
+            uint64_t total = 0;
+            std::vector<cell_t> cells;
+            std::vector<value_t> row(COLUMNS);
+            size_t pos = sizeof(file_header_t);
+            while (pos + sizeof(block_header_t) <= mapped)
+            {
+                block_header_t bh;
+                memcpy(&bh, base + pos, sizeof bh);
+                size_t bytes = 0;
+                for (auto n : bh.column_bytes)
+                    bytes += n;
+                pos += sizeof bh;
+                if (pos + bytes > mapped)
+                    break; // incomplete last block
+
+                cells.resize(size_t(bh.rows) * COLUMNS);
+                auto p = base + pos;
+                for (size_t c = 0; c < COLUMNS; ++c)
+                {
+                    decode_column(columns[c], p, p + bh.column_bytes[c], &cells[c * bh.rows], bh.rows);
+                    p += bh.column_bytes[c];
+                }
+                pos += bytes;
+
+                for (size_t r = 0; r < bh.rows; ++r)
+                {
+                    for (size_t c = 0; c < COLUMNS; ++c)
+                    {
+                        auto &cell = cells[c * bh.rows + r];
+                        row[c].kind = cell.kind;
+                        row[c].bits = cell.bits;
+                        row[c].str = std::string_view(columns[c].arena.data() + cell.offset, cell.length);
+                    }
+                    f(row.data());
+                }
+                total += bh.rows;
+            }
+            return total;
+        }
+
+        /**
+         * @brief write the records as CSV, columns as in get_headers()
+         * @return records written
+         */
+        uint64_t to_csv(FILE *out, bool header = true)
+        {
+            std::string buf;
+            buf.reserve(OUT_BUFFER_SIZE + 4096);
+            if (header)
+            {
+                auto headers = get_headers();
+                for (size_t c = 0; c < headers.size(); ++c)
+                {
+                    if (c)
+                        buf.push_back(',');
+                    buf.append(headers[c]);
+                }
+                buf.push_back('\n');
+            }
+            auto n = for_each([&](const value_t *row)
+                              {
+                                  for (size_t c = 0; c < COLUMNS; ++c)
+                                  {
+                                      if (c)
+                                          buf.push_back(',');
+                                      append_csv(buf, row[c]);
+                                  }
+                                  buf.push_back('\n');
+                                  if (buf.size() >= OUT_BUFFER_SIZE)
+                                  {
+                                      fwrite(buf.data(), 1, buf.size(), out);
+                                      buf.clear();
+                                  } });
+            fwrite(buf.data(), 1, buf.size(), out);
+            return n;
+        }
+
+    private:
+        static constexpr size_t OUT_BUFFER_SIZE = 1 << 20;
+
+        struct column_state_t
+        {
+            Kind last_kind = NUL;
+            uint64_t last_bits = 0;
+            std::string last_str;
+            uint64_t last_int = 0;
+            uint64_t last_double = 0;
+            std::string last_new;
+            std::vector<std::string> dict;
+            std::string arena; // string cells of the current block
+        };
+
+        struct cell_t
+        {
+            Kind kind;
+            uint64_t bits;
+            uint32_t offset; // in column_state_t::arena
+            uint32_t length;
+        };
+
+        /**
+         * @brief decode the values of one column of a block into cells[0, rows)
+         */
+        static void decode_column(column_state_t &st, const char *p, const char *end, cell_t *cells, uint32_t rows)
+        {
+            st.arena.clear();
+            uint32_t r = 0;
+            while (p < end && r < rows)
+            {
+                auto h = get_varint(p, end);
+                auto kind = Kind(h & 7);
+                auto count = h >> 3;
+                for (uint64_t i = 0; i < count && r < rows; ++i, ++r)
+                {
+                    auto &cell = cells[r];
+                    cell = cell_t{NUL, 0, 0, 0};
+                    std::string_view str;
+                    switch (kind)
+                    {
+                    case NUL:
+                        continue;
+                    case REPEAT:
+                        cell.kind = st.last_kind;
+                        cell.bits = st.last_bits;
+                        str = st.last_str;
+                        break;
+                    case INT:
+                    case UINT:
+                        st.last_int += uint64_t(unzigzag(get_varint(p, end)));
+                        cell.kind = kind;
+                        cell.bits = st.last_int;
+                        break;
+                    case DOUBLE:
+                    {
+                        auto tz = get_varint(p, end);
+                        if (tz)
+                            st.last_double ^= get_varint(p, end) << (tz - 1);
+                        cell.kind = DOUBLE;
+                        cell.bits = st.last_double;
+                        break;
+                    }
+                    case STRING:
+                    {
+                        auto s = get_varint(p, end);
+                        cell.kind = STRING;
+                        if (s & 1)
+                        {
+                            auto suffix = size_t(s >> 1);
+                            auto prefix = size_t(get_varint(p, end));
+                            if (suffix > size_t(end - p))
+                                suffix = end - p;
+                            st.last_new.resize(prefix < st.last_new.size() ? prefix : st.last_new.size());
+                            st.last_new.append(p, suffix);
+                            p += suffix;
+                            if (st.dict.size() == DICT_MAX)
+                                st.dict.clear();
+                            st.dict.push_back(st.last_new);
+                            str = st.last_new;
+                        }
+                        else if ((s >> 1) < st.dict.size())
+                            str = st.dict[s >> 1];
+                        break;
+                    }
+                    default:
+                        continue;
+                    }
+                    if (kind != REPEAT)
+                    {
+                        st.last_kind = cell.kind;
+                        st.last_bits = cell.bits;
+                        st.last_str.assign(str);
+                    }
+                    cell.offset = uint32_t(st.arena.size());
+                    cell.length = uint32_t(str.size());
+                    st.arena.append(str);
+                }
+            }
+            for (; r < rows; ++r)
+                cells[r] = cell_t{NUL, 0, 0, 0};
+        }
+
+        static void append_csv(std::string &buf, const value_t &v)
+        {
+            char num[32];
+            switch (v.kind)
+            {
+            case INT:
+            case UINT:
+            {
+                auto r = v.kind == INT ? std::to_chars(num, num + sizeof num, int64_t(v.bits))
+                                       : std::to_chars(num, num + sizeof num, v.bits);
+                buf.append(num, r.ptr);
+                break;
+            }
+            case DOUBLE:
+            {
+                double d;
+                memcpy(&d, &v.bits, sizeof d);
+                auto r = std::to_chars(num, num + sizeof num, d);
+                buf.append(num, r.ptr);
+                break;
+            }
+            case STRING:
+                if (v.str.find_first_of(",\"\n") == std::string_view::npos)
+                    buf.append(v.str);
+                else
+                {
+                    buf.push_back('"');
+                    for (auto ch : v.str)
+                    {
+                        if (ch == '"')
+                            buf.push_back('"');
+                        buf.push_back(ch);
+                    }
+                    buf.push_back('"');
+                }
+                break;
+            default:
+                break;
+            }
+        }
+
+        const char *base = nullptr;
+        size_t mapped = 0;
+        column_state_t columns[COLUMNS];
+    };
+}
@@ -0,0 +1,313 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+/***************************************************************
+ *
+ * Cache misses per fill: CBIF::exec_report_param_t vs exec_report_t
+ *
+ * A fill handler reads OrdStatus, OrderID, SecurityID, Side, LastQty,
+ * lastPx, CumQty and LeavesQty. N reports (default 1M, larger than
+ * the LLC) are visited in a shuffled order, as fills for unrelated
+ * orders would be, once in each layout:
+ *
+ *   param    CBIF::exec_report_param_t, what process_message() hands
+ *            to the CBIF, fill fields spread over several lines
+ *   hot_cold exec_report_t from exec_report.hpp, fill fields in hot
+ *
+ * For each ns/fill and, where perf_event_open is allowed
+ * (perf_event_paranoid <= 2 or CAP_PERFMON), L1D read misses/fill and
+ * LLC misses/fill are printed. Otherwise the miss columns read n/a.
+ *
+ * build (from the directory containing ilink/ and the SBE headers):
+ *   g++ -std=c++17 -O2 -I. ilink/bench/exec_report_bench.cpp -o exec_report_bench
+ *
+ * run:
+ *   ./exec_report_bench [-n reports] [-r rounds]
+ *
+ * *************************************************************/
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ilink/ILinkCBIF.hpp"
+#include "ilink/exec_report.hpp"
+
+namespace
+{
+    using namespace m2::ilink;
+
+    inline uint64_t now_ns()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    /**
+     * @brief one hardware counter for this thread, -1 if not available
+     */
+    class Counter
+    {
+    public:
+        Counter(uint32_t type, uint64_t config)
+        {
+            struct perf_event_attr attr;
+            memset(&attr, 0, sizeof attr);
+            attr.size = sizeof attr;
+            attr.type = type;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+
+        ~Counter()
+        {
+            if (fd >= 0)
+                close(fd);
+        }
+
+        void start()
+        {
+            if (fd < 0)
+                return;
+            ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+
+        int64_t stop()
+        {
+            if (fd < 0)
+                return -1;
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t v = 0;
+            if (read(fd, &v, sizeof v) != sizeof v)
+                return -1;
+            return v;
+        }
+
+    private:
+        int fd;
+    };
+
+    struct fill_t
+    {
+        uint64_t qty = 0;
+        int64_t notional = 0;
+        uint64_t open = 0;
+        uint64_t ids = 0;
+    };
+
+    // what a fill handler reads, the same for both layouts
+
+    inline void on_fill(fill_t &f, const CBIF::exec_report_param_t &p)
+    {
+        if (p.OrdStatus[0] != '1' && p.OrdStatus[0] != '2')
+            return;
+        int64_t sign = p.Side == sbe::SideReq::Buy ? 1 : -1;
+        f.qty += p.LastQty;
+        f.notional += sign * int64_t(p.lastPx_mantissa) * p.LastQty;
+        f.open += p.LeavesQty - p.CumQty;
+        f.ids ^= p.OrderID + uint32_t(p.SecurityID);
+    }
+
+    inline void on_fill(fill_t &f, const exec_report_t &r)
+    {
+        auto &h = r.hot;
+        if (h.OrdStatus != '1' && h.OrdStatus != '2')
+            return;
+        int64_t sign = h.Side == sbe::SideReq::Buy ? 1 : -1;
+        f.qty += h.LastQty;
+        f.notional += sign * h.lastPx_mantissa * h.LastQty;
+        f.open += h.LeavesQty - h.CumQty;
+        f.ids ^= h.OrderID + uint32_t(h.SecurityID);
+    }
+
+    void fill_param(CBIF::exec_report_param_t &p, size_t i)
+    {
+        char buf[64];
+        p.templateId = 525;
+        p.UUID = 1;
+        p.SeqNum = i;
+        snprintf(buf, sizeof buf, "%040zu", i);
+        p.ExecID = buf;
+        p.SenderID = "SENDER";
+        snprintf(buf, sizeof buf, "CL%018zu", i);
+        p.ClOrdID = buf;
+        p.OrderID = 1000000 + i;
+        p.Price_mantissa = p.lastPx_mantissa = (4000 + i % 100) * 1000000000LL;
+        p.OrderRequestID = i;
+        p.Location = "US,IL";
+        p.SecurityID = 1000 + i % 64;
+        p.OrderQty = 10;
+        p.LastQty = 1 + i % 5;
+        p.CumQty = p.LastQty;
+        p.LeavesQty = p.OrderQty - p.CumQty;
+        p.Side = i & 1 ? sbe::SideReq::Buy : sbe::SideReq::Sell;
+        p.OrdStatus = p.LeavesQty ? "1" : "2";
+        p.ExecType = "F";
+    }
+
+    void fill_hot_cold(exec_report_t &r, const CBIF::exec_report_param_t &p)
+    {
+        memset(&r, 0, sizeof r);
+        r.hot.templateId = p.templateId;
+        r.hot.OrdStatus = p.OrdStatus[0];
+        r.hot.ExecType = p.ExecType[0];
+        r.hot.SeqNum = p.SeqNum;
+        r.hot.OrderID = p.OrderID;
+        r.hot.lastPx_mantissa = p.lastPx_mantissa;
+        r.hot.Price_mantissa = p.Price_mantissa;
+        r.hot.SecurityID = p.SecurityID;
+        r.hot.LeavesQty = p.LeavesQty;
+        r.hot.CumQty = p.CumQty;
+        r.hot.LastQty = p.LastQty;
+        r.hot.OrderRequestID = p.OrderRequestID;
+        r.hot.Side = p.Side;
+        r.cold.UUID = p.UUID;
+        r.cold.OrderQty = p.OrderQty;
+        memcpy(r.cold.ExecID, p.ExecID.data(), std::min(p.ExecID.size(), sizeof r.cold.ExecID));
+        memcpy(r.cold.ClOrdID, p.ClOrdID.data(), std::min(p.ClOrdID.size(), sizeof r.cold.ClOrdID));
+        memcpy(r.cold.SenderID, p.SenderID.data(), std::min(p.SenderID.size(), sizeof r.cold.SenderID));
+        memcpy(r.cold.Location, p.Location.data(), std::min(p.Location.size(), sizeof r.cold.Location));
+    }
+
+    // evict the reports from the cache between rounds
+    void flush_cache()
+    {
+        static std::vector<char> junk(64 << 20);
+        for (size_t i = 0; i < junk.size(); i += 64)
+            junk[i]++;
+    }
+
+    template <typename T>
+    void run(const char *name, const std::vector<T> &reports, const std::vector<uint32_t> &order, int rounds)
+    {
+        Counter l1d(PERF_TYPE_HW_CACHE,
+                    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+        Counter llc(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+
+        fill_t f;
+        uint64_t ns = 0;
+        int64_t l1d_misses = 0, llc_misses = 0;
+        for (int r = 0; r < rounds; ++r)
+        {
+            flush_cache();
+            l1d.start();
+            llc.start();
+            auto t0 = now_ns();
+            for (auto i : order)
+                on_fill(f, reports[i]);
+            ns += now_ns() - t0;
+            auto a = l1d.stop(), b = llc.stop();
+            l1d_misses = a < 0 || l1d_misses < 0 ? -1 : l1d_misses + a;
+            llc_misses = b < 0 || llc_misses < 0 ? -1 : llc_misses + b;
+        }
+
+        double fills = double(order.size()) * rounds;
+        printf("%-10s %6zu B %10.2f", name, sizeof(T), ns / fills);
+        if (l1d_misses < 0)
+            printf(" %14s", "n/a");
+        else
+            printf(" %14.3f", l1d_misses / fills);
+        if (llc_misses < 0)
+            printf(" %14s", "n/a");
+        else
+            printf(" %14.3f", llc_misses / fills);
+        // keep the handler from being optimized away
+        printf("   (%llu)\n", (unsigned long long)(f.qty ^ f.notional ^ f.open ^ f.ids));
+    }
+
+    [[noreturn]] void usage(const char *prog)
+    {
+        fprintf(stderr, "usage: %s [-n reports] [-r rounds]\n", prog);
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = 1000000;
+    int rounds = 5;
+    int c;
+    while ((c = getopt(argc, argv, "n:r:")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            n = strtoull(optarg, nullptr, 10);
+            break;
+        case 'r':
+            rounds = atoi(optarg);
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    std::vector<CBIF::exec_report_param_t> params(n);
+    std::vector<exec_report_t> hot_cold(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        fill_param(params[i], i);
+        fill_hot_cold(hot_cold[i], params[i]);
+    }
+
+    std::vector<uint32_t> order(n);
+    for (size_t i = 0; i < n; ++i)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+    printf("%zu reports, %d rounds\n", n, rounds);
+    printf("%-10s %8s %10s %14s %14s\n", "layout", "size", "ns/fill", "L1D miss/fill", "LLC miss/fill");
+    run("param", params, order, rounds);
+    run("hot_cold", hot_cold, order, rounds);
+    return 0;
+}
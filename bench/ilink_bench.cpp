@@ -0,0 +1,704 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+/***************************************************************
+ *
+ * Micro benchmarks for the iLink3 codec
+ *
+ * Every ILinkSnd::send_* method is run against a discard transport
+ * (a unix socketpair drained by a second thread) and a canned frame
+ * for every template handled by receiver::process_message() is decoded
+ * into a NullCBIF, once with the default decode policy and once with
+ * receiver::TrustedDecode (the *_trusted benchmarks). Build with
+ * -DSBE_NO_BOUNDS_CHECK to see the trusted decoders without the per field
+ * checks of the generated code. The round trip benchmarks send through the in-process
+ * transport into sim::MatchingEngine and decode its execution reports.
+ *
+ * For each benchmark ns/op, cycles/op and heap allocations/op are printed.
+ *
+ * build (from the directory containing ilink/ and the SBE headers):
+ *   g++ -std=c++17 -O2 -I. ilink/bench/ilink_bench.cpp -lcryptopp -lpthread -o ilink_bench
+ *
+ * run:
+ *   ./ilink_bench                          print results
+ *   ./ilink_bench -s bench/baseline.txt    save results as baseline
+ *   ./ilink_bench -b bench/baseline.txt    compare against a baseline
+ *   ./ilink_bench -n 1000000 -f decode     iterations and name filter
+ *
+ * *************************************************************/
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <any>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ilink/ILinkSnd.hpp"
+#include "ilink/ILinkRcv.hpp"
+#include "ilink/inproc.hpp"
+#include "ilink/matching_engine.hpp"
+
+//
+// count heap allocations made by the benchmark thread
+//
+
+static thread_local uint64_t alloc_count = 0;
+
+void *operator new(size_t sz)
+{
+    ++alloc_count;
+    if (void *p = malloc(sz ? sz : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t sz)
+{
+    ++alloc_count;
+    if (void *p = malloc(sz ? sz : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+namespace
+{
+    using namespace m2::ilink;
+
+    inline uint64_t read_cycles()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return 0;
+#endif
+    }
+
+    inline uint64_t now_ns()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    struct result_t
+    {
+        double ns;
+        double cycles;
+        double allocs;
+    };
+
+    /**
+     * @brief the discard transport
+     * a socketpair with a thread reading and dropping everything
+     */
+    class DiscardSocket
+    {
+    public:
+        DiscardSocket()
+        {
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+            {
+                perror("socketpair");
+                abort();
+            }
+            int sz = 4 * 1024 * 1024;
+            setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sz, sizeof sz);
+            setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &sz, sizeof sz);
+            drain = std::thread([this]
+                                {
+                                    char buf[65536];
+                                    while (read(fds[1], buf, sizeof buf) > 0)
+                                        ;
+                                });
+        }
+
+        ~DiscardSocket()
+        {
+            shutdown(fds[0], SHUT_RDWR);
+            close(fds[0]);
+            drain.join();
+            close(fds[1]);
+        }
+
+        int sock() const noexcept { return fds[0]; }
+
+    private:
+        int fds[2];
+        std::thread drain;
+    };
+
+    /**
+     * @brief a received message as process_message() sees it
+     */
+    struct frame_t
+    {
+        sockhelp::cme_msg_header_t header;
+        std::vector<char> body;
+    };
+
+    template <typename M, typename F>
+    frame_t make_frame(F &&fill, size_t extra = 0)
+    {
+        std::vector<char> buf(4096, 0);
+        M m;
+        m.wrapAndApplyHeader(buf.data(), 0, buf.size());
+        fill(m);
+        auto hdr_len = sbe::MessageHeader::encodedLength();
+        frame_t f;
+        f.header.MsgSize = m.encodedLength() + sockhelp::SOFH_AND_SBE_HEADER_SIZE + extra;
+        f.header.EncodingType = 0xCAFE;
+        f.header.BlockLength = M::sbeBlockLength();
+        f.header.TemplateID = M::sbeTemplateId();
+        f.header.SchemaID = M::sbeSchemaId();
+        f.header.Version = M::sbeSchemaVersion();
+        f.body.assign(buf.begin() + hdr_len, buf.end() - hdr_len);
+        return f;
+    }
+
+    //
+    // fields shared by the execution reports
+    //
+    template <typename M>
+    void fill_order(M &m)
+    {
+        m.seqNum(1000);
+        m.uUID(1);
+        m.putExecID(std::string("123456789012345"));
+        m.putSenderID(std::string("SENDER"));
+        m.putClOrdID(std::string("CLORD0000001"));
+        m.partyDetailsListReqID(42);
+        m.orderID(987654321);
+        m.transactTime(1700000000000000000ULL);
+        m.sendingTimeEpoch(1700000000000000000ULL);
+        m.putLocation(std::string("US,IL"));
+        m.securityID(12345);
+        m.side(sbe::SideReq::Buy);
+        m.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+        m.possRetransFlag(sbe::BooleanFlag::False);
+    }
+
+    template <typename M>
+    void fill_order_terms(M &m)
+    {
+        m.price().mantissa(4500250000000LL);
+        m.stopPx().mantissa(sbe::PRICENULL9::mantissaNullValue());
+        m.orderRequestID(77);
+        m.orderQty(10);
+        m.ordType(sbe::OrderType::Limit);
+        m.timeInForce(sbe::TimeInForce::Day);
+    }
+
+    std::vector<std::pair<std::string, frame_t>> make_frames()
+    {
+        std::vector<std::pair<std::string, frame_t>> frames;
+
+        frames.emplace_back("decode_Sequence506", make_frame<sbe::Sequence506>([](auto &m)
+            {
+                m.uUID(1);
+                m.nextSeqNo(100);
+                m.faultToleranceIndicator(sbe::FTI::Primary);
+                m.keepAliveIntervalLapsed(sbe::KeepAliveLapsed::NotLapsed);
+            }));
+        frames.emplace_back("decode_NegotiationResponse501", make_frame<sbe::NegotiationResponse501>([](auto &m)
+            {
+                m.uUID(1);
+                m.requestTimestamp(1700000000000000000ULL);
+                m.faultToleranceIndicator(sbe::FTI::Primary);
+                m.previousSeqNo(0);
+                m.previousUUID(0);
+            }, sockhelp::CRED_SZ));
+        frames.emplace_back("decode_NegotiationReject502", make_frame<sbe::NegotiationReject502>([](auto &m)
+            {
+                m.putReason(std::string("bad"));
+                m.uUID(1);
+                m.faultToleranceIndicator(sbe::FTI::Primary);
+            }));
+        frames.emplace_back("decode_EstablishmentAck504", make_frame<sbe::EstablishmentAck504>([](auto &m)
+            {
+                m.uUID(1);
+                m.nextSeqNo(1);
+                m.keepAliveInterval(10000);
+                m.faultToleranceIndicator(sbe::FTI::Primary);
+            }));
+        frames.emplace_back("decode_EstablishmentReject505", make_frame<sbe::EstablishmentReject505>([](auto &m)
+            {
+                m.putReason(std::string("bad"));
+                m.uUID(1);
+                m.faultToleranceIndicator(sbe::FTI::Primary);
+            }));
+        frames.emplace_back("decode_NotApplied513", make_frame<sbe::NotApplied513>([](auto &m)
+            {
+                m.uUID(1);
+                m.fromSeqNo(10);
+                m.msgCount(5);
+            }));
+        frames.emplace_back("decode_Retransmission509", make_frame<sbe::Retransmission509>([](auto &m)
+            {
+                m.uUID(1);
+                m.fromSeqNo(10);
+                m.msgCount(5);
+            }));
+        frames.emplace_back("decode_RetransmitReject510", make_frame<sbe::RetransmitReject510>([](auto &m)
+            {
+                m.putReason(std::string("bad"));
+                m.uUID(1);
+            }));
+        frames.emplace_back("decode_Terminate507", make_frame<sbe::Terminate507>([](auto &m)
+            {
+                m.putReason(std::string("bye"));
+                m.uUID(1);
+            }));
+        frames.emplace_back("decode_BusinessReject521", make_frame<sbe::BusinessReject521>([](auto &m)
+            {
+                m.seqNum(1);
+                m.uUID(1);
+                m.putText(std::string("rejected"));
+                m.possRetransFlag(sbe::BooleanFlag::False);
+            }));
+        frames.emplace_back("decode_ExecutionReportNew522", make_frame<sbe::ExecutionReportNew522>([](auto &m)
+            {
+                fill_order(m);
+                fill_order_terms(m);
+            }));
+        frames.emplace_back("decode_ExecutionReportModify531", make_frame<sbe::ExecutionReportModify531>([](auto &m)
+            {
+                fill_order(m);
+                fill_order_terms(m);
+                m.leavesQty(10);
+            }));
+        frames.emplace_back("decode_ExecutionReportCancel534", make_frame<sbe::ExecutionReportCancel534>([](auto &m)
+            {
+                fill_order(m);
+                fill_order_terms(m);
+            }));
+        frames.emplace_back("decode_ExecutionReportStatus532", make_frame<sbe::ExecutionReportStatus532>([](auto &m)
+            {
+                fill_order(m);
+                fill_order_terms(m);
+                m.ordStatus(sbe::OrdStatusTrd::New);
+                m.leavesQty(10);
+            }));
+        frames.emplace_back("decode_ExecutionReportTradeOutright525", make_frame<sbe::ExecutionReportTradeOutright525>([](auto &m)
+            {
+                fill_order(m);
+                fill_order_terms(m);
+                m.lastPx().mantissa(4500250000000LL);
+                m.lastQty(1);
+                m.cumQty(1);
+                m.leavesQty(9);
+                m.sideTradeID(5);
+            }));
+        frames.emplace_back("decode_ExecutionReportTradeSpread526", make_frame<sbe::ExecutionReportTradeSpread526>([](auto &m)
+            {
+                fill_order(m);
+                fill_order_terms(m);
+                m.lastPx().mantissa(250000000LL);
+                m.lastQty(1);
+                m.cumQty(1);
+                m.leavesQty(9);
+                m.sideTradeID(5);
+                m.noLegsCount(0);
+            }));
+        frames.emplace_back("decode_ExecutionReportElimination524", make_frame<sbe::ExecutionReportElimination524>([](auto &m)
+            {
+                fill_order(m);
+                fill_order_terms(m);
+            }));
+        frames.emplace_back("decode_ExecutionReportReject523", make_frame<sbe::ExecutionReportReject523>([](auto &m)
+            {
+                fill_order(m);
+                fill_order_terms(m);
+            }));
+        frames.emplace_back("decode_ExecutionReportTradeAddendumOutright548", make_frame<sbe::ExecutionReportTradeAddendumOutright548>([](auto &m)
+            {
+                fill_order(m);
+                m.lastPx().mantissa(4500250000000LL);
+                m.sideTradeID(6);
+                m.origSideTradeID(5);
+            }));
+        frames.emplace_back("decode_ExecutionReportTradeAddendumSpread549", make_frame<sbe::ExecutionReportTradeAddendumSpread549>([](auto &m)
+            {
+                fill_order(m);
+                m.ordType(sbe::OrderType::Limit);
+                m.lastPx().mantissa(250000000LL);
+                m.sideTradeID(6);
+                m.origSideTradeID(5);
+                m.noLegsCount(0);
+            }));
+        frames.emplace_back("decode_OrderCancelReject535", make_frame<sbe::OrderCancelReject535>([](auto &m)
+            {
+                m.seqNum(1000);
+                m.uUID(1);
+                m.putClOrdID(std::string("CLORD0000001"));
+                m.orderID(987654321);
+                m.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+                m.possRetransFlag(sbe::BooleanFlag::False);
+            }));
+        frames.emplace_back("decode_OrderCancelReplaceReject536", make_frame<sbe::OrderCancelReplaceReject536>([](auto &m)
+            {
+                m.seqNum(1000);
+                m.uUID(1);
+                m.putClOrdID(std::string("CLORD0000001"));
+                m.orderID(987654321);
+                m.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+                m.possRetransFlag(sbe::BooleanFlag::False);
+            }));
+        frames.emplace_back("decode_OrderMassActionReport562", make_frame<sbe::OrderMassActionReport562>([](auto &m)
+            {
+                m.seqNum(1000);
+                m.uUID(1);
+                m.massActionReportID(3);
+                m.massActionScope(sbe::MassActionScope::Instrument);
+                m.massActionResponse(sbe::MassActionResponse::Accepted);
+                m.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+                m.side(sbe::SideNULL::NULL_VALUE);
+                m.lastFragment(sbe::BooleanFlag::True);
+                m.possRetransFlag(sbe::BooleanFlag::False);
+                auto g = m.noAffectedOrdersCount(4);
+                for (int i = 0; i < 4; ++i)
+                {
+                    g.next();
+                    g.putOrigCIOrdID(std::string("CLORD0000001"));
+                    g.affectedOrderID(987654321 + i);
+                    g.cxlQuantity(1);
+                }
+            }));
+        frames.emplace_back("decode_MassQuoteAck545", make_frame<sbe::MassQuoteAck545>([](auto &m)
+            {
+                m.seqNum(1000);
+                m.uUID(1);
+                m.quoteID(9);
+                m.quoteStatus(sbe::QuoteAckStatus::Accepted);
+                m.possRetransFlag(sbe::BooleanFlag::False);
+                auto g = m.noQuoteEntriesCount(20);
+                for (int i = 0; i < 20; ++i)
+                {
+                    g.next();
+                    g.quoteEntryID(i);
+                    g.securityID(12345 + i);
+                    g.quoteSetID(1);
+                    g.quoteEntryRejectReason(UINT8_NULL);
+                }
+            }));
+        frames.emplace_back("decode_QuoteCancelAck563", make_frame<sbe::QuoteCancelAck563>([](auto &m)
+            {
+                m.seqNum(1000);
+                m.uUID(1);
+                m.quoteID(9);
+                m.quoteStatus(sbe::QuoteCxlStatus::CancelAll);
+                m.possRetransFlag(sbe::BooleanFlag::False);
+                m.noQuoteEntriesCount(0);
+                m.noQuoteSetsCount(0);
+            }));
+        frames.emplace_back("decode_PartyDetailsDefinitionRequestAck519", make_frame<sbe::PartyDetailsDefinitionRequestAck519>([](auto &m)
+            {
+                m.seqNum(1000);
+                m.uUID(1);
+                m.partyDetailsListReqID(42);
+                m.possRetransFlag(sbe::BooleanFlag::False);
+                auto g = m.noPartyDetailsCount(3);
+                for (int i = 0; i < 3; ++i)
+                {
+                    g.next();
+                    g.putPartyDetailID(std::string("FIRM"));
+                    g.partyDetailRole(sbe::PartyDetailRole::ExecutingFirm);
+                }
+                m.noTrdRegPublicationsCount(0);
+            }));
+        frames.emplace_back("decode_PartyDetailsListReport538", make_frame<sbe::PartyDetailsListReport538>([](auto &m)
+            {
+                m.seqNum(1000);
+                m.uUID(1);
+                m.partyDetailsListReqID(42);
+                auto g = m.noPartyDetailsCount(3);
+                for (int i = 0; i < 3; ++i)
+                {
+                    g.next();
+                    g.putPartyDetailID(std::string("FIRM"));
+                    g.partyDetailRole(sbe::PartyDetailRole::ExecutingFirm);
+                }
+                m.noTrdRegPublicationsCount(0);
+            }));
+
+        return frames;
+    }
+
+    template <typename F>
+    result_t run(size_t iterations, F &&f)
+    {
+        for (size_t i = 0; i < iterations / 10 + 1; ++i)
+            f();
+
+        auto allocs0 = alloc_count;
+        auto c0 = read_cycles();
+        auto t0 = now_ns();
+        for (size_t i = 0; i < iterations; ++i)
+            f();
+        auto t1 = now_ns();
+        auto c1 = read_cycles();
+        auto allocs1 = alloc_count;
+
+        return {
+            double(t1 - t0) / iterations,
+            double(c1 - c0) / iterations,
+            double(allocs1 - allocs0) / iterations};
+    }
+
+    std::map<std::string, result_t> load_baseline(const std::string &path)
+    {
+        std::map<std::string, result_t> baseline;
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream ss(line);
+            std::string name;
+            result_t r;
+            if (ss >> name >> r.ns >> r.cycles >> r.allocs)
+                baseline[name] = r;
+        }
+        return baseline;
+    }
+
+    void usage(const char *prog)
+    {
+        std::cerr << "usage: " << prog << " [-n iterations] [-f filter] [-b baseline] [-s save]" << std::endl;
+        exit(1);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t iterations = 200000;
+    std::string filter, baseline_path, save_path;
+    int c;
+    while ((c = getopt(argc, argv, "n:f:b:s:")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            iterations = strtoull(optarg, nullptr, 10);
+            break;
+        case 'f':
+            filter = optarg;
+            break;
+        case 'b':
+            baseline_path = optarg;
+            break;
+        case 's':
+            save_path = optarg;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    std::vector<std::pair<std::string, result_t>> results;
+    auto bench = [&](const std::string &name, auto &&f)
+    {
+        if (!filter.empty() && name.find(filter) == std::string::npos)
+            return;
+        results.emplace_back(name, run(iterations, f));
+    };
+
+    //
+    // encoders
+    //
+
+    DiscardSocket discard;
+    auto sock = discard.sock();
+    ILinkSnd snd(
+        10000,
+        "ACCOUNT",
+        "ACCESSKEYID0000000000",
+        "dGhpc2lzYXNlY3JldGtleWZvcnRoZWJlbmNobWFyaw",
+        "ABC",
+        "001",
+        "ilink_bench",
+        "1.0",
+        "m2",
+        "001",
+        "US,IL",
+        42);
+
+    bench("send_nogotiate_message", [&]
+          { snd.send_nogotiate_message(sock); });
+    bench("send_establish_message", [&]
+          { snd.send_establish_message(sock); });
+    bench("send_sequence", [&]
+          { snd.send_sequence(sock); });
+    bench("send_terminate", [&]
+          { snd.send_terminate(sock); });
+    bench("send_new_order_single", [&]
+          { snd.send_new_order_single(sock, 4500.25, 1, 12345, sbe::SideReq::Buy, "CLORD0000001", 0, 0, 0,
+                                      sbe::OrderTypeReq::Limit, sbe::TimeInForce::Day); });
+    bench("warm_up", [&]
+          { snd.warm_up(sock, 12345, 4500.25); });
+    armed_order_t armed;
+    snd.arm(armed, 12345, "CLORD0000001");
+    bench("fire", [&]
+          { snd.fire(sock, armed, sbe::SideReq::Buy, 4500250000000, 1); });
+    bench("send_cancel_replace", [&]
+          { snd.send_cancel_replace(sock, 4500.50, 1, 12345, sbe::SideReq::Buy, "CLORD0000001", 987654321, 0, 0, 0,
+                                    sbe::OrderTypeReq::Limit, sbe::TimeInForce::Day); });
+    bench("send_cancel", [&]
+          { snd.send_cancel(sock, 987654321, "CLORD0000001", 12345, sbe::SideReq::Buy); });
+    bench("send_order_mass_action", [&]
+          { snd.send_order_mass_action(sock, sbe::MassActionScope::Instrument, 12345, "", 0); });
+    std::vector<quote_entry_t> quotes(20);
+    for (size_t i = 0; i < quotes.size(); ++i)
+        quotes[i] = {100000000000LL, 101000000000LL, uint32_t(i), int32_t(12345 + i), 10, 10, 12000, 1};
+    bench("send_mass_quote_20", [&]
+          { snd.send_mass_quote(sock, 9, quotes.data(), quotes.size()); });
+    bench("send_quote_cancel", [&]
+          { snd.send_quote_cancel(sock, 9, sbe::QuoteCxlTyp::CancelAllQuotes); });
+    bench("send_order_status_request", [&]
+          { snd.send_order_status_request(sock, 987654321, 1); });
+    bench("send_order_mass_status_request", [&]
+          { snd.send_order_mass_status_request(sock, 1, sbe::MassStatusReqTyp::Instrument, 12345, "", 0); });
+    bench("send_party_details_definition", [&]
+          { snd.send_party_details_definition(sock, sbe::ListUpdAct::Add, "FIRM"); });
+    bench("send_retransmission_request", [&]
+          { snd.send_retransmission_request(sock, 1, 100); });
+    bench("send_party_details_list_request", [&]
+          { snd.send_party_details_list_request(sock, 42, "FIRM"); });
+
+    //
+    // decoders
+    //
+
+    NullCBIF cbif;
+    auto frames = make_frames();
+    for (auto &[name, frame] : frames)
+    {
+        bench(name, [&]
+              { receiver::process_message(&frame.header, frame.body.data(), &cbif); });
+        bench(name + "_trusted", [&]
+              { receiver::process_message<receiver::TrustedDecode>(&frame.header, frame.body.data(), &cbif); });
+    }
+
+    //
+    // encode, match, decode
+    //
+
+    inproc::Channel channel;
+    sim::MatchingEngine engine(&channel.exchange);
+    ILinkSndT<inproc::InprocTransport> isnd(
+        10000,
+        "ACCOUNT",
+        "ACCESSKEYID0000000000",
+        "dGhpc2lzYXNlY3JldGtleWZvcnRoZWJlbmNobWFyaw",
+        "ABC",
+        "001",
+        "ilink_bench",
+        "1.0",
+        "m2",
+        "001",
+        "US,IL",
+        42);
+    std::vector<char> rcv_buf(64 * 1024);
+    auto drain = [&]
+    {
+        engine.poll();
+        while (receiver::process_message_from_msgw<inproc::InprocTransport>(&channel.client, rcv_buf.data(), &cbif, false))
+            ;
+    };
+    engine.add_liquidity(12345, sbe::SideReq::Sell, 4500250000000LL, UINT32_MAX);
+    bench("round_trip_new_cancel", [&]
+          {
+              isnd.send_new_order_single(&channel.client, 4500.00, 1, 12345, sbe::SideReq::Buy, "CLORD0000001", 0, 0, 0,
+                                         sbe::OrderTypeReq::Limit, sbe::TimeInForce::Day);
+              isnd.send_cancel(&channel.client, 0, "CLORD0000001", 12345, sbe::SideReq::Buy);
+              drain(); });
+    bench("round_trip_new_fill", [&]
+          {
+              isnd.send_new_order_single(&channel.client, 4500.25, 1, 12345, sbe::SideReq::Buy, "CLORD0000002", 0, 0, 0,
+                                         sbe::OrderTypeReq::Limit, sbe::TimeInForce::Day);
+              drain(); });
+
+    //
+    // report
+    //
+
+    auto baseline = load_baseline(baseline_path);
+    printf("%-48s %10s %10s %10s", "benchmark", "ns/op", "cycles/op", "allocs/op");
+    if (!baseline.empty())
+        printf(" %10s", "vs base");
+    printf("\n");
+    for (auto &[name, r] : results)
+    {
+        printf("%-48s %10.1f %10.1f %10.2f", name.c_str(), r.ns, r.cycles, r.allocs);
+        auto it = baseline.find(name);
+        if (it != baseline.end() && it->second.ns > 0)
+            printf(" %+9.1f%%", 100.0 * (r.ns - it->second.ns) / it->second.ns);
+        printf("\n");
+    }
+
+    if (!save_path.empty())
+    {
+        std::ofstream out(save_path);
+        out << "# name ns/op cycles/op allocs/op" << std::endl;
+        for (auto &[name, r] : results)
+            out << name << " " << r.ns << " " << r.cycles << " " << r.allocs << std::endl;
+    }
+
+    return 0;
+}
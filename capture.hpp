@@ -0,0 +1,421 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <iostream>
+#include <optional>
+#include <string>
+
+#include "sock_help.hpp"
+#include "arena.hpp"
+
+/***************************************************************
+ *
+ * Wire capture
+ *
+ * A capture file is a file header followed by records. Each record is
+ * a record_header_t followed by the complete framed message as it was
+ * on the wire (SOFH, SBE header and body), padded to 8 bytes.
+ *
+ * The file is memory mapped and grown in large steps so appending is
+ * a memcpy. Nothing is synced, the kernel writes the pages back.
+ * file_header_t::used is updated after each record, so a capture
+ * from a crashed process is readable up to its last complete record.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::capture
+{
+    constexpr uint64_t MAGIC = 0x4943415054555245ULL; // ICAPTURE
+    constexpr uint32_t VERSION = 1;
+
+    enum Direction : uint16_t
+    {
+        FromCME = 0,
+        ToCME = 1
+    };
+
+    struct file_header_t
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t reserved;
+        volatile uint64_t used; // bytes of records after the file header
+    };
+
+    struct record_header_t
+    {
+        uint64_t timestamp; // ns since epoch
+        uint16_t length;    // framed message length
+        uint16_t direction;
+        uint32_t reserved;
+    };
+
+    constexpr size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+    static inline uint64_t now_ns() noexcept
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    /**
+     * @brief append framed messages to a capture file
+     *
+     */
+    class Writer
+    {
+    public:
+        /**
+         * @param path capture file, truncated
+         * @param grow_size bytes the mapping is grown by when full
+         */
+        explicit Writer(const std::string &path, size_t grow_size = size_t(1) << 30)
+            : grow(grow_size)
+        {
+            fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0)
+            {
+                perror("capture open");
+                abort();
+            }
+            remap(grow);
+            auto fh = file_header();
+            fh->magic = MAGIC;
+            fh->version = VERSION;
+            fh->used = 0;
+        }
+
+        ~Writer()
+        {
+            if (base)
+            {
+                auto total = sizeof(file_header_t) + file_header()->used;
+                munmap(base, mapped);
+                if (ftruncate(fd, total) < 0)
+                    perror("capture ftruncate");
+            }
+            ::close(fd);
+        }
+
+        Writer(const Writer &) = delete;
+        Writer &operator=(const Writer &) = delete;
+
+        /**
+         * @brief bind, lock and pre-fault the mapping now and whenever it grows,
+         * so appending takes no page faults. Locks and dirties grow_size bytes of page cache.
+         *
+         * @param node NUMA node, -1 for the node of the calling thread
+         */
+        void prefault(int node = -1) noexcept
+        {
+            prefault_node = node < 0 ? arena::current_node() : node;
+            arena::prepare(base, mapped, prefault_node);
+        }
+
+        /**
+         * @brief append a message received by sockhelp::recv_message
+         *
+         */
+        void append(const sockhelp::cme_msg_header_t &header, const char *body, Direction dir = FromCME, uint64_t ts = 0) noexcept
+        {
+            uint16_t sbe_header[6] = {
+                header.MsgSize,
+                header.EncodingType,
+                header.BlockLength,
+                header.TemplateID,
+                header.SchemaID,
+                header.Version};
+            auto body_len = header.MsgSize - sockhelp::SOFH_AND_SBE_HEADER_SIZE;
+            auto dst = reserve(header.MsgSize, dir, ts);
+            memcpy(dst, sbe_header, sizeof sbe_header);
+            memcpy(dst + sizeof sbe_header, body, body_len);
+            commit(header.MsgSize);
+        }
+
+        /**
+         * @brief append a complete framed message, e.g. an encoded send buffer
+         *
+         */
+        void append(const char *frame, uint16_t length, Direction dir, uint64_t ts = 0) noexcept
+        {
+            auto dst = reserve(length, dir, ts);
+            memcpy(dst, frame, length);
+            commit(length);
+        }
+
+    private:
+        char *reserve(uint16_t length, Direction dir, uint64_t ts) noexcept
+        {
+            auto need = sizeof(file_header_t) + file_header()->used + sizeof(record_header_t) + align8(length);
+            if (need > mapped)
+                remap(mapped + grow);
+            auto rec = base + sizeof(file_header_t) + file_header()->used;
+            auto rh = reinterpret_cast<record_header_t *>(rec);
+            rh->timestamp = ts ? ts : now_ns();
+            rh->length = length;
+            rh->direction = dir;
+            rh->reserved = 0;
+            return rec + sizeof(record_header_t);
+        }
+
+        void commit(uint16_t length) noexcept
+        {
+            __atomic_store_n(&file_header()->used,
+                             file_header()->used + sizeof(record_header_t) + align8(length),
+                             __ATOMIC_RELEASE);
+        }
+
+        file_header_t *file_header() const noexcept
+        {
+            return reinterpret_cast<file_header_t *>(base);
+        }
+
+        void remap(size_t size) noexcept
+        {
+            if (ftruncate(fd, size) < 0)
+            {
+                perror("capture ftruncate");
+                abort();
+            }
+            void *p;
+            if (base)
+                p = mremap(base, mapped, size, MREMAP_MAYMOVE);
+            else
+                p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED)
+            {
+                perror("capture mmap");
+                abort();
+            }
+            auto old_size = base ? mapped : 0;
+            base = static_cast<char *>(p);
+            mapped = size;
+            if (prefault_node >= 0)
+                arena::prepare(base + old_size, size - old_size, prefault_node);
+        }
+
+        int fd = -1;
+        char *base = nullptr;
+        size_t mapped = 0;
+        size_t grow;
+        int prefault_node = -1;
+    };
+
+    /**
+     * @brief a connection whose traffic is appended to a capture
+     *
+     * @tparam Transport the transport doing the I/O
+     */
+    template <typename Transport = sockhelp::SocketTransport>
+    struct Captured
+    {
+        typename Transport::handle_t handle;
+        Writer *writer;
+    };
+
+    /**
+     * @brief transport policy that journals both directions of a Transport
+     *
+     *   capture::Writer journal("session.cap");
+     *   capture::Captured<> cs{sock, &journal};
+     *   ILinkSndT<capture::CapturingTransport<>> snd(...);
+     *   snd.send_new_order_single(&cs, ...);
+     *   process_message_from_msgw<capture::CapturingTransport<>>(&cs, msg_buf, &cbif);
+     *
+     * Outbound frames are appended after they are sent, as ToCME records,
+     * inbound messages as FromCME records, so one file holds the session in
+     * order. Do not also pass the writer to process_message_from_msgw.
+     * tools/ilink_reconcile.cpp reads these journals.
+     */
+    template <typename Transport = sockhelp::SocketTransport>
+    struct CapturingTransport
+    {
+        using handle_t = Captured<Transport> *;
+
+        static auto send_message(handle_t c, const char *msg, int sz, bool add_cred = false) noexcept
+        {
+            auto r = Transport::send_message(c->handle, msg, sz, add_cred);
+            uint16_t length;
+            memcpy(&length, msg, sizeof length);
+            c->writer->append(msg, length, ToCME);
+            return r;
+        }
+
+        static auto warm_message(handle_t c, const char *msg, int sz, bool add_cred = false) noexcept
+        {
+            if constexpr (sockhelp::has_warm_message<Transport>::value)
+                return Transport::warm_message(c->handle, msg, sz, add_cred);
+            else
+                return sockhelp::frame_message(msg, sz, add_cred);
+        }
+
+        static std::optional<sockhelp::cme_msg_header_t>
+        recv_message(handle_t c, char *msg_buf, bool block = true) noexcept
+        {
+            auto header = Transport::recv_message(c->handle, msg_buf, block);
+            if (header)
+                c->writer->append(*header, msg_buf, FromCME);
+            return header;
+        }
+    };
+
+    /**
+     * @brief one record of a capture
+     *
+     */
+    struct record_t
+    {
+        uint64_t timestamp;
+        Direction direction;
+        uint16_t length;
+        const char *frame; // SOFH, SBE header and body
+
+        sockhelp::cme_msg_header_t header() const noexcept
+        {
+            sockhelp::cme_msg_header_t h;
+            memcpy(&h, frame, sizeof h);
+            return h;
+        }
+
+        const char *body() const noexcept
+        {
+            return frame + sockhelp::SOFH_AND_SBE_HEADER_SIZE;
+        }
+    };
+
+    /**
+     * @brief iterate over a capture file
+     *
+     */
+    class Reader
+    {
+    public:
+        explicit Reader(const std::string &path)
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+            {
+                perror("capture open");
+                return;
+            }
+            struct stat st;
+            if (fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(file_header_t))
+            {
+                void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+                if (p != MAP_FAILED)
+                {
+                    base = static_cast<const char *>(p);
+                    mapped = st.st_size;
+                }
+            }
+            ::close(fd);
+            if (!base)
+                return;
+            auto fh = reinterpret_cast<const file_header_t *>(base);
+            if (fh->magic != MAGIC || fh->version != VERSION)
+            {
+                std::cerr << "capture: bad file header " << path << std::endl;
+                munmap(const_cast<char *>(base), mapped);
+                base = nullptr;
+                return;
+            }
+            end = sizeof(file_header_t) + fh->used;
+            if (end > mapped)
+                end = mapped;
+            madvise(const_cast<char *>(base), mapped, MADV_SEQUENTIAL);
+        }
+
+        ~Reader()
+        {
+            if (base)
+                munmap(const_cast<char *>(base), mapped);
+        }
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        bool ok() const noexcept { return base != nullptr; }
+
+        /**
+         * @brief read the next record
+         *
+         * @return false at end of capture
+         */
+        bool next(record_t &rec) noexcept
+        {
+            if (!base || pos + sizeof(record_header_t) > end)
+                return false;
+            auto rh = reinterpret_cast<const record_header_t *>(base + pos);
+            if (pos + sizeof(record_header_t) + rh->length > end)
+                return false;
+            rec.timestamp = rh->timestamp;
+            rec.direction = Direction(rh->direction);
+            rec.length = rh->length;
+            rec.frame = base + pos + sizeof(record_header_t);
+            pos += sizeof(record_header_t) + align8(rh->length);
+            return true;
+        }
+
+        void rewind() noexcept { pos = sizeof(file_header_t); }
+
+        /**
+         * @brief the raw records, for splitting a capture between threads
+         *
+         */
+        const char *data() const noexcept { return base; }
+        size_t size() const noexcept { return end; }
+
+    private:
+        const char *base = nullptr;
+        size_t mapped = 0;
+        size_t end = 0;
+        size_t pos = sizeof(file_header_t);
+    };
+}
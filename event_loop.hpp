@@ -0,0 +1,439 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <coroutine>
+#include <exception>
+#include <map>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/***************************************************************
+ *
+ * Single threaded event loop for C++20 coroutines
+ *
+ *   Task<T>    lazily started coroutine, co_await it for its result
+ *   EventLoop  epoll for file descriptors and a timer queue, runs
+ *              any number of Tasks on the calling thread
+ *
+ *   coro::EventLoop loop;
+ *   loop.spawn(run_session(loop, ...));   // Task<void>
+ *   loop.run();
+ *
+ * A Task only runs when it is awaited or spawned, and resumes the
+ * awaiting coroutine when it finishes. Nothing here is thread safe,
+ * all Tasks of a loop must run on the thread calling run().
+ *
+ * Used by session_coro.hpp.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::coro
+{
+    static inline uint64_t now_ns() noexcept
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    template <typename T>
+    class Task;
+
+    namespace detail
+    {
+        struct final_awaiter_t
+        {
+            bool await_ready() const noexcept { return false; }
+
+            template <typename P>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+            {
+                if (auto c = h.promise().continuation)
+                    return c;
+                return std::noop_coroutine();
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        struct promise_base_t
+        {
+            std::coroutine_handle<> continuation;
+
+            std::suspend_always initial_suspend() const noexcept { return {}; }
+            final_awaiter_t final_suspend() const noexcept { return {}; }
+            void unhandled_exception() const noexcept { std::terminate(); }
+        };
+
+        template <typename T>
+        struct promise_t : promise_base_t
+        {
+            std::optional<T> value;
+
+            Task<T> get_return_object() noexcept;
+            void return_value(T v) noexcept { value = std::move(v); }
+        };
+
+        template <>
+        struct promise_t<void> : promise_base_t
+        {
+            Task<void> get_return_object() noexcept;
+            void return_void() const noexcept {}
+        };
+    }
+
+    /**
+     * @brief coroutine result, move only
+     */
+    template <typename T = void>
+    class Task
+    {
+    public:
+        using promise_type = detail::promise_t<T>;
+        using handle_t = std::coroutine_handle<promise_type>;
+
+        explicit Task(handle_t _h) noexcept : h(_h) {}
+        Task(Task &&o) noexcept : h(std::exchange(o.h, {})) {}
+        Task &operator=(Task &&o) noexcept
+        {
+            if (this != &o)
+            {
+                if (h)
+                    h.destroy();
+                h = std::exchange(o.h, {});
+            }
+            return *this;
+        }
+        Task(const Task &) = delete;
+        Task &operator=(const Task &) = delete;
+
+        ~Task()
+        {
+            if (h)
+                h.destroy();
+        }
+
+        bool await_ready() const noexcept { return !h || h.done(); }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+        {
+            h.promise().continuation = awaiting;
+            return h;
+        }
+
+        T await_resume() noexcept
+        {
+            if constexpr (!std::is_void_v<T>)
+                return std::move(*h.promise().value);
+        }
+
+        handle_t release() noexcept { return std::exchange(h, {}); }
+
+    private:
+        handle_t h;
+    };
+
+    namespace detail
+    {
+        template <typename T>
+        Task<T> promise_t<T>::get_return_object() noexcept
+        {
+            return Task<T>(std::coroutine_handle<promise_t<T>>::from_promise(*this));
+        }
+
+        inline Task<void> promise_t<void>::get_return_object() noexcept
+        {
+            return Task<void>(std::coroutine_handle<promise_t<void>>::from_promise(*this));
+        }
+    }
+
+    /**
+     * @brief callback of a file descriptor registered with EventLoop::add()
+     */
+    struct IOHandler
+    {
+        virtual ~IOHandler() = default;
+        virtual void on_io(uint32_t events) noexcept = 0;
+    };
+
+    /**
+     * @brief callback of a timer, see EventLoop::add_timer()
+     */
+    struct TimerHandler
+    {
+        virtual ~TimerHandler() = default;
+        virtual void on_timer() noexcept = 0;
+    };
+
+    class EventLoop
+    {
+    public:
+        using timer_id_t = std::pair<uint64_t, uint64_t>; // deadline, sequence
+
+        EventLoop()
+        {
+            epfd = epoll_create1(EPOLL_CLOEXEC);
+            if (epfd < 0)
+            {
+                perror("epoll_create1");
+                abort();
+            }
+        }
+
+        ~EventLoop()
+        {
+            // tasks not finished, their reaper has not run either
+            for (auto &[address, d] : detached)
+            {
+                d.first.destroy();
+                d.second.destroy();
+            }
+            // finished tasks, their reaper freed itself
+            for (auto h : finished)
+                h.destroy();
+            close(epfd);
+        }
+
+        EventLoop(const EventLoop &) = delete;
+        EventLoop &operator=(const EventLoop &) = delete;
+
+        /**
+         * @brief start a task, it is owned by the loop until it finishes
+         */
+        void spawn(Task<void> task)
+        {
+            auto h = task.release();
+            if (!h)
+                return;
+            // when it finishes it resumes a reaper that queues it to be freed
+            auto r = reaper(h);
+            detached.emplace(h.address(), std::make_pair(std::coroutine_handle<>(h), r));
+            h.promise().continuation = r;
+            ++live;
+            h.resume();
+        }
+
+        /**
+         * @brief number of spawned tasks not finished
+         */
+        size_t tasks() const noexcept { return live; }
+
+        bool add(int fd, uint32_t events, IOHandler *handler) noexcept
+        {
+            struct epoll_event ev = {};
+            ev.events = events;
+            ev.data.ptr = handler;
+            if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+            {
+                perror("epoll_ctl add");
+                return false;
+            }
+            return true;
+        }
+
+        bool modify(int fd, uint32_t events, IOHandler *handler) noexcept
+        {
+            struct epoll_event ev = {};
+            ev.events = events;
+            ev.data.ptr = handler;
+            if (epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev) < 0)
+            {
+                perror("epoll_ctl mod");
+                return false;
+            }
+            return true;
+        }
+
+        void remove(int fd) noexcept
+        {
+            epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+        }
+
+        /**
+         * @param deadline CLOCK_MONOTONIC ns, see now_ns()
+         * @return id to cancel the timer with
+         */
+        timer_id_t add_timer(uint64_t deadline, TimerHandler *handler)
+        {
+            timer_id_t id{deadline, ++timer_seq};
+            timers.emplace(id, handler);
+            return id;
+        }
+
+        /**
+         * @return false if it already fired or was cancelled
+         */
+        bool cancel_timer(timer_id_t id) noexcept
+        {
+            return timers.erase(id) != 0;
+        }
+
+        /**
+         * @brief co_await loop.sleep(ns)
+         */
+        auto sleep(uint64_t ns) noexcept
+        {
+            struct awaiter_t : TimerHandler
+            {
+                EventLoop &loop;
+                uint64_t deadline;
+                std::coroutine_handle<> h;
+
+                awaiter_t(EventLoop &_loop, uint64_t _deadline) : loop(_loop), deadline(_deadline) {}
+                bool await_ready() const noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> _h)
+                {
+                    h = _h;
+                    loop.add_timer(deadline, this);
+                }
+                void await_resume() const noexcept {}
+                void on_timer() noexcept override { h.resume(); }
+            };
+            return awaiter_t(*this, now_ns() + ns);
+        }
+
+        /**
+         * @brief wait for I/O or the next timer, at most max_wait_ms (-1 for no limit)
+         */
+        void run_once(int max_wait_ms = -1) noexcept
+        {
+            reap();
+            int wait = max_wait_ms;
+            if (!timers.empty())
+            {
+                auto next = timers.begin()->first.first;
+                auto now = now_ns();
+                int until = next <= now ? 0 : int((next - now + 999999) / 1000000);
+                if (wait < 0 || until < wait)
+                    wait = until;
+            }
+            if (!finished.empty())
+                wait = 0;
+            struct epoll_event events[64];
+            int n = epoll_wait(epfd, events, 64, wait);
+            for (int i = 0; i < n; ++i)
+                static_cast<IOHandler *>(events[i].data.ptr)->on_io(events[i].events);
+            fire_timers();
+            reap();
+        }
+
+        /**
+         * @brief run until stop() is called or every spawned task finished
+         */
+        void run() noexcept
+        {
+            stopped = false;
+            while (!stopped && live)
+                run_once();
+        }
+
+        void stop() noexcept { stopped = true; }
+
+    private:
+        struct reaper_t
+        {
+            struct promise_type
+            {
+                reaper_t get_return_object() noexcept
+                {
+                    return {std::coroutine_handle<promise_type>::from_promise(*this)};
+                }
+                std::suspend_always initial_suspend() const noexcept { return {}; }
+                std::suspend_never final_suspend() const noexcept { return {}; }
+                void return_void() const noexcept {}
+                void unhandled_exception() const noexcept { std::terminate(); }
+            };
+            std::coroutine_handle<promise_type> h;
+        };
+
+        // runs when a spawned task finishes, queues it to be freed by the loop
+        reaper_t reap_task(std::coroutine_handle<> task)
+        {
+            detached.erase(task.address());
+            finished.push_back(task);
+            co_return;
+        }
+
+        std::coroutine_handle<> reaper(std::coroutine_handle<> task)
+        {
+            return reap_task(task).h;
+        }
+
+        void reap() noexcept
+        {
+            for (auto h : finished)
+            {
+                h.destroy();
+                --live;
+            }
+            finished.clear();
+        }
+
+        void fire_timers() noexcept
+        {
+            auto now = now_ns();
+            while (!timers.empty() && timers.begin()->first.first <= now)
+            {
+                auto handler = timers.begin()->second;
+                timers.erase(timers.begin());
+                handler->on_timer();
+            }
+        }
+
+        int epfd;
+        bool stopped = false;
+        size_t live = 0;
+        uint64_t timer_seq = 0;
+        std::map<timer_id_t, TimerHandler *> timers;
+        // spawned task not finished -> (task, its reaper)
+        std::map<void *, std::pair<std::coroutine_handle<>, std::coroutine_handle<>>> detached;
+        std::vector<std::coroutine_handle<>> finished;
+    };
+}
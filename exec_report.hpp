@@ -0,0 +1,252 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <type_traits>
+
+#include "ilink_v8/ExecutionReportNew522.h"
+#include "ilink_v8/ExecutionReportReject523.h"
+#include "ilink_v8/ExecutionReportElimination524.h"
+#include "ilink_v8/ExecutionReportTradeOutright525.h"
+#include "ilink_v8/ExecutionReportModify531.h"
+#include "ilink_v8/ExecutionReportStatus532.h"
+#include "ilink_v8/ExecutionReportCancel534.h"
+
+#include "sock_help.hpp"
+
+/***************************************************************
+ *
+ * Decoded execution report, laid out for the hot path
+ *
+ * CBIF::exec_report_param_t holds std::string members between the
+ * scalars, so it spans about 9 cache lines and every report costs
+ * several allocations. exec_report_t has no heap members and keeps
+ * what a fill handler reads in the first cache line:
+ *
+ *   hot  (64 bytes): templateId SeqNum OrderID SecurityID LeavesQty
+ *                    CumQty LastQty lastPx Price OrdStatus ExecType
+ *                    Side OrderRequestID
+ *   cold           : UUID ExecID ClOrdID SenderID Location party ids,
+ *                    timestamps and order terms
+ *
+ * A handler that only reads hot touches one line per report.
+ * Prices are PRICE9 mantissas.
+ * bench/exec_report_bench.cpp measures the difference.
+ *
+ * *************************************************************/
+
+namespace m2::ilink
+{
+    struct alignas(64) exec_report_hot_t
+    {
+        uint16_t templateId;
+        char OrdStatus;
+        char ExecType;
+        uint32_t SeqNum;
+        uint64_t OrderID;
+        int64_t lastPx_mantissa;
+        int64_t Price_mantissa;
+        int32_t SecurityID;
+        uint32_t LeavesQty;
+        uint32_t CumQty;
+        uint32_t LastQty;
+        uint64_t OrderRequestID;
+        sbe::SideReq::Value Side;
+        bool AggressorIndicator;
+        bool PossRetransFlag;
+    };
+    static_assert(sizeof(exec_report_hot_t) == 64);
+
+    struct exec_report_cold_t
+    {
+        uint64_t UUID;
+        uint64_t PartyDetailsListReqID;
+        int64_t StopPx_mantissa;
+        uint64_t TransactTime;
+        uint64_t SendingTime;
+        uint64_t SideTradeID;
+        uint32_t OrderQty;
+        uint32_t DispQty;
+        char ExecID[40];
+        char ClOrdID[20];
+        char SenderID[20];
+        char Location[5];
+        sbe::OrderType::Value OrdType;
+        sbe::TimeInForce::Value TimeInForce;
+        sbe::ManualOrdIndReq::Value ManualOrderIndicator;
+    };
+
+    struct exec_report_t
+    {
+        exec_report_hot_t hot;
+        exec_report_cold_t cold;
+    };
+    static_assert(std::is_trivially_copyable_v<exec_report_t>);
+
+    template <typename M>
+    static void decode_exec_report_common(M &msg, exec_report_t &ev) noexcept
+    {
+        auto &h = ev.hot;
+        h.templateId = M::sbeTemplateId();
+        // constant char field, the accessor returns its static value
+        h.ExecType = msg.execType()[0];
+        h.SeqNum = msg.seqNum();
+        h.OrderID = msg.orderID();
+        h.lastPx_mantissa = 0;
+        h.Price_mantissa = msg.price().mantissa();
+        h.SecurityID = msg.securityID();
+        h.LeavesQty = 0;
+        h.CumQty = 0;
+        h.LastQty = 0;
+        h.OrderRequestID = msg.orderRequestID();
+        h.Side = msg.side();
+        h.AggressorIndicator = false;
+        h.PossRetransFlag = msg.possRetransFlag();
+
+        auto &c = ev.cold;
+        c.UUID = msg.uUID();
+        c.PartyDetailsListReqID = msg.partyDetailsListReqID();
+        c.StopPx_mantissa = msg.stopPx().mantissa();
+        c.TransactTime = msg.transactTime();
+        c.SendingTime = msg.sendingTimeEpoch();
+        c.SideTradeID = 0;
+        c.OrderQty = msg.orderQty();
+        c.DispQty = 0;
+        memcpy(c.ExecID, msg.execID(), sizeof c.ExecID);
+        memcpy(c.ClOrdID, msg.clOrdID(), sizeof c.ClOrdID);
+        memcpy(c.SenderID, msg.senderID(), sizeof c.SenderID);
+        memcpy(c.Location, msg.location(), sizeof c.Location);
+        c.OrdType = msg.ordType();
+        c.TimeInForce = msg.timeInForce();
+        c.ManualOrderIndicator = msg.manualOrderIndicator();
+    }
+
+    /**
+     * @brief decode an execution report without allocating
+     *
+     * @return false if the template is not one of
+     * 522 523 524 525 531 532 534
+     */
+    static bool decode_exec_report(const sockhelp::cme_msg_header_t *header, char *msg_buf, exec_report_t &ev) noexcept
+    {
+        switch (header->TemplateID)
+        {
+        case sbe::ExecutionReportNew522::sbeTemplateId():
+        {
+            sbe::ExecutionReportNew522 executionReportNew;
+            auto msg = executionReportNew.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            decode_exec_report_common(msg, ev);
+            ev.hot.OrdStatus = msg.ordStatus()[0];
+            ev.cold.DispQty = msg.displayQty();
+            return true;
+        }
+        case sbe::ExecutionReportReject523::sbeTemplateId():
+        {
+            sbe::ExecutionReportReject523 executionReportReject;
+            auto msg = executionReportReject.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            decode_exec_report_common(msg, ev);
+            ev.hot.OrdStatus = msg.ordStatus()[0];
+            ev.cold.DispQty = msg.displayQty();
+            return true;
+        }
+        case sbe::ExecutionReportElimination524::sbeTemplateId():
+        {
+            sbe::ExecutionReportElimination524 executionReportElimination;
+            auto msg = executionReportElimination.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            decode_exec_report_common(msg, ev);
+            ev.hot.OrdStatus = msg.ordStatus()[0];
+            ev.hot.CumQty = msg.cumQty();
+            ev.cold.DispQty = msg.displayQty();
+            return true;
+        }
+        case sbe::ExecutionReportTradeOutright525::sbeTemplateId():
+        {
+            sbe::ExecutionReportTradeOutright525 executionReportTradeOutright;
+            auto msg = executionReportTradeOutright.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            decode_exec_report_common(msg, ev);
+            ev.hot.OrdStatus = (char)msg.ordStatus();
+            ev.hot.lastPx_mantissa = msg.lastPx().mantissa();
+            ev.hot.LastQty = msg.lastQty();
+            ev.hot.CumQty = msg.cumQty();
+            ev.hot.LeavesQty = msg.leavesQty();
+            ev.hot.AggressorIndicator = msg.aggressorIndicator() == sbe::BooleanFlag::True;
+            ev.cold.SideTradeID = msg.sideTradeID();
+            return true;
+        }
+        case sbe::ExecutionReportModify531::sbeTemplateId():
+        {
+            sbe::ExecutionReportModify531 executionReportModify;
+            auto msg = executionReportModify.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            decode_exec_report_common(msg, ev);
+            ev.hot.OrdStatus = msg.ordStatus()[0];
+            ev.hot.CumQty = msg.cumQty();
+            ev.hot.LeavesQty = msg.leavesQty();
+            ev.cold.DispQty = msg.displayQty();
+            return true;
+        }
+        case sbe::ExecutionReportStatus532::sbeTemplateId():
+        {
+            sbe::ExecutionReportStatus532 executionReportStatus;
+            auto msg = executionReportStatus.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            decode_exec_report_common(msg, ev);
+            ev.hot.OrdStatus = (char)msg.ordStatus();
+            ev.hot.CumQty = msg.cumQty();
+            ev.hot.LeavesQty = msg.leavesQty();
+            ev.cold.DispQty = msg.displayQty();
+            return true;
+        }
+        case sbe::ExecutionReportCancel534::sbeTemplateId():
+        {
+            sbe::ExecutionReportCancel534 executionReportCancel;
+            auto msg = executionReportCancel.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            decode_exec_report_common(msg, ev);
+            ev.hot.OrdStatus = msg.ordStatus()[0];
+            ev.hot.CumQty = msg.cumQty();
+            ev.cold.DispQty = msg.displayQty();
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+}
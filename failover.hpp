@@ -0,0 +1,393 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+#pragma once
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "session_coro.hpp"
+
+/***************************************************************
+ *
+ * Hot standby connection and failover
+ *
+ * Failover keeps a second TCP connection open to the next gateway
+ * (e.g. the backup) while the session trades on the active one. When
+ * the active connection is lost, the standby is attached to the
+ * session and the same UUID is established with the same NextSeqNo:
+ * one Establish503 round trip instead of connect, Negotiate500 and
+ * Establish503. The HMAC context is kept by ILinkSndT (HMACSigner),
+ * so signing costs no key decoding.
+ *
+ *   failover::Sender snd(...);
+ *   failover::Session s(loop, snd, &app);
+ *   failover::Failover fo(loop, s, {{"10.0.0.1", 9000}, {"10.0.0.2", 9000}});
+ *   loop.spawn(fo.run());
+ *   loop.run();
+ *
+ * or, driving it yourself:
+ *
+ *   auto r = co_await fo.start();       // connect, negotiate, establish, standby
+ *   ... trade on s.socket() ...
+ *   co_await s.closed();
+ *   r = co_await fo.fail_over();        // establish on the standby
+ *
+ * The standby is not negotiated ahead of time: negotiating starts a
+ * new UUID and its sequence numbers from 1, which would give up the
+ * continuity the failover keeps.
+ *
+ * FaultToleranceIndicator: EstablishmentAck504 says whether the new
+ * connection is primary or backup, and Sequence506 from CME announces
+ * changes. The session passes it on to ILinkSndT, which sends it back
+ * in its own Sequence506.
+ *
+ * Sequence numbers: ILinkSndT keeps NextSeqNo across the failover, CME
+ * answers a gap with NotApplied513. Messages CME sent while nothing
+ * was connected (NextSeqNo of EstablishmentAck504 beyond
+ * Session::next_expected_seq_no()) are requested with RetransmitRequest508,
+ * at most RETRANSMIT_MAX per request.
+ *
+ * The session sends with sockhelp::DisconnectingSocketTransport: a
+ * send on a lost connection fails, shuts the socket down and the
+ * session reports Disconnected like for a close read from the socket.
+ * The message sent is lost, CME never saw it.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::failover
+{
+    static constexpr uint16_t RETRANSMIT_MAX = 2500;
+
+    using Session = coro::SessionT<sockhelp::DisconnectingSocketTransport>;
+    using Sender = Session::sender_t;
+
+    struct endpoint_t
+    {
+        std::string host;
+        int port;
+    };
+
+    /**
+     * @brief see connect_to()
+     */
+    class connect_awaiter_t : coro::IOHandler, coro::TimerHandler
+    {
+    public:
+        connect_awaiter_t(coro::EventLoop &_loop, const endpoint_t &ep, uint64_t _timeout_ns)
+            : loop(_loop), timeout_ns(_timeout_ns)
+        {
+            fd = ::socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+            if (fd < 0)
+            {
+                perror("socket");
+                return;
+            }
+            int flag = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof flag);
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof addr);
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = inet_addr(ep.host.c_str());
+            addr.sin_port = htons(ep.port);
+            if (::connect(fd, (struct sockaddr *)&addr, sizeof addr) < 0 && errno != EINPROGRESS)
+            {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+
+        bool await_ready() const noexcept { return fd < 0; }
+
+        void await_suspend(std::coroutine_handle<> _h) noexcept
+        {
+            h = _h;
+            loop.add(fd, EPOLLOUT, this);
+            timer = loop.add_timer(coro::now_ns() + timeout_ns, this);
+        }
+
+        int await_resume() noexcept { return std::exchange(fd, -1); }
+
+    private:
+        coro::EventLoop &loop;
+        uint64_t timeout_ns;
+        int fd = -1;
+        std::coroutine_handle<> h;
+        coro::EventLoop::timer_id_t timer;
+
+        void on_io(uint32_t events) noexcept override
+        {
+            int err = 0;
+            socklen_t len = sizeof err;
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            loop.remove(fd);
+            loop.cancel_timer(timer);
+            if (err || (events & (EPOLLERR | EPOLLHUP)))
+            {
+                ::close(fd);
+                fd = -1;
+            }
+            else
+            {
+                fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+            }
+            // last, the awaiting coroutine may destroy this
+            std::exchange(h, {}).resume();
+        }
+
+        void on_timer() noexcept override
+        {
+            loop.remove(fd);
+            ::close(fd);
+            fd = -1;
+            std::exchange(h, {}).resume();
+        }
+    };
+
+    /**
+     * @brief co_await connect_to(loop, endpoint, timeout_ns) for a socket
+     * connected without blocking the loop (blocking, TCP_NODELAY), -1 on failure
+     */
+    static connect_awaiter_t connect_to(coro::EventLoop &loop, const endpoint_t &ep, uint64_t timeout_ns)
+    {
+        return connect_awaiter_t(loop, ep, timeout_ns);
+    }
+
+    class Failover
+    {
+    public:
+        /**
+         * @param _endpoints gateways of the session in order of preference,
+         * the standby connects to the one after the active one
+         */
+        Failover(coro::EventLoop &_loop, Session &_s, std::vector<endpoint_t> _endpoints,
+                 uint64_t _timeout_ns = 2 * coro::SEC)
+            : loop(_loop), s(_s), endpoints(std::move(_endpoints)), timeout_ns(_timeout_ns)
+        {
+        }
+
+        ~Failover()
+        {
+            close_standby();
+        }
+
+        Failover(const Failover &) = delete;
+        Failover &operator=(const Failover &) = delete;
+
+        /**
+         * @brief connect to the first endpoint that answers, negotiate a new
+         * UUID (unless continuing one, see session_state.hpp), establish,
+         * recover missed messages and connect the standby
+         */
+        coro::Task<coro::session_result_t> start(bool negotiate = true)
+        {
+            coro::session_result_t r;
+            r.status = coro::Status::Disconnected;
+            for (size_t i = 0; i < endpoints.size() && !r; ++i)
+            {
+                r = co_await s.connect(endpoints[i].host, endpoints[i].port, timeout_ns);
+                if (r)
+                    active = i;
+            }
+            if (!r)
+                co_return r;
+            if (negotiate)
+            {
+                s.sender().reset_uuid();
+                r = co_await s.negotiate(timeout_ns);
+                if (!r)
+                    co_return r;
+            }
+            r = co_await s.establish(timeout_ns);
+            if (!r)
+                co_return r;
+            r = co_await recover(r);
+            co_await prepare_standby();
+            co_return r;
+        }
+
+        /**
+         * @brief (re)connect the standby to the next endpoint that answers,
+         * done by start() and fail_over(), call it again if the standby
+         * was closed by the gateway
+         */
+        coro::Task<bool> prepare_standby()
+        {
+            close_standby();
+            for (size_t k = 1; k < endpoints.size(); ++k)
+            {
+                auto i = (active + k) % endpoints.size();
+                int fd = co_await connect_to(loop, endpoints[i], timeout_ns);
+                if (fd >= 0)
+                {
+                    standby = fd;
+                    standby_index = i;
+                    co_return true;
+                }
+            }
+            co_return false;
+        }
+
+        /**
+         * @brief the active connection is lost: establish the session on the
+         * standby, recover missed messages, connect a new standby
+         */
+        coro::Task<coro::session_result_t> fail_over()
+        {
+            auto t0 = coro::now_ns();
+            s.close();
+            if (!standby_alive())
+                co_await prepare_standby();
+            if (standby < 0)
+            {
+                coro::session_result_t r;
+                r.status = coro::Status::Disconnected;
+                co_return r;
+            }
+            s.attach(std::exchange(standby, -1));
+            active = standby_index;
+            auto r = co_await s.establish(timeout_ns);
+            if (!r)
+            {
+                s.close();
+                co_return r;
+            }
+            last_failover_ns = coro::now_ns() - t0;
+            ++failovers;
+            r = co_await recover(r);
+            co_await prepare_standby();
+            co_return r;
+        }
+
+        /**
+         * @brief keep the session up: start(), fail over on every disconnect,
+         * negotiate a new UUID when that fails
+         */
+        coro::Task<void> run(bool negotiate = true)
+        {
+            for (;;)
+            {
+                auto r = co_await start(negotiate);
+                while (r)
+                {
+                    co_await s.closed();
+                    r = co_await fail_over();
+                }
+                std::cerr << "failover: " << coro::status_name(r.status) << " " << r.Reason << std::endl;
+                s.close();
+                negotiate = true;
+                co_await loop.sleep(coro::SEC);
+            }
+        }
+
+        bool has_standby() const noexcept { return standby >= 0; }
+        const endpoint_t &active_endpoint() const noexcept { return endpoints[active]; }
+        uint64_t failover_count() const noexcept { return failovers; }
+
+        /**
+         * @brief ns from fail_over() to EstablishmentAck504 of the last failover
+         */
+        uint64_t last_failover_time() const noexcept { return last_failover_ns; }
+
+    private:
+        coro::EventLoop &loop;
+        Session &s;
+        std::vector<endpoint_t> endpoints;
+        uint64_t timeout_ns;
+        size_t active = 0;
+        int standby = -1;
+        size_t standby_index = 0;
+        uint64_t failovers = 0;
+        uint64_t last_failover_ns = 0;
+
+        void close_standby() noexcept
+        {
+            if (standby >= 0)
+            {
+                ::close(standby);
+                standby = -1;
+            }
+        }
+
+        // connected and not closed by the gateway, nothing is read from it
+        bool standby_alive() noexcept
+        {
+            if (standby < 0)
+                return false;
+            char c;
+            auto n = recv(standby, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+            if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+            {
+                close_standby();
+                return false;
+            }
+            return true;
+        }
+
+        // request what CME sent past next_expected_seq_no(), r of the establish
+        coro::Task<coro::session_result_t> recover(coro::session_result_t r)
+        {
+            while (r && r.NextSeqNo > s.next_expected_seq_no())
+            {
+                auto from = s.next_expected_seq_no();
+                auto count = uint16_t(std::min<uint32_t>(r.NextSeqNo - from, RETRANSMIT_MAX));
+                auto rr = co_await s.retransmit(from, count, timeout_ns);
+                if (!rr)
+                    co_return rr;
+                if (s.next_expected_seq_no() == from)
+                {
+                    // nothing arrived, do not ask again
+                    std::cerr << "failover: no messages retransmitted from " << from << std::endl;
+                    break;
+                }
+            }
+            co_return r;
+        }
+    };
+}
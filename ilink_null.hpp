@@ -8,5 +8,6 @@
 
 static const uint64_t UINT64_NULL = 18446744073709551615ULL;
 static const uint32_t UINT32_NULL = 4294967295;
+static const int32_t INT32_NULL = 2147483647;
 static const uint16_t UINT16_NULL = 65535;
 static const uint8_t UINT8_NULL = 255;
\ No newline at end of file
@@ -0,0 +1,396 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "sock_help.hpp"
+#include "arena.hpp"
+
+/***************************************************************
+ *
+ * In-process and shared memory transport
+ *
+ * A Channel is two single producer / single consumer byte rings, one
+ * for each direction. ILinkSndT<InprocTransport> sends into the client
+ * endpoint and process_message_from_msgw<InprocTransport> reads from it,
+ * the other end is read and written by e.g. MatchingEngine.
+ * Messages are framed exactly as on the wire.
+ *
+ * A ShmChannel is the same pair of rings in POSIX shared memory, so
+ * the two ends can be different processes (e.g. a session process and
+ * a process that owns the CME socket, or a test loopback).
+ *
+ * If both ends run on the same thread the reader must not block:
+ * pass block = false to recv_message and pump the other end in between.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::inproc
+{
+    /**
+     * @brief ring indexes, on their own cache lines
+     * lives next to the data, in shared memory for a ShmChannel
+     */
+    struct ring_ctrl_t
+    {
+        alignas(64) std::atomic<uint64_t> head{0}; // written by producer
+        alignas(64) std::atomic<uint64_t> tail{0}; // written by consumer
+    };
+
+    /**
+     * @brief single producer single consumer byte ring
+     *
+     */
+    class ByteRing
+    {
+    public:
+        /**
+         * @param size capacity in bytes, rounded up to a power of two
+         */
+        explicit ByteRing(size_t size = size_t(1) << 24)
+        {
+            cap = round_up(size);
+            mask = cap - 1;
+            owned_ctrl = std::make_unique<ring_ctrl_t>();
+            owned_buf.reset(static_cast<char *>(aligned_alloc(64, cap)));
+            memset(owned_buf.get(), 0, cap);
+            ctrl = owned_ctrl.get();
+            buf = owned_buf.get();
+        }
+
+        /**
+         * @brief ring over memory owned by someone else
+         *
+         * @param size a power of two
+         */
+        ByteRing(ring_ctrl_t *_ctrl, char *_buf, size_t size)
+            : ctrl(_ctrl), buf(_buf), cap(size), mask(size - 1)
+        {
+        }
+
+        static size_t round_up(size_t size) noexcept
+        {
+            size_t c = 1;
+            while (c < size)
+                c <<= 1;
+            return c;
+        }
+
+        size_t capacity() const noexcept { return cap; }
+
+        size_t readable() const noexcept
+        {
+            return ctrl->head.load(std::memory_order_acquire) - ctrl->tail.load(std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief append n bytes
+         *
+         * @return false if there is not enough space
+         */
+        bool try_write(const char *p, size_t n) noexcept
+        {
+            auto h = ctrl->head.load(std::memory_order_relaxed);
+            if (cap - (h - cached_tail) < n)
+            {
+                cached_tail = ctrl->tail.load(std::memory_order_acquire);
+                if (cap - (h - cached_tail) < n)
+                    return false;
+            }
+            copy_in(h, p, n);
+            ctrl->head.store(h + n, std::memory_order_release);
+            return true;
+        }
+
+        /**
+         * @brief copy n bytes at offset off from the read position
+         * caller has checked readable()
+         */
+        void peek(char *p, size_t n, size_t off = 0) const noexcept
+        {
+            auto t = ctrl->tail.load(std::memory_order_relaxed) + off;
+            auto i = t & mask;
+            auto first = std::min(n, cap - i);
+            memcpy(p, buf + i, first);
+            memcpy(p + first, buf, n - first);
+        }
+
+        void consume(size_t n) noexcept
+        {
+            ctrl->tail.store(ctrl->tail.load(std::memory_order_relaxed) + n, std::memory_order_release);
+        }
+
+    private:
+        void copy_in(uint64_t h, const char *p, size_t n) noexcept
+        {
+            auto i = h & mask;
+            auto first = std::min(n, cap - i);
+            memcpy(buf + i, p, first);
+            memcpy(buf, p + first, n - first);
+        }
+
+        struct free_delete
+        {
+            void operator()(char *p) const noexcept { free(p); }
+        };
+
+        ring_ctrl_t *ctrl;
+        char *buf;
+        size_t cap;
+        size_t mask;
+        // producer only, kept off the line the consumer reads
+        alignas(64) uint64_t cached_tail = 0;
+        std::unique_ptr<ring_ctrl_t> owned_ctrl;
+        std::unique_ptr<char, free_delete> owned_buf;
+    };
+
+    /**
+     * @brief one side of a Channel
+     *
+     */
+    struct Endpoint
+    {
+        ByteRing *tx;
+        ByteRing *rx;
+    };
+
+    /**
+     * @brief a bidirectional in-process connection
+     *
+     */
+    struct Channel
+    {
+        explicit Channel(size_t ring_size = size_t(1) << 24)
+            : to_cme(ring_size), from_cme(ring_size) {}
+
+        /**
+         * @brief rings in pre-faulted arena memory
+         */
+        Channel(arena::Arena &a, size_t ring_size)
+            : to_cme(a.make<ring_ctrl_t>(), a.buffer(ByteRing::round_up(ring_size)), ByteRing::round_up(ring_size)),
+              from_cme(a.make<ring_ctrl_t>(), a.buffer(ByteRing::round_up(ring_size)), ByteRing::round_up(ring_size)) {}
+
+        ByteRing to_cme;
+        ByteRing from_cme;
+        Endpoint client{&to_cme, &from_cme};
+        Endpoint exchange{&from_cme, &to_cme};
+    };
+
+    /**
+     * @brief a bidirectional connection in POSIX shared memory
+     *
+     * One process creates it, the other opens it by name. Each
+     * endpoint must be used by one process only.
+     */
+    class ShmChannel
+    {
+    public:
+        static constexpr uint64_t MAGIC = 0x494e50524f435348ULL; // INPROCSH
+
+        /**
+         * @brief create (or reset) a channel
+         *
+         * @param name shm name, e.g. "/ilink_chan_ABC"
+         * @return nullptr on failure
+         */
+        static std::unique_ptr<ShmChannel> create(const std::string &name, size_t ring_size = size_t(1) << 24)
+        {
+            ring_size = ByteRing::round_up(ring_size);
+            auto len = sizeof(shm_header_t) + 2 * ring_size;
+            int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0600);
+            if (fd < 0)
+            {
+                perror("shm_open");
+                return nullptr;
+            }
+            if (ftruncate(fd, len) < 0)
+            {
+                perror("ftruncate");
+                close(fd);
+                return nullptr;
+            }
+            void *p = mmap(nullptr, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+            {
+                perror("mmap");
+                return nullptr;
+            }
+            auto hdr = new (p) shm_header_t;
+            hdr->ring_size = ring_size;
+            std::atomic_thread_fence(std::memory_order_release);
+            hdr->magic = MAGIC;
+            return std::unique_ptr<ShmChannel>(new ShmChannel(name, hdr, len, true));
+        }
+
+        /**
+         * @brief open a channel created by another process
+         *
+         * @return nullptr if it does not exist (yet)
+         */
+        static std::unique_ptr<ShmChannel> open(const std::string &name)
+        {
+            int fd = shm_open(name.c_str(), O_RDWR, 0);
+            if (fd < 0)
+                return nullptr;
+            struct stat st;
+            if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(shm_header_t))
+            {
+                close(fd);
+                return nullptr;
+            }
+            void *p = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+            {
+                perror("mmap");
+                return nullptr;
+            }
+            auto hdr = static_cast<shm_header_t *>(p);
+            if (hdr->magic != MAGIC || sizeof(shm_header_t) + 2 * hdr->ring_size != (size_t)st.st_size)
+            {
+                munmap(p, st.st_size);
+                return nullptr;
+            }
+            return std::unique_ptr<ShmChannel>(new ShmChannel(name, hdr, st.st_size, false));
+        }
+
+        ~ShmChannel()
+        {
+            munmap(hdr, len);
+            if (owner)
+                shm_unlink(name.c_str());
+        }
+
+        ShmChannel(const ShmChannel &) = delete;
+        ShmChannel &operator=(const ShmChannel &) = delete;
+
+    private:
+        struct shm_header_t
+        {
+            uint64_t magic = 0;
+            uint64_t ring_size = 0;
+            ring_ctrl_t ctrl[2];
+        };
+
+        ShmChannel(const std::string &_name, shm_header_t *_hdr, size_t _len, bool _owner)
+            : name(_name), hdr(_hdr), len(_len), owner(_owner),
+              to_cme(&hdr->ctrl[0], reinterpret_cast<char *>(hdr + 1), hdr->ring_size),
+              from_cme(&hdr->ctrl[1], reinterpret_cast<char *>(hdr + 1) + hdr->ring_size, hdr->ring_size)
+        {
+        }
+
+        std::string name;
+        shm_header_t *hdr;
+        size_t len;
+        bool owner;
+
+    public:
+        ByteRing to_cme;
+        ByteRing from_cme;
+        Endpoint client{&to_cme, &from_cme};
+        Endpoint exchange{&from_cme, &to_cme};
+    };
+
+    /**
+     * @brief Transport policy over a Channel or ShmChannel endpoint
+     * @see sockhelp::SocketTransport
+     */
+    struct InprocTransport
+    {
+        using handle_t = Endpoint *;
+
+        /**
+         * @brief frame and send, spins while the ring is full
+         */
+        static auto send_message(handle_t ep, const char *msg, int sz, bool add_cred = false) noexcept
+        {
+            auto totmsgsz = sockhelp::frame_message(msg, sz, add_cred);
+            if ((size_t)totmsgsz > ep->tx->capacity())
+            {
+                std::cerr << "inproc: message larger than ring" << std::endl;
+                abort();
+            }
+            while (!ep->tx->try_write(msg, totmsgsz))
+                std::this_thread::yield();
+            return totmsgsz;
+        }
+
+        static std::optional<sockhelp::cme_msg_header_t>
+        recv_message(handle_t ep, char *msg_buf, bool block = true) noexcept
+        {
+            auto rx = ep->rx;
+            sockhelp::cme_msg_header_t header;
+            size_t body = 0;
+            for (;;)
+            {
+                auto avail = rx->readable();
+                if (avail >= sockhelp::SOFH_AND_SBE_HEADER_SIZE)
+                {
+                    rx->peek((char *)&header, sizeof header);
+                    body = std::max<size_t>(header.BlockLength, header.MsgSize - sockhelp::SOFH_AND_SBE_HEADER_SIZE);
+                    if (avail >= sockhelp::SOFH_AND_SBE_HEADER_SIZE + body)
+                        break;
+                }
+                if (!block)
+                    return {};
+            }
+            rx->peek(msg_buf, body, sockhelp::SOFH_AND_SBE_HEADER_SIZE);
+            rx->consume(sockhelp::SOFH_AND_SBE_HEADER_SIZE + body);
+            return header;
+        }
+    };
+}
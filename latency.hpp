@@ -0,0 +1,332 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <atomic>
+#include <iostream>
+#include <string>
+
+/***************************************************************
+ *
+ * Hot path latency histograms
+ *
+ * Compile with -DILINK_LATENCY to enable. Without it every macro
+ * below expands to nothing and there is no cost.
+ *
+ * Points are timestamped with the TSC and the intervals
+ *   Decode:  frame received -> decoded, before the CBIF call
+ *   Handler: CBIF call -> CBIF returned
+ *   Encode:  send_* called -> message encoded, before send()
+ *   Send:    send() called -> send() returned
+ * and, with timestamping::TimestampingTransport,
+ *   SocketRx: kernel received the message -> recv returned it
+ *   SocketTx: send() called -> kernel handed the message to the device
+ * are recorded in per-session log-linear (HDR style) histograms that
+ * live in POSIX shared memory /ilink_lat_<SessionID>, so another process
+ * can read them with latency::Stats::open() while the session trades.
+ *
+ * Each session has one writer thread for the receive side and one for
+ * the send side, so counters are updated with plain relaxed stores.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::latency
+{
+    enum Point
+    {
+        Decode,
+        Handler,
+        Encode,
+        Send,
+        SocketRx,
+        SocketTx,
+        POINT_END
+    };
+
+    static const char *point_name(int p)
+    {
+        static const char *names[] = {"decode", "handler", "encode", "send", "socket_rx", "socket_tx"};
+        return p < POINT_END ? names[p] : "?";
+    }
+
+    static inline uint64_t now() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+    }
+
+    /**
+     * @brief ticks per second of now()
+     *
+     */
+    static double calibrate_ticks_per_sec() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        struct timespec ts0, ts1;
+        clock_gettime(CLOCK_MONOTONIC, &ts0);
+        auto c0 = now();
+        struct timespec req = {0, 20000000};
+        nanosleep(&req, nullptr);
+        clock_gettime(CLOCK_MONOTONIC, &ts1);
+        auto c1 = now();
+        double ns = (ts1.tv_sec - ts0.tv_sec) * 1e9 + (ts1.tv_nsec - ts0.tv_nsec);
+        return (c1 - c0) * 1e9 / ns;
+#else
+        return 1e9;
+#endif
+    }
+
+    /**
+     * @brief log-linear histogram
+     * 2^SUB_BITS linear buckets per power of two, about 3% resolution
+     *
+     */
+    struct Histogram
+    {
+        static constexpr int SUB_BITS = 5;
+        static constexpr int SUB_COUNT = 1 << SUB_BITS;
+        static constexpr int MAX_BITS = 42;
+        static constexpr int BUCKETS = (MAX_BITS - SUB_BITS + 1) * SUB_COUNT;
+
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> max;
+        std::atomic<uint64_t> buckets[BUCKETS];
+
+        static int bucket_of(uint64_t v) noexcept
+        {
+            if (v < SUB_COUNT)
+                return int(v);
+            int msb = 63 - __builtin_clzll(v);
+            if (msb >= MAX_BITS)
+                return BUCKETS - 1;
+            int shift = msb - SUB_BITS;
+            return (shift + 1) * SUB_COUNT + int((v >> shift) & (SUB_COUNT - 1));
+        }
+
+        /**
+         * @brief smallest value that falls in bucket b
+         *
+         */
+        static uint64_t value_of(int b) noexcept
+        {
+            if (b < SUB_COUNT)
+                return b;
+            int shift = b / SUB_COUNT - 1;
+            uint64_t sub = b % SUB_COUNT;
+            return (SUB_COUNT + sub) << shift;
+        }
+
+        void record(uint64_t v) noexcept
+        {
+            auto &b = buckets[bucket_of(v)];
+            b.store(b.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (v > max.load(std::memory_order_relaxed))
+                max.store(v, std::memory_order_relaxed);
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        uint64_t percentile(double pct) const noexcept
+        {
+            auto total = count.load(std::memory_order_acquire);
+            if (!total)
+                return 0;
+            uint64_t target = uint64_t(total * pct / 100.0);
+            uint64_t seen = 0;
+            for (int b = 0; b < BUCKETS; ++b)
+            {
+                seen += buckets[b].load(std::memory_order_relaxed);
+                if (seen > target)
+                    return value_of(b);
+            }
+            return max.load(std::memory_order_relaxed);
+        }
+    };
+
+    /**
+     * @brief all histograms of one session, laid out in shared memory
+     *
+     */
+    struct alignas(64) Stats
+    {
+        static constexpr uint64_t MAGIC = 0x494c4154454e4359ULL; // ILATENCY
+
+        uint64_t magic;
+        double ticks_per_sec;
+        char session[16];
+        alignas(64) Histogram hist[POINT_END];
+
+        void record(Point p, uint64_t ticks) noexcept
+        {
+            hist[p].record(ticks);
+        }
+
+        /**
+         * @brief record an interval measured in ns rather than ticks
+         */
+        void record_ns(Point p, uint64_t ns) noexcept
+        {
+            hist[p].record(uint64_t(ns * ticks_per_sec / 1e9));
+        }
+
+        double to_ns(uint64_t ticks) const noexcept
+        {
+            return ticks * 1e9 / ticks_per_sec;
+        }
+
+        static std::string shm_name(const std::string &session)
+        {
+            return "/ilink_lat_" + session;
+        }
+
+        /**
+         * @brief create (or reset) the shared memory for a session
+         *
+         * @return Stats* or nullptr on failure
+         */
+        static Stats *create(const std::string &session) noexcept
+        {
+            auto name = shm_name(session);
+            int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+            if (fd < 0)
+            {
+                perror("shm_open");
+                return nullptr;
+            }
+            if (ftruncate(fd, sizeof(Stats)) < 0)
+            {
+                perror("ftruncate");
+                close(fd);
+                return nullptr;
+            }
+            void *p = mmap(nullptr, sizeof(Stats), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+            {
+                perror("mmap");
+                return nullptr;
+            }
+            memset(p, 0, sizeof(Stats));
+            auto stats = static_cast<Stats *>(p);
+            stats->ticks_per_sec = calibrate_ticks_per_sec();
+            strncpy(stats->session, session.c_str(), sizeof stats->session - 1);
+            std::atomic_thread_fence(std::memory_order_release);
+            stats->magic = MAGIC;
+            return stats;
+        }
+
+        /**
+         * @brief attach read only to the histograms of a running session
+         *
+         */
+        static const Stats *open(const std::string &session) noexcept
+        {
+            auto name = shm_name(session);
+            int fd = shm_open(name.c_str(), O_RDONLY, 0);
+            if (fd < 0)
+                return nullptr;
+            void *p = mmap(nullptr, sizeof(Stats), PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+                return nullptr;
+            auto stats = static_cast<const Stats *>(p);
+            if (stats->magic != MAGIC)
+            {
+                munmap(p, sizeof(Stats));
+                return nullptr;
+            }
+            return stats;
+        }
+
+        void print(std::ostream &os) const
+        {
+            os << "session " << session << " (ns)" << std::endl;
+            for (int p = 0; p < POINT_END; ++p)
+            {
+                auto &h = hist[p];
+                os << point_name(p)
+                   << " count: " << h.count.load(std::memory_order_acquire)
+                   << " p50: " << to_ns(h.percentile(50))
+                   << " p99: " << to_ns(h.percentile(99))
+                   << " p99.9: " << to_ns(h.percentile(99.9))
+                   << " max: " << to_ns(h.max.load(std::memory_order_relaxed))
+                   << std::endl;
+            }
+        }
+    };
+}
+
+#ifdef ILINK_LATENCY
+#define ILINK_LATENCY_DECL(t) uint64_t t = m2::ilink::latency::now()
+#define ILINK_LATENCY_MARK(t) t = m2::ilink::latency::now()
+#define ILINK_LATENCY_RECORD(stats, point, from, to) \
+    do                                               \
+    {                                                \
+        if (stats)                                   \
+            (stats)->record(point, (to) - (from));   \
+    } while (0)
+#define ILINK_LATENCY_RECORD_SEND(stats, t_encode, t_send)                 \
+    do                                                                    \
+    {                                                                     \
+        ILINK_LATENCY_DECL(t_sent);                                       \
+        ILINK_LATENCY_RECORD(stats, m2::ilink::latency::Encode, t_encode, t_send); \
+        ILINK_LATENCY_RECORD(stats, m2::ilink::latency::Send, t_send, t_sent);     \
+    } while (0)
+#else
+#define ILINK_LATENCY_DECL(t)
+#define ILINK_LATENCY_MARK(t)
+#define ILINK_LATENCY_RECORD(stats, point, from, to)
+#define ILINK_LATENCY_RECORD_SEND(stats, t_encode, t_send)
+#endif
@@ -0,0 +1,765 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ilink_v8/Negotiate500.h"
+#include "ilink_v8/NegotiationResponse501.h"
+#include "ilink_v8/Establish503.h"
+#include "ilink_v8/EstablishmentAck504.h"
+#include "ilink_v8/Sequence506.h"
+#include "ilink_v8/Terminate507.h"
+#include "ilink_v8/NewOrderSingle514.h"
+#include "ilink_v8/OrderCancelReplaceRequest515.h"
+#include "ilink_v8/OrderCancelRequest516.h"
+#include "ilink_v8/ExecutionReportNew522.h"
+#include "ilink_v8/ExecutionReportReject523.h"
+#include "ilink_v8/ExecutionReportElimination524.h"
+#include "ilink_v8/ExecutionReportTradeOutright525.h"
+#include "ilink_v8/ExecutionReportModify531.h"
+#include "ilink_v8/ExecutionReportCancel534.h"
+#include "ilink_v8/OrderCancelReject535.h"
+#include "ilink_v8/OrderCancelReplaceReject536.h"
+
+#include "sock_help.hpp"
+#include "inproc.hpp"
+#include "ilink/ilink_null.hpp"
+
+/***************************************************************
+ *
+ * In-process price-time matching engine
+ *
+ * Sits on the exchange end of an inproc::Channel and answers the
+ * messages ILinkSndT<inproc::InprocTransport> sends with the SBE
+ * messages CME would send back, so a strategy runs the real encoder
+ * and receiver::process_message() without a TCP stack:
+ *
+ *   Negotiate500                  -> NegotiationResponse501 (HMAC not checked)
+ *   Establish503                  -> EstablishmentAck504
+ *   Sequence506                   -> Sequence506
+ *   Terminate507                  -> Terminate507
+ *   NewOrderSingle514             -> ExecutionReportNew522, then
+ *                                    ExecutionReportTradeOutright525 per fill
+ *                                    and ExecutionReportElimination524 for the
+ *                                    unfilled part of a FAK or market order,
+ *                                    stop orders get ExecutionReportReject523
+ *   OrderCancelReplaceRequest515  -> ExecutionReportModify531 (and fills if
+ *                                    the new price crosses) or
+ *                                    OrderCancelReplaceReject536
+ *   OrderCancelRequest516         -> ExecutionReportCancel534 or
+ *                                    OrderCancelReject535
+ *
+ * There is one book per SecurityID, price levels are FIFO queues.
+ * Fills are at the resting order's price. Replace keeps time priority
+ * only when the price is unchanged and the quantity is not increased.
+ *
+ * Market data is simulated with add_liquidity(): such orders rest and
+ * trade like any other but produce no execution reports.
+ *
+ * The engine is not thread safe. From a single thread:
+ *
+ *   inproc::Channel ch;
+ *   sim::MatchingEngine engine(&ch.exchange);
+ *   ILinkSndT<inproc::InprocTransport> snd(...);
+ *   snd.send_new_order_single(&ch.client, ...);
+ *   engine.poll();
+ *   while (receiver::process_message_from_msgw<inproc::InprocTransport>(&ch.client, buf, cbif, false))
+ *     ;
+ *
+ * Replies block while the ring to the client is full, so drain it
+ * between polls. Prices are PRICE9 mantissas, as encoded by ILinkSnd.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::sim
+{
+    class MatchingEngine
+    {
+    public:
+        /**
+         * @param _ep exchange end of the channel
+         */
+        explicit MatchingEngine(inproc::Endpoint *_ep, bool _debug = false)
+            : ep(_ep), debug(_debug)
+        {
+            in.resize(64 * 1024);
+        }
+
+        /**
+         * @brief process every message waiting from the client
+         *
+         * @return number of messages processed
+         */
+        size_t poll() noexcept
+        {
+            size_t n = 0;
+            while (auto header = inproc::InprocTransport::recv_message(ep, in.data(), false))
+            {
+                on_message(*header, in.data());
+                ++n;
+            }
+            return n;
+        }
+
+        /**
+         * @brief add an order that is not ours, it produces no execution reports
+         *
+         * It trades against our resting orders if it crosses them,
+         * what is left rests in the book.
+         *
+         * @return OrderID, to be used with remove_liquidity()
+         */
+        uint64_t add_liquidity(int32_t securityID, sbe::SideReq::Value side, int64_t price, uint32_t qty) noexcept
+        {
+            auto idx = alloc_order();
+            auto &o = pool[idx];
+            memset(o.ClOrdID, 0, sizeof o.ClOrdID);
+            o.OrderID = next_order_id++;
+            o.price = price;
+            o.qty = qty;
+            o.cum = 0;
+            o.securityID = securityID;
+            o.side = side;
+            o.ord_type = sbe::OrderType::Limit;
+            o.tif = sbe::TimeInForce::Day;
+            o.PartyDetailsListReqID = 0;
+            o.OrderRequestID = 0;
+            o.external = true;
+            auto OrderID = o.OrderID;
+            match(idx, true);
+            if (pool[idx].cum < pool[idx].qty)
+                rest(idx);
+            else
+                free_order(idx);
+            return OrderID;
+        }
+
+        /**
+         * @brief remove an order added with add_liquidity()
+         */
+        bool remove_liquidity(uint64_t OrderID) noexcept
+        {
+            auto it = by_order_id.find(OrderID);
+            if (it == by_order_id.end() || !pool[it->second].external)
+                return false;
+            auto idx = it->second;
+            unlink(idx);
+            free_order(idx);
+            return true;
+        }
+
+        /**
+         * @brief best bid and offer, 0 when the side is empty
+         */
+        std::pair<int64_t, int64_t> bbo(int32_t securityID) const noexcept
+        {
+            auto it = books.find(securityID);
+            if (it == books.end())
+                return {0, 0};
+            auto &b = it->second;
+            return {b.bids.empty() ? 0 : b.bids.begin()->first,
+                    b.asks.empty() ? 0 : b.asks.begin()->first};
+        }
+
+        /**
+         * @brief number of orders resting in all books
+         */
+        size_t resting() const noexcept
+        {
+            return by_order_id.size();
+        }
+
+    private:
+        static constexpr uint32_t NIL = UINT32_MAX;
+        static constexpr size_t MAX_MSG_SZ = 2048;
+        static constexpr uint16_t CXL_REJ_UNKNOWN_ORDER = 1003;
+        static constexpr uint16_t ORD_REJ_UNSUPPORTED = 1010;
+        // padded to the field length, the const char * setters copy all of it
+        static constexpr char SENDER_ID[20] = "SIM";
+        static constexpr char LOCATION[5] = {'U', 'S', ',', 'I', 'L'};
+
+        struct order_t
+        {
+            char ClOrdID[20];
+            uint64_t OrderID;
+            int64_t price;
+            uint32_t qty;
+            uint32_t cum;
+            int32_t securityID;
+            sbe::SideReq::Value side;
+            sbe::OrderType::Value ord_type;
+            sbe::TimeInForce::Value tif;
+            uint64_t PartyDetailsListReqID;
+            uint64_t OrderRequestID;
+            bool external;
+            uint32_t prev;
+            uint32_t next;
+        };
+
+        struct level_t
+        {
+            uint32_t head = NIL;
+            uint32_t tail = NIL;
+        };
+
+        struct book_t
+        {
+            std::map<int64_t, level_t, std::greater<int64_t>> bids;
+            std::map<int64_t, level_t> asks;
+        };
+
+        inproc::Endpoint *ep;
+        bool debug;
+        std::vector<char> in;
+        char out[MAX_MSG_SZ];
+        char exec_id[40];
+
+        uint64_t UUID = 0;
+        uint32_t NextSeqNo = 1;
+        uint64_t next_order_id = 1000000;
+        uint64_t next_exec_id = 1;
+        uint64_t next_trade_id = 1;
+
+        std::unordered_map<int32_t, book_t> books;
+        std::unordered_map<uint64_t, uint32_t> by_order_id;
+        std::vector<order_t> pool;
+        std::vector<uint32_t> free_list;
+
+        static uint64_t now_ns() noexcept
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+        }
+
+        //
+        // ORDER STORAGE
+        //
+
+        uint32_t alloc_order() noexcept
+        {
+            if (!free_list.empty())
+            {
+                auto idx = free_list.back();
+                free_list.pop_back();
+                return idx;
+            }
+            pool.emplace_back();
+            return pool.size() - 1;
+        }
+
+        void free_order(uint32_t idx) noexcept
+        {
+            free_list.push_back(idx);
+        }
+
+        uint32_t find_order(uint64_t OrderID, const char *ClOrdID) const noexcept
+        {
+            if (OrderID != UINT64_NULL)
+            {
+                auto it = by_order_id.find(OrderID);
+                if (it != by_order_id.end())
+                    return it->second;
+            }
+            // slow path, the client did not give the OrderID
+            for (auto &kv : by_order_id)
+                if (!pool[kv.second].external && memcmp(pool[kv.second].ClOrdID, ClOrdID, sizeof order_t::ClOrdID) == 0)
+                    return kv.second;
+            return NIL;
+        }
+
+        template <typename F>
+        void with_level(const order_t &o, F &&f) noexcept
+        {
+            auto &b = books[o.securityID];
+            if (o.side == sbe::SideReq::Buy)
+                f(b.bids);
+            else
+                f(b.asks);
+        }
+
+        /**
+         * @brief append to the back of its price level
+         */
+        void rest(uint32_t idx) noexcept
+        {
+            auto &o = pool[idx];
+            with_level(o, [&](auto &side)
+                       {
+                auto &lvl = side[o.price];
+                o.prev = lvl.tail;
+                o.next = NIL;
+                if (lvl.tail != NIL)
+                    pool[lvl.tail].next = idx;
+                else
+                    lvl.head = idx;
+                lvl.tail = idx; });
+            by_order_id[o.OrderID] = idx;
+        }
+
+        /**
+         * @brief remove from its price level
+         */
+        void unlink(uint32_t idx) noexcept
+        {
+            auto &o = pool[idx];
+            with_level(o, [&](auto &side)
+                       {
+                auto it = side.find(o.price);
+                auto &lvl = it->second;
+                if (o.prev != NIL)
+                    pool[o.prev].next = o.next;
+                else
+                    lvl.head = o.next;
+                if (o.next != NIL)
+                    pool[o.next].prev = o.prev;
+                else
+                    lvl.tail = o.prev;
+                if (lvl.head == NIL)
+                    side.erase(it); });
+            by_order_id.erase(o.OrderID);
+        }
+
+        //
+        // MATCHING
+        //
+
+        /**
+         * @brief match order idx (not in the book) against the opposite side
+         *
+         * @param limit false to ignore the limit price (market order)
+         */
+        void match(uint32_t idx, bool limit = true) noexcept
+        {
+            auto &b = books[pool[idx].securityID];
+            if (pool[idx].side == sbe::SideReq::Buy)
+                match_side(idx, b.asks, limit, [](int64_t px, int64_t lim)
+                           { return px <= lim; });
+            else
+                match_side(idx, b.bids, limit, [](int64_t px, int64_t lim)
+                           { return px >= lim; });
+        }
+
+        template <typename Side, typename Crosses>
+        void match_side(uint32_t idx, Side &side, bool limit, Crosses crosses) noexcept
+        {
+            while (pool[idx].cum < pool[idx].qty && !side.empty())
+            {
+                auto it = side.begin();
+                if (limit && !crosses(it->first, pool[idx].price))
+                    break;
+                auto &lvl = it->second;
+                while (lvl.head != NIL && pool[idx].cum < pool[idx].qty)
+                {
+                    auto ridx = lvl.head;
+                    auto &r = pool[ridx];
+                    auto &a = pool[idx];
+                    auto qty = std::min(a.qty - a.cum, r.qty - r.cum);
+                    auto px = it->first;
+                    auto TradeID = next_trade_id++;
+                    a.cum += qty;
+                    r.cum += qty;
+                    if (!a.external)
+                        send_fill(a, px, qty, TradeID, true);
+                    if (!r.external)
+                        send_fill(r, px, qty, TradeID, false);
+                    if (r.cum == r.qty)
+                    {
+                        lvl.head = r.next;
+                        if (lvl.head != NIL)
+                            pool[lvl.head].prev = NIL;
+                        else
+                            lvl.tail = NIL;
+                        by_order_id.erase(r.OrderID);
+                        free_order(ridx);
+                    }
+                }
+                if (lvl.head == NIL)
+                    side.erase(it);
+            }
+        }
+
+        //
+        // MESSAGE HANDLING
+        //
+
+        void on_message(const sockhelp::cme_msg_header_t &header, char *msg_buf) noexcept
+        {
+            if (debug)
+                std::cerr << "engine: received " << header.TemplateID << std::endl;
+
+            switch (header.TemplateID)
+            {
+            case sbe::Negotiate500::sbeTemplateId():
+            {
+                sbe::Negotiate500 negotiate;
+                auto msg = negotiate.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                auto rep = begin<sbe::NegotiationResponse501>();
+                UUID = msg.uUID();
+                NextSeqNo = 1;
+                rep.uUID(UUID);
+                rep.requestTimestamp(msg.requestTimestamp());
+                rep.secretKeySecureIDExpiration(UINT16_NULL);
+                rep.faultToleranceIndicator(sbe::FTI::Primary);
+                rep.splitMsg(sbe::SplitMsg::NULL_VALUE);
+                rep.previousSeqNo(0);
+                rep.previousUUID(0);
+                reply(rep, true);
+                break;
+            }
+            case sbe::Establish503::sbeTemplateId():
+            {
+                sbe::Establish503 establish;
+                auto msg = establish.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                auto rep = begin<sbe::EstablishmentAck504>();
+                rep.uUID(UUID);
+                rep.requestTimestamp(msg.requestTimestamp());
+                rep.nextSeqNo(NextSeqNo);
+                rep.previousSeqNo(NextSeqNo - 1);
+                rep.previousUUID(UUID);
+                rep.keepAliveInterval(msg.keepAliveInterval());
+                rep.secretKeySecureIDExpiration(UINT16_NULL);
+                rep.faultToleranceIndicator(sbe::FTI::Primary);
+                rep.splitMsg(sbe::SplitMsg::NULL_VALUE);
+                reply(rep);
+                break;
+            }
+            case sbe::Sequence506::sbeTemplateId():
+            {
+                auto rep = begin<sbe::Sequence506>();
+                rep.uUID(UUID);
+                rep.nextSeqNo(NextSeqNo);
+                rep.faultToleranceIndicator(sbe::FTI::Primary);
+                rep.keepAliveIntervalLapsed(sbe::KeepAliveLapsed::NotLapsed);
+                reply(rep);
+                break;
+            }
+            case sbe::Terminate507::sbeTemplateId():
+            {
+                sbe::Terminate507 terminate;
+                auto msg = terminate.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                auto rep = begin<sbe::Terminate507>();
+                rep.putReason(std::string("terminate echo"));
+                rep.uUID(UUID);
+                rep.requestTimestamp(now_ns());
+                rep.errorCodes(msg.errorCodes());
+                rep.splitMsg(sbe::SplitMsg::NULL_VALUE);
+                reply(rep);
+                break;
+            }
+            case sbe::NewOrderSingle514::sbeTemplateId():
+            {
+                sbe::NewOrderSingle514 newOrderSingle;
+                auto msg = newOrderSingle.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                on_new_order(msg);
+                break;
+            }
+            case sbe::OrderCancelReplaceRequest515::sbeTemplateId():
+            {
+                sbe::OrderCancelReplaceRequest515 cancelReplace;
+                auto msg = cancelReplace.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                on_cancel_replace(msg);
+                break;
+            }
+            case sbe::OrderCancelRequest516::sbeTemplateId():
+            {
+                sbe::OrderCancelRequest516 cancel;
+                auto msg = cancel.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                on_cancel(msg);
+                break;
+            }
+            default:
+                if (debug)
+                    std::cerr << "engine: ignoring template " << header.TemplateID << std::endl;
+            }
+        }
+
+        /**
+         * @brief encode a reply into out, fields not set are zero
+         */
+        template <typename R>
+        R begin() noexcept
+        {
+            memset(out, 0, sockhelp::SOFH_AND_SBE_HEADER_SIZE + R::sbeBlockLength());
+            R rep;
+            rep.wrapAndApplyHeader(out, sockhelp::SOFH_HEADER_SIZE, sizeof out);
+            return rep;
+        }
+
+        template <typename R>
+        void reply(R &rep, bool add_cred = false) noexcept
+        {
+            if (debug)
+                std::cerr << "engine: sending " << rep << std::endl;
+            inproc::InprocTransport::send_message(ep, out, rep.encodedLength(), add_cred);
+        }
+
+        const char *take_exec_id() noexcept
+        {
+            memset(exec_id, 0, sizeof exec_id);
+            snprintf(exec_id, sizeof exec_id, "%llu", (unsigned long long)next_exec_id++);
+            return exec_id;
+        }
+
+        /**
+         * @brief fields shared by all the execution reports
+         */
+        template <typename R>
+        void fill_report(R &rep, const order_t &o) noexcept
+        {
+            auto ts = now_ns();
+            rep.seqNum(NextSeqNo++);
+            rep.uUID(UUID);
+            rep.putExecID(take_exec_id());
+            rep.putSenderID(SENDER_ID);
+            rep.putClOrdID(o.ClOrdID);
+            rep.partyDetailsListReqID(o.PartyDetailsListReqID);
+            rep.orderID(o.OrderID);
+            rep.transactTime(ts);
+            rep.sendingTimeEpoch(ts);
+            rep.orderRequestID(o.OrderRequestID);
+            rep.putLocation(LOCATION);
+            rep.securityID(o.securityID);
+            rep.side(o.side);
+            rep.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+            rep.possRetransFlag(sbe::BooleanFlag::False);
+        }
+
+        template <typename R>
+        void fill_terms(R &rep, const order_t &o) noexcept
+        {
+            rep.price().mantissa(o.price);
+            rep.stopPx().mantissa(sbe::PRICENULL9::mantissaNullValue());
+            rep.orderQty(o.qty);
+            rep.ordType(o.ord_type);
+            rep.timeInForce(o.tif);
+        }
+
+        void send_fill(const order_t &o, int64_t px, uint32_t qty, uint64_t TradeID, bool aggressor) noexcept
+        {
+            auto rep = begin<sbe::ExecutionReportTradeOutright525>();
+            fill_report(rep, o);
+            fill_terms(rep, o);
+            rep.lastPx().mantissa(px);
+            rep.lastQty(qty);
+            rep.cumQty(o.cum);
+            rep.leavesQty(o.qty - o.cum);
+            rep.sideTradeID(TradeID);
+            rep.ordStatus(o.cum == o.qty ? sbe::OrdStatusTrd::Filled : sbe::OrdStatusTrd::PartiallyFilled);
+            rep.aggressorIndicator(aggressor ? sbe::BooleanFlag::True : sbe::BooleanFlag::False);
+            rep.noFillsCount(0);
+            rep.noOrderEventsCount(0);
+            reply(rep);
+        }
+
+        void send_elimination(const order_t &o) noexcept
+        {
+            auto rep = begin<sbe::ExecutionReportElimination524>();
+            fill_report(rep, o);
+            fill_terms(rep, o);
+            rep.cumQty(o.cum);
+            rep.minQty(UINT32_NULL);
+            rep.displayQty(UINT32_NULL);
+            rep.expireDate(UINT16_NULL);
+            reply(rep);
+        }
+
+        void on_new_order(sbe::NewOrderSingle514 &msg) noexcept
+        {
+            auto idx = alloc_order();
+            auto &o = pool[idx];
+            memcpy(o.ClOrdID, msg.clOrdID(), sizeof o.ClOrdID);
+            o.OrderID = next_order_id++;
+            o.price = msg.price().mantissa();
+            o.qty = msg.orderQty();
+            o.cum = 0;
+            o.securityID = msg.securityID();
+            o.side = msg.side();
+            o.ord_type = sbe::OrderType::get((char)msg.ordType());
+            o.tif = msg.timeInForce();
+            o.PartyDetailsListReqID = msg.partyDetailsListReqID();
+            o.OrderRequestID = msg.orderRequestID();
+            o.external = false;
+
+            if (msg.ordType() == sbe::OrderTypeReq::StopLimit || msg.ordType() == sbe::OrderTypeReq::StopwithProtection)
+            {
+                auto rep = begin<sbe::ExecutionReportReject523>();
+                fill_report(rep, o);
+                fill_terms(rep, o);
+                rep.putText(std::string("stop orders not supported by simulator"));
+                rep.ordRejReason(ORD_REJ_UNSUPPORTED);
+                rep.minQty(msg.minQty());
+                rep.displayQty(msg.displayQty());
+                rep.expireDate(msg.expireDate());
+                reply(rep);
+                free_order(idx);
+                return;
+            }
+
+            {
+                auto rep = begin<sbe::ExecutionReportNew522>();
+                fill_report(rep, o);
+                fill_terms(rep, o);
+                rep.displayQty(msg.displayQty());
+                rep.minQty(msg.minQty());
+                rep.expireDate(msg.expireDate());
+                reply(rep);
+            }
+
+            bool limit = msg.ordType() == sbe::OrderTypeReq::Limit;
+            match(idx, limit);
+            auto &n = pool[idx];
+            if (n.cum == n.qty)
+                free_order(idx);
+            else if (!limit || n.tif == sbe::TimeInForce::FillAndKill)
+            {
+                send_elimination(n);
+                free_order(idx);
+            }
+            else
+                rest(idx);
+        }
+
+        template <typename R, typename M>
+        void send_cancel_reject(M &msg) noexcept
+        {
+            auto rep = begin<R>();
+            auto ts = now_ns();
+            rep.seqNum(NextSeqNo++);
+            rep.uUID(UUID);
+            rep.putExecID(take_exec_id());
+            rep.putSenderID(SENDER_ID);
+            rep.putClOrdID(msg.clOrdID());
+            rep.partyDetailsListReqID(msg.partyDetailsListReqID());
+            rep.orderID(msg.orderID());
+            rep.transactTime(ts);
+            rep.sendingTimeEpoch(ts);
+            rep.orderRequestID(msg.orderRequestID());
+            rep.putLocation(LOCATION);
+            rep.cxlRejReason(CXL_REJ_UNKNOWN_ORDER);
+            rep.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+            rep.possRetransFlag(sbe::BooleanFlag::False);
+            reply(rep);
+        }
+
+        void on_cancel_replace(sbe::OrderCancelReplaceRequest515 &msg) noexcept
+        {
+            auto idx = find_order(msg.orderID(), msg.clOrdID());
+            if (idx == NIL || pool[idx].external)
+            {
+                send_cancel_reject<sbe::OrderCancelReplaceReject536>(msg);
+                return;
+            }
+            auto &o = pool[idx];
+            auto price = msg.price().mantissa();
+            auto qty = msg.orderQty();
+            bool keep_priority = price == o.price && qty <= o.qty;
+            if (!keep_priority)
+                unlink(idx);
+            memcpy(o.ClOrdID, msg.clOrdID(), sizeof o.ClOrdID);
+            o.price = price;
+            o.qty = qty;
+            o.tif = msg.timeInForce();
+            o.PartyDetailsListReqID = msg.partyDetailsListReqID();
+            o.OrderRequestID = msg.orderRequestID();
+
+            {
+                auto rep = begin<sbe::ExecutionReportModify531>();
+                fill_report(rep, o);
+                fill_terms(rep, o);
+                rep.cumQty(o.cum);
+                rep.leavesQty(o.qty > o.cum ? o.qty - o.cum : 0);
+                rep.displayQty(msg.displayQty());
+                rep.minQty(msg.minQty());
+                rep.expireDate(msg.expireDate());
+                reply(rep);
+            }
+
+            if (o.qty <= o.cum)
+            {
+                // reduced to no more than the filled quantity, order is done
+                if (keep_priority)
+                    unlink(idx);
+                free_order(idx);
+                return;
+            }
+            if (keep_priority)
+                return;
+            match(idx);
+            if (pool[idx].cum == pool[idx].qty)
+                free_order(idx);
+            else
+                rest(idx);
+        }
+
+        void on_cancel(sbe::OrderCancelRequest516 &msg) noexcept
+        {
+            auto idx = find_order(msg.orderID(), msg.clOrdID());
+            if (idx == NIL || pool[idx].external)
+            {
+                send_cancel_reject<sbe::OrderCancelReject535>(msg);
+                return;
+            }
+            auto &o = pool[idx];
+            memcpy(o.ClOrdID, msg.clOrdID(), sizeof o.ClOrdID);
+            o.OrderRequestID = msg.orderRequestID();
+            auto rep = begin<sbe::ExecutionReportCancel534>();
+            fill_report(rep, o);
+            fill_terms(rep, o);
+            rep.cumQty(o.cum);
+            reply(rep);
+            unlink(idx);
+            free_order(idx);
+        }
+    };
+}
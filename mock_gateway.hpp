@@ -0,0 +1,822 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ilink_v8/Negotiate500.h"
+#include "ilink_v8/NegotiationResponse501.h"
+#include "ilink_v8/NegotiationReject502.h"
+#include "ilink_v8/Establish503.h"
+#include "ilink_v8/EstablishmentAck504.h"
+#include "ilink_v8/EstablishmentReject505.h"
+#include "ilink_v8/Sequence506.h"
+#include "ilink_v8/Terminate507.h"
+#include "ilink_v8/RetransmitRequest508.h"
+#include "ilink_v8/RetransmitReject510.h"
+#include "ilink_v8/NewOrderSingle514.h"
+#include "ilink_v8/OrderCancelReplaceRequest515.h"
+#include "ilink_v8/OrderCancelRequest516.h"
+#include "ilink_v8/ExecutionReportNew522.h"
+#include "ilink_v8/ExecutionReportModify531.h"
+#include "ilink_v8/ExecutionReportCancel534.h"
+#include "ilink_v8/ExecutionReportTradeOutright525.h"
+#include "ilink_v8/OrderCancelReject535.h"
+
+#include "sock_help.hpp"
+#include "sign.hpp"
+#include "ilink/ilink_null.hpp"
+
+/***************************************************************
+ *
+ * Mock CME iLink3 gateway for loopback testing
+ *
+ * Speaks the session layer implemented by ILinkSnd and the receiver:
+ * Negotiate500 and Establish503 are checked with calculateHMAC() and
+ * answered with 501/504 (or 502/505), Sequence506 is answered with a
+ * heartbeat, Terminate507 is echoed and the connection closed.
+ *
+ * Orders are acknowledged with the matching execution reports:
+ *   NewOrderSingle514             -> ExecutionReportNew522
+ *                                    and, fill_pct percent of the time,
+ *                                    ExecutionReportTradeOutright525
+ *   OrderCancelReplaceRequest515  -> ExecutionReportModify531
+ *   OrderCancelRequest516         -> ExecutionReportCancel534
+ * Replace or cancel of an unknown order gets OrderCancelReject535.
+ *
+ * Every gap_every messages a sequence number is skipped so the client
+ * sees a gap. With drop_after the connection is closed after that many
+ * client messages, to test reconnect and failover. With backup_port
+ * set the gateway also listens there as the backup gateway: the same
+ * sessions, with FaultToleranceIndicator Backup in 501, 504 and 506.
+ *
+ * Session state (UUID, sequence numbers and working orders) is kept per
+ * SessionID and outlives the connection, so a client can Establish its
+ * UUID again on a new connection without negotiating. Only one
+ * connection per session may be active at a time.
+ *
+ * With flood set, that many fills are pushed to the client right after
+ * Establish, encoded in large batches, to load test the receive path.
+ *
+ * Replies are batched in one buffer per connection and written when
+ * no more client messages are waiting.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::mock
+{
+    struct config_t
+    {
+        int port = 9000;
+        int backup_port = 0;      // also listen here as the backup gateway, 0 = no backup
+        std::string secret_key;   // base64url, same as given to ILinkSnd
+        int fill_pct = 0;         // percent of new orders filled at once
+        uint32_t gap_every = 0;   // skip a sequence number every n messages, 0 = never
+        uint64_t drop_after = 0;  // close connection after n client messages, 0 = never
+        uint64_t flood = 0;       // fills pushed after establish
+        uint16_t keep_alive = 0;  // 0 = accept the client value
+        bool debug = false;
+    };
+
+    struct order_t
+    {
+        std::string ClOrdID;
+        int64_t price;
+        uint32_t qty;
+        uint32_t cum;
+        int32_t securityID;
+        sbe::SideReq::Value side;
+        sbe::OrderType::Value ord_type;
+        sbe::TimeInForce::Value tif;
+    };
+
+    /**
+     * @brief state of one iLink session, kept across connections
+     *
+     * Connections on the primary and the backup port may share it, the
+     * connection handling a message holds mtx.
+     */
+    struct session_t
+    {
+        std::mutex mtx;
+        uint64_t UUID = 0;
+        uint32_t NextSeqNo = 1;
+        uint64_t next_order_id = 1000000;
+        uint64_t next_exec_id = 1;
+        uint64_t next_trade_id = 1;
+        std::unordered_map<uint64_t, order_t> orders;
+        std::unordered_map<std::string, uint64_t> clordid_to_orderid;
+    };
+
+    /**
+     * @brief sessions by SessionID
+     *
+     */
+    class SessionRegistry
+    {
+    public:
+        std::shared_ptr<session_t> get(const std::string &SessionID)
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            auto &ses = sessions[SessionID];
+            if (!ses)
+                ses = std::make_shared<session_t>();
+            return ses;
+        }
+
+    private:
+        std::mutex mtx;
+        std::unordered_map<std::string, std::shared_ptr<session_t>> sessions;
+    };
+
+    /**
+     * @brief one client connection
+     *
+     */
+    class Connection
+    {
+    public:
+        Connection(int _sock, const config_t &_cfg, std::shared_ptr<SessionRegistry> _registry, uint64_t _conn_id,
+                   sbe::FTI::Value _fti = sbe::FTI::Primary)
+            : sock(_sock), cfg(_cfg), registry(_registry), rng(_conn_id), conn_id(_conn_id), fti(_fti)
+        {
+            out.resize(OUT_SZ);
+        }
+
+        ~Connection()
+        {
+            close(sock);
+        }
+
+        void run()
+        {
+            std::vector<char> msg_buf(64 * 1024);
+            bool block = true;
+            while (running)
+            {
+                auto header = sockhelp::recv_message(sock, msg_buf.data(), block);
+                if (!header)
+                {
+                    if (!block)
+                    {
+                        // nothing waiting, send the replies and wait
+                        if (!flush())
+                            break;
+                        block = true;
+                        continue;
+                    }
+                    break;
+                }
+                on_message(*header, msg_buf.data());
+                ++client_msgs;
+                if (cfg.drop_after && client_msgs >= cfg.drop_after)
+                {
+                    flush();
+                    std::cerr << "mock: dropping connection " << conn_id << " after " << client_msgs << " messages" << std::endl;
+                    break;
+                }
+                block = false;
+            }
+            flush();
+        }
+
+    private:
+        static constexpr size_t OUT_SZ = 4 * 1024 * 1024;
+        static constexpr size_t MAX_MSG_SZ = 2048;
+
+        int sock;
+        config_t cfg;
+        std::shared_ptr<SessionRegistry> registry;
+        std::mt19937_64 rng;
+        uint64_t conn_id;
+        sbe::FTI::Value fti; // Backup on the backup port
+        bool running = true;
+        bool established = false;
+        std::vector<char> out;
+        size_t out_pos = 0;
+        uint64_t client_msgs = 0;
+        std::shared_ptr<session_t> ses;
+
+        static uint64_t now_ns() noexcept
+        {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+        }
+
+        uint32_t take_seq_no() noexcept
+        {
+            if (cfg.gap_every && ses->NextSeqNo % cfg.gap_every == 0)
+                ++ses->NextSeqNo;
+            return ses->NextSeqNo++;
+        }
+
+        /**
+         * @brief space for one message in the out buffer,
+         * the message is encoded at SOFH_HEADER_SIZE
+         */
+        char *reserve() noexcept
+        {
+            if (out_pos + MAX_MSG_SZ > out.size())
+                flush();
+            return out.data() + out_pos;
+        }
+
+        void commit(char *buffer, size_t len, bool add_cred = false) noexcept
+        {
+            out_pos += sockhelp::frame_message(buffer, len, add_cred);
+        }
+
+        bool flush() noexcept
+        {
+            size_t off = 0;
+            while (off < out_pos)
+            {
+                auto n = send(sock, out.data() + off, out_pos - off, MSG_NOSIGNAL);
+                if (n <= 0)
+                {
+                    running = false;
+                    out_pos = 0;
+                    return false;
+                }
+                off += n;
+            }
+            out_pos = 0;
+            return true;
+        }
+
+        void on_message(const sockhelp::cme_msg_header_t &header, char *msg_buf)
+        {
+            if (cfg.debug)
+                std::cerr << "mock: received " << header.TemplateID << std::endl;
+
+            bool session_msg = header.TemplateID == sbe::Negotiate500::sbeTemplateId() ||
+                               header.TemplateID == sbe::Establish503::sbeTemplateId();
+            if (!session_msg && !established)
+            {
+                std::cerr << "mock: message " << header.TemplateID << " before Establish" << std::endl;
+                running = false;
+                return;
+            }
+            // Negotiate and Establish lock the session they look up
+            std::unique_lock<std::mutex> lock;
+            if (!session_msg)
+                lock = std::unique_lock<std::mutex>(ses->mtx);
+
+            switch (header.TemplateID)
+            {
+            case sbe::Negotiate500::sbeTemplateId():
+            {
+                sbe::Negotiate500 negotiate;
+                auto msg = negotiate.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                on_negotiate(msg);
+                break;
+            }
+            case sbe::Establish503::sbeTemplateId():
+            {
+                sbe::Establish503 establish;
+                auto msg = establish.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                on_establish(msg);
+                break;
+            }
+            case sbe::Sequence506::sbeTemplateId():
+            {
+                send_sequence();
+                break;
+            }
+            case sbe::Terminate507::sbeTemplateId():
+            {
+                sbe::Terminate507 terminate;
+                auto msg = terminate.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                send_terminate(msg.errorCodes(), "terminate echo");
+                running = false;
+                break;
+            }
+            case sbe::RetransmitRequest508::sbeTemplateId():
+            {
+                sbe::RetransmitRequest508 retransmitRequest;
+                auto msg = retransmitRequest.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                send_retransmit_reject(msg.requestTimestamp());
+                break;
+            }
+            case sbe::NewOrderSingle514::sbeTemplateId():
+            {
+                sbe::NewOrderSingle514 newOrderSingle;
+                auto msg = newOrderSingle.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                on_new_order(msg);
+                break;
+            }
+            case sbe::OrderCancelReplaceRequest515::sbeTemplateId():
+            {
+                sbe::OrderCancelReplaceRequest515 cancelReplace;
+                auto msg = cancelReplace.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                on_cancel_replace(msg);
+                break;
+            }
+            case sbe::OrderCancelRequest516::sbeTemplateId():
+            {
+                sbe::OrderCancelRequest516 cancel;
+                auto msg = cancel.wrapForDecode(msg_buf, 0, header.BlockLength, header.Version, header.MsgSize);
+                on_cancel(msg);
+                break;
+            }
+            default:
+                if (cfg.debug)
+                    std::cerr << "mock: ignoring template " << header.TemplateID << std::endl;
+            }
+        }
+
+        bool check_hmac(const std::string &canonical, const char *signature) const
+        {
+            auto expected = calculateHMAC(cfg.secret_key, canonical);
+            return expected.size() == 32 && memcmp(expected.data(), signature, 32) == 0;
+        }
+
+        //
+        // SESSION LAYER
+        //
+
+        void on_negotiate(sbe::Negotiate500 &msg)
+        {
+            std::string canonical;
+            canonical.append(std::to_string(msg.requestTimestamp())).append("\n");
+            canonical.append(std::to_string(msg.uUID())).append("\n");
+            canonical.append(msg.getSessionAsString()).append("\n");
+            canonical.append(msg.getFirmAsString());
+
+            ses = registry->get(msg.getSessionAsString());
+            std::lock_guard<std::mutex> lock(ses->mtx);
+            auto buffer = reserve();
+            if (!check_hmac(canonical, msg.hMACSignature()))
+            {
+                sbe::NegotiationReject502 negotiationReject;
+                auto rep = negotiationReject.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+                rep.putReason(std::string("HMAC signature mismatch"));
+                rep.uUID(msg.uUID());
+                rep.requestTimestamp(msg.requestTimestamp());
+                rep.errorCodes(1);
+                rep.faultToleranceIndicator(fti);
+                commit(buffer, rep.encodedLength());
+                return;
+            }
+
+            auto previous_uuid = ses->UUID;
+            auto previous_seq = ses->NextSeqNo - 1;
+            ses->UUID = msg.uUID();
+            ses->NextSeqNo = 1;
+            sbe::NegotiationResponse501 negotiationResponse;
+            auto rep = negotiationResponse.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+            rep.uUID(ses->UUID);
+            rep.requestTimestamp(msg.requestTimestamp());
+            rep.secretKeySecureIDExpiration(UINT16_NULL);
+            rep.faultToleranceIndicator(fti);
+            rep.splitMsg(sbe::SplitMsg::NULL_VALUE);
+            rep.previousSeqNo(previous_uuid ? previous_seq : 0);
+            rep.previousUUID(previous_uuid);
+            commit(buffer, rep.encodedLength(), true);
+        }
+
+        void on_establish(sbe::Establish503 &msg)
+        {
+            std::string canonical;
+            canonical.append(std::to_string(msg.requestTimestamp())).append("\n");
+            canonical.append(std::to_string(msg.uUID())).append("\n");
+            canonical.append(msg.getSessionAsString()).append("\n");
+            canonical.append(msg.getFirmAsString()).append("\n");
+            canonical.append(msg.getTradingSystemNameAsString()).append("\n");
+            canonical.append(msg.getTradingSystemVersionAsString()).append("\n");
+            canonical.append(msg.getTradingSystemVendorAsString()).append("\n");
+            canonical.append(std::to_string(msg.nextSeqNo())).append("\n");
+            canonical.append(std::to_string(msg.keepAliveInterval()));
+
+            ses = registry->get(msg.getSessionAsString());
+            std::lock_guard<std::mutex> lock(ses->mtx);
+            auto buffer = reserve();
+            bool ok = check_hmac(canonical, msg.hMACSignature());
+            //
+            // the negotiated UUID can be established again by a new
+            // connection (e.g. after failover) without negotiating
+            //
+            if (!ok || msg.uUID() != ses->UUID)
+            {
+                sbe::EstablishmentReject505 establishmentReject;
+                auto rep = establishmentReject.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+                rep.putReason(std::string(ok ? "UUID not negotiated" : "HMAC signature mismatch"));
+                rep.uUID(msg.uUID());
+                rep.requestTimestamp(msg.requestTimestamp());
+                rep.nextSeqNo(ses->NextSeqNo);
+                rep.errorCodes(ok ? 2 : 1);
+                rep.faultToleranceIndicator(fti);
+                commit(buffer, rep.encodedLength());
+                return;
+            }
+
+            sbe::EstablishmentAck504 establishmentAck;
+            auto rep = establishmentAck.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+            rep.uUID(ses->UUID);
+            rep.requestTimestamp(msg.requestTimestamp());
+            rep.nextSeqNo(ses->NextSeqNo);
+            rep.previousSeqNo(ses->NextSeqNo - 1);
+            rep.previousUUID(ses->UUID);
+            rep.keepAliveInterval(cfg.keep_alive ? cfg.keep_alive : msg.keepAliveInterval());
+            rep.secretKeySecureIDExpiration(UINT16_NULL);
+            rep.faultToleranceIndicator(fti);
+            rep.splitMsg(sbe::SplitMsg::NULL_VALUE);
+            commit(buffer, rep.encodedLength());
+            established = true;
+
+            if (cfg.flood)
+                flood(cfg.flood);
+        }
+
+        void send_sequence()
+        {
+            auto buffer = reserve();
+            sbe::Sequence506 sequence;
+            auto rep = sequence.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+            rep.uUID(ses->UUID);
+            rep.nextSeqNo(ses->NextSeqNo);
+            rep.faultToleranceIndicator(fti);
+            rep.keepAliveIntervalLapsed(sbe::KeepAliveLapsed::NotLapsed);
+            commit(buffer, rep.encodedLength());
+        }
+
+        void send_terminate(uint16_t errorCodes, const std::string &reason)
+        {
+            auto buffer = reserve();
+            sbe::Terminate507 terminate;
+            auto rep = terminate.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+            rep.putReason(reason);
+            rep.uUID(ses->UUID);
+            rep.requestTimestamp(now_ns());
+            rep.errorCodes(errorCodes);
+            rep.splitMsg(sbe::SplitMsg::NULL_VALUE);
+            commit(buffer, rep.encodedLength());
+        }
+
+        void send_retransmit_reject(uint64_t RequestTimestamp)
+        {
+            auto buffer = reserve();
+            sbe::RetransmitReject510 retransmitReject;
+            auto rep = retransmitReject.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+            rep.putReason(std::string("mock gateway keeps no history"));
+            rep.uUID(ses->UUID);
+            rep.lastUUID(UINT64_NULL);
+            rep.requestTimestamp(RequestTimestamp);
+            rep.errorCodes(0);
+            rep.splitMsg(sbe::SplitMsg::NULL_VALUE);
+            commit(buffer, rep.encodedLength());
+        }
+
+        //
+        // APPLICATION LAYER
+        //
+
+        /**
+         * @brief fields shared by all the execution reports
+         */
+        template <typename R>
+        void fill_report(R &rep, const order_t &o, uint64_t OrderID, uint64_t OrderRequestID, uint64_t PartyDetailsListReqID)
+        {
+            auto ts = now_ns();
+            rep.seqNum(take_seq_no());
+            rep.uUID(ses->UUID);
+            rep.putExecID(std::to_string(ses->next_exec_id++));
+            rep.putSenderID(std::string("MOCK"));
+            rep.putClOrdID(o.ClOrdID);
+            rep.partyDetailsListReqID(PartyDetailsListReqID);
+            rep.orderID(OrderID);
+            rep.transactTime(ts);
+            rep.sendingTimeEpoch(ts);
+            rep.orderRequestID(OrderRequestID);
+            rep.putLocation(std::string("US,IL"));
+            rep.securityID(o.securityID);
+            rep.side(o.side);
+            rep.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+            rep.possRetransFlag(sbe::BooleanFlag::False);
+        }
+
+        template <typename R>
+        void fill_terms(R &rep, const order_t &o)
+        {
+            rep.price().mantissa(o.price);
+            rep.stopPx().mantissa(sbe::PRICENULL9::mantissaNullValue());
+            rep.orderQty(o.qty);
+            rep.ordType(o.ord_type);
+            rep.timeInForce(o.tif);
+        }
+
+        void send_fill(uint64_t OrderID, order_t &o, uint32_t qty, uint64_t OrderRequestID, uint64_t PartyDetailsListReqID)
+        {
+            o.cum += qty;
+            auto buffer = reserve();
+            sbe::ExecutionReportTradeOutright525 executionReportTradeOutright;
+            auto rep = executionReportTradeOutright.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+            fill_report(rep, o, OrderID, OrderRequestID, PartyDetailsListReqID);
+            fill_terms(rep, o);
+            rep.lastPx().mantissa(o.price);
+            rep.lastQty(qty);
+            rep.cumQty(o.cum);
+            rep.leavesQty(o.qty - o.cum);
+            rep.sideTradeID(ses->next_trade_id++);
+            rep.ordStatus(o.cum == o.qty ? sbe::OrdStatusTrd::Filled : sbe::OrdStatusTrd::PartiallyFilled);
+            rep.aggressorIndicator(sbe::BooleanFlag::True);
+            rep.noFillsCount(0);
+            rep.noOrderEventsCount(0);
+            commit(buffer, rep.encodedLength());
+        }
+
+        void on_new_order(sbe::NewOrderSingle514 &msg)
+        {
+            auto &orders = ses->orders;
+            auto OrderID = ses->next_order_id++;
+            auto &o = orders[OrderID];
+            o.ClOrdID = msg.getClOrdIDAsString();
+            o.price = msg.price().mantissa();
+            o.qty = msg.orderQty();
+            o.cum = 0;
+            o.securityID = msg.securityID();
+            o.side = msg.side();
+            o.ord_type = sbe::OrderType::get((char)msg.ordType());
+            o.tif = msg.timeInForce();
+            ses->clordid_to_orderid[o.ClOrdID] = OrderID;
+
+            auto buffer = reserve();
+            sbe::ExecutionReportNew522 executionReportNew;
+            auto rep = executionReportNew.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+            fill_report(rep, o, OrderID, msg.orderRequestID(), msg.partyDetailsListReqID());
+            fill_terms(rep, o);
+            rep.displayQty(msg.displayQty());
+            rep.minQty(msg.minQty());
+            rep.expireDate(msg.expireDate());
+            commit(buffer, rep.encodedLength());
+
+            if (cfg.fill_pct && int(rng() % 100) < cfg.fill_pct)
+            {
+                send_fill(OrderID, o, o.qty, msg.orderRequestID(), msg.partyDetailsListReqID());
+                ses->clordid_to_orderid.erase(o.ClOrdID);
+                orders.erase(OrderID);
+            }
+        }
+
+        uint64_t find_order(uint64_t OrderID, const std::string &ClOrdID) const
+        {
+            if (OrderID != UINT64_NULL && ses->orders.count(OrderID))
+                return OrderID;
+            auto it = ses->clordid_to_orderid.find(ClOrdID);
+            return it == ses->clordid_to_orderid.end() ? UINT64_NULL : it->second;
+        }
+
+        template <typename M>
+        void send_cancel_reject(M &msg, const std::string &ClOrdID)
+        {
+            auto buffer = reserve();
+            sbe::OrderCancelReject535 orderCancelReject;
+            auto rep = orderCancelReject.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+            auto ts = now_ns();
+            rep.seqNum(take_seq_no());
+            rep.uUID(ses->UUID);
+            rep.putExecID(std::to_string(ses->next_exec_id++));
+            rep.putSenderID(std::string("MOCK"));
+            rep.putClOrdID(ClOrdID);
+            rep.partyDetailsListReqID(msg.partyDetailsListReqID());
+            rep.orderID(msg.orderID());
+            rep.transactTime(ts);
+            rep.sendingTimeEpoch(ts);
+            rep.orderRequestID(msg.orderRequestID());
+            rep.putLocation(std::string("US,IL"));
+            rep.cxlRejReason(1003); // order not in book
+            rep.manualOrderIndicator(sbe::ManualOrdIndReq::Automated);
+            rep.possRetransFlag(sbe::BooleanFlag::False);
+            commit(buffer, rep.encodedLength());
+        }
+
+        void on_cancel_replace(sbe::OrderCancelReplaceRequest515 &msg)
+        {
+            auto ClOrdID = msg.getClOrdIDAsString();
+            auto OrderID = find_order(msg.orderID(), ClOrdID);
+            if (OrderID == UINT64_NULL)
+            {
+                send_cancel_reject(msg, ClOrdID);
+                return;
+            }
+            auto &o = ses->orders[OrderID];
+            if (o.ClOrdID != ClOrdID)
+            {
+                ses->clordid_to_orderid.erase(o.ClOrdID);
+                o.ClOrdID = ClOrdID;
+                ses->clordid_to_orderid[ClOrdID] = OrderID;
+            }
+            o.price = msg.price().mantissa();
+            o.qty = msg.orderQty();
+            o.tif = msg.timeInForce();
+
+            auto buffer = reserve();
+            sbe::ExecutionReportModify531 executionReportModify;
+            auto rep = executionReportModify.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+            fill_report(rep, o, OrderID, msg.orderRequestID(), msg.partyDetailsListReqID());
+            fill_terms(rep, o);
+            rep.cumQty(o.cum);
+            rep.leavesQty(o.qty > o.cum ? o.qty - o.cum : 0);
+            rep.displayQty(msg.displayQty());
+            rep.minQty(msg.minQty());
+            rep.expireDate(msg.expireDate());
+            commit(buffer, rep.encodedLength());
+        }
+
+        void on_cancel(sbe::OrderCancelRequest516 &msg)
+        {
+            auto ClOrdID = msg.getClOrdIDAsString();
+            auto OrderID = find_order(msg.orderID(), ClOrdID);
+            if (OrderID == UINT64_NULL)
+            {
+                send_cancel_reject(msg, ClOrdID);
+                return;
+            }
+            auto &o = ses->orders[OrderID];
+            auto buffer = reserve();
+            sbe::ExecutionReportCancel534 executionReportCancel;
+            auto rep = executionReportCancel.wrapAndApplyHeader(buffer, sockhelp::SOFH_HEADER_SIZE, MAX_MSG_SZ);
+            fill_report(rep, o, OrderID, msg.orderRequestID(), msg.partyDetailsListReqID());
+            fill_terms(rep, o);
+            rep.cumQty(o.cum);
+            commit(buffer, rep.encodedLength());
+            ses->clordid_to_orderid.erase(o.ClOrdID);
+            ses->orders.erase(OrderID);
+        }
+
+        /**
+         * @brief push fills as fast as possible
+         */
+        void flood(uint64_t count)
+        {
+            order_t o;
+            o.ClOrdID = "FLOOD";
+            o.price = 4500250000000LL;
+            o.qty = UINT32_MAX;
+            o.cum = 0;
+            o.securityID = 1;
+            o.side = sbe::SideReq::Buy;
+            o.ord_type = sbe::OrderType::Limit;
+            o.tif = sbe::TimeInForce::Day;
+            auto t0 = now_ns();
+            for (uint64_t i = 0; i < count && running; ++i)
+                send_fill(1, o, 1, 0, 0);
+            flush();
+            auto secs = (now_ns() - t0) / 1e9;
+            std::cerr << "mock: flooded " << count << " fills in " << secs << "s, "
+                      << uint64_t(count / secs) << " msg/s" << std::endl;
+        }
+    };
+
+    /**
+     * @brief accept connections, one thread per connection
+     *
+     */
+    class Gateway
+    {
+    public:
+        explicit Gateway(const config_t &_cfg) : cfg(_cfg) {}
+
+        ~Gateway()
+        {
+            stop();
+        }
+
+        /**
+         * @brief listen on cfg.port (and cfg.backup_port) and serve
+         * connections on background threads
+         */
+        void start()
+        {
+            listen_on(primary, cfg.port, sbe::FTI::Primary);
+            if (cfg.backup_port)
+                listen_on(backup, cfg.backup_port, sbe::FTI::Backup);
+        }
+
+        void stop()
+        {
+            stop_listener(primary);
+            stop_listener(backup);
+        }
+
+    private:
+        struct listener_t
+        {
+            int lsock = -1;
+            std::thread acceptor;
+        };
+
+        void listen_on(listener_t &l, int port, sbe::FTI::Value fti)
+        {
+            l.lsock = socket(PF_INET, SOCK_STREAM, IPPROTO_TCP);
+            if (l.lsock < 0)
+            {
+                perror("socket");
+                abort();
+            }
+            int flag = 1;
+            setsockopt(l.lsock, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof flag);
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof addr);
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(port);
+            if (bind(l.lsock, (struct sockaddr *)&addr, sizeof addr) < 0 || listen(l.lsock, 16) < 0)
+            {
+                perror("mock bind/listen");
+                abort();
+            }
+            l.acceptor = std::thread([this, lsock = l.lsock, fti]
+                                     { accept_loop(lsock, fti); });
+        }
+
+        static void stop_listener(listener_t &l)
+        {
+            if (l.lsock >= 0)
+            {
+                shutdown(l.lsock, SHUT_RDWR);
+                close(l.lsock);
+                l.lsock = -1;
+            }
+            if (l.acceptor.joinable())
+                l.acceptor.join();
+        }
+
+        void accept_loop(int lsock, sbe::FTI::Value fti)
+        {
+            for (;;)
+            {
+                int sock = accept(lsock, nullptr, nullptr);
+                if (sock < 0)
+                    return;
+                int flag = 1;
+                setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof flag);
+                auto conn = std::make_shared<Connection>(sock, cfg, registry, ++conn_id, fti);
+                std::thread([conn]
+                            { conn->run(); })
+                    .detach();
+            }
+        }
+
+        config_t cfg;
+        std::shared_ptr<SessionRegistry> registry = std::make_shared<SessionRegistry>();
+        std::atomic<uint64_t> conn_id{0};
+        listener_t primary;
+        listener_t backup;
+    };
+}
@@ -0,0 +1,408 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ilink_v8/PartyDetailRole.h"
+
+/***************************************************************
+ *
+ * PartyDetailsListReqID registry
+ *
+ * Party details (account, operator, executing firm) registered with
+ * PartyDetailsDefinitionRequest518 stay registered at CME, so there is
+ * no need to define them again on every start. The registry is a memory
+ * mapped file mapping each account/operator/firm combination to the
+ * PartyDetailsListReqID CME acknowledged for it.
+ *
+ *   auto reg = party_registry::Registry::open("/var/lib/ilink/ABC.parties");
+ *
+ *   // startup, per combination traded
+ *   if (auto id = reg->find(account, oper, firm))
+ *       use id (ILinkSndT::set_party_details_list_req_id())
+ *   else
+ *       snd.send_party_details_definition(sock, sbe::ListUpdAct::Add, oper);
+ *
+ *   // only for entries not confirmed recently
+ *   reg->for_each_stale(now - 24h, [&](const party_registry::entry_t &e)
+ *       { snd.send_party_details_list_request(sock, e.PartyDetailsListReqID, firm); });
+ *
+ *   // CBIF
+ *   partyDetailAck:    reg->on_ack(PartyDetailsListReqID, PartyRequestStatus, ids, roles, now)
+ *   partyDetailReport: reg->confirm(PartyDetailsListReqID, now)
+ *   businessReject of a list request: reg->forget(BusinessRejectRefID)
+ *
+ * Entries are found by an FNV-1a hash of the three ids and compared in
+ * full, in an open addressed table sized when the file is created.
+ * Updates are msync'ed, they come with session messages, not orders.
+ * One writing process per file.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::party_registry
+{
+    static constexpr uint64_t MAGIC = 0x31474552594c4932; // "2ILYREG1"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t ID_SIZE = 24; // PartyDetailID is up to 20 chars
+
+    // PartyDetailRequestStatus of an accepted definition
+    static constexpr uint8_t ACCEPTED = 0;
+
+    struct entry_t
+    {
+        uint64_t key;                   // 0 for a free slot
+        uint64_t PartyDetailsListReqID; // 0 once forgotten
+        uint64_t confirmed;             // ns since epoch of the last ack or list report
+        char Account[ID_SIZE];
+        char Operator[ID_SIZE];
+        char ExecutingFirm[ID_SIZE];
+    };
+
+    struct file_header_t
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t entry_size;
+        uint64_t capacity;
+        uint64_t count;
+    };
+
+    static uint64_t key_of(const std::string &account, const std::string &oper, const std::string &firm) noexcept
+    {
+        uint64_t h = 14695981039346656037ULL;
+        auto add = [&h](const std::string &s)
+        {
+            for (unsigned char c : s)
+            {
+                h ^= c;
+                h *= 1099511628211ULL;
+            }
+            h ^= 0xff; // separator
+            h *= 1099511628211ULL;
+        };
+        add(account);
+        add(oper);
+        add(firm);
+        return h ? h : 1;
+    }
+
+    class Registry
+    {
+    public:
+        /**
+         * @brief map the registry file, create it with capacity slots if needed
+         *
+         * @return nullptr on failure
+         */
+        static std::unique_ptr<Registry> open(const std::string &path, size_t capacity = 4096) noexcept
+        {
+            int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd < 0)
+            {
+                perror("party registry open");
+                return nullptr;
+            }
+            struct stat st;
+            if (fstat(fd, &st) < 0)
+            {
+                perror("party registry fstat");
+                close(fd);
+                return nullptr;
+            }
+            bool create = st.st_size == 0;
+            if (create)
+            {
+                size_t n = 16;
+                while (n < capacity)
+                    n <<= 1;
+                capacity = n;
+                if (ftruncate(fd, sizeof(file_header_t) + capacity * sizeof(entry_t)) < 0)
+                {
+                    perror("party registry ftruncate");
+                    close(fd);
+                    return nullptr;
+                }
+            }
+            else
+            {
+                file_header_t h;
+                if (st.st_size < off_t(sizeof h) || pread(fd, &h, sizeof h, 0) != ssize_t(sizeof h) ||
+                    h.magic != MAGIC || h.version != VERSION || h.entry_size != sizeof(entry_t) ||
+                    (h.capacity & (h.capacity - 1)) ||
+                    st.st_size != off_t(sizeof(file_header_t) + h.capacity * sizeof(entry_t)))
+                {
+                    std::cerr << "party registry: " << path << " is not a registry file" << std::endl;
+                    close(fd);
+                    return nullptr;
+                }
+                capacity = h.capacity;
+            }
+            size_t size = sizeof(file_header_t) + capacity * sizeof(entry_t);
+            void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+            {
+                perror("party registry mmap");
+                return nullptr;
+            }
+            auto reg = std::unique_ptr<Registry>(new Registry(p, size));
+            if (create)
+            {
+                reg->header->version = VERSION;
+                reg->header->entry_size = sizeof(entry_t);
+                reg->header->capacity = capacity;
+                reg->header->count = 0;
+                reg->sync();
+                reg->header->magic = MAGIC;
+                reg->sync();
+            }
+            return reg;
+        }
+
+        ~Registry()
+        {
+            munmap(header, size);
+        }
+
+        Registry(const Registry &) = delete;
+        Registry &operator=(const Registry &) = delete;
+
+        /**
+         * @brief acknowledged PartyDetailsListReqID of a combination, 0 if none
+         */
+        uint64_t find(const std::string &account, const std::string &oper, const std::string &firm) const noexcept
+        {
+            auto e = lookup(account, oper, firm);
+            return e ? e->PartyDetailsListReqID : 0;
+        }
+
+        /**
+         * @brief record an acknowledged PartyDetailsListReqID
+         * @return false if the ids are too long or the registry is full
+         */
+        bool put(const std::string &account, const std::string &oper, const std::string &firm,
+                 uint64_t reqid, uint64_t now) noexcept
+        {
+            if (!reqid || account.size() >= ID_SIZE || oper.size() >= ID_SIZE || firm.size() >= ID_SIZE)
+                return false;
+            auto key = key_of(account, oper, firm);
+            auto mask = header->capacity - 1;
+            for (uint64_t i = key & mask;; i = (i + 1) & mask)
+            {
+                auto &e = entries[i];
+                if (e.key == key && same(e, account, oper, firm))
+                {
+                    e.PartyDetailsListReqID = reqid;
+                    e.confirmed = now;
+                    sync();
+                    return true;
+                }
+                if (!e.key)
+                {
+                    if ((header->count + 1) * 4 > header->capacity * 3)
+                    {
+                        std::cerr << "party registry full, " << header->count << " entries" << std::endl;
+                        return false;
+                    }
+                    strncpy(e.Account, account.c_str(), ID_SIZE - 1);
+                    strncpy(e.Operator, oper.c_str(), ID_SIZE - 1);
+                    strncpy(e.ExecutingFirm, firm.c_str(), ID_SIZE - 1);
+                    e.PartyDetailsListReqID = reqid;
+                    e.confirmed = now;
+                    e.key = key;
+                    ++header->count;
+                    sync();
+                    return true;
+                }
+            }
+        }
+
+        /**
+         * @brief record a PartyDetailsDefinitionRequestAck519
+         * @return true if it was accepted and had an account, operator and firm
+         */
+        bool on_ack(uint64_t reqid, uint8_t status,
+                    const std::vector<std::string> &partyDetailID,
+                    const std::vector<sbe::PartyDetailRole::Value> &partyDetailRole,
+                    uint64_t now) noexcept
+        {
+            if (status != ACCEPTED)
+                return false;
+            const std::string *account = nullptr, *oper = nullptr, *firm = nullptr;
+            for (size_t i = 0; i < partyDetailID.size() && i < partyDetailRole.size(); ++i)
+            {
+                switch (partyDetailRole[i])
+                {
+                case sbe::PartyDetailRole::CustomerAccount:
+                    account = &partyDetailID[i];
+                    break;
+                case sbe::PartyDetailRole::Operator:
+                    oper = &partyDetailID[i];
+                    break;
+                case sbe::PartyDetailRole::ExecutingFirm:
+                    firm = &partyDetailID[i];
+                    break;
+                default:
+                    break;
+                }
+            }
+            if (!account || !oper || !firm)
+                return false;
+            return put(*account, *oper, *firm, reqid, now);
+        }
+
+        /**
+         * @brief CME still knows reqid (PartyDetailsListReport538)
+         * @return false if it is not in the registry
+         */
+        bool confirm(uint64_t reqid, uint64_t now) noexcept
+        {
+            auto e = by_reqid(reqid);
+            if (!e)
+                return false;
+            e->confirmed = now;
+            sync();
+            return true;
+        }
+
+        /**
+         * @brief CME does not know reqid any more, define it again
+         * @return false if it is not in the registry
+         */
+        bool forget(uint64_t reqid) noexcept
+        {
+            auto e = by_reqid(reqid);
+            if (!e)
+                return false;
+            // the key stays so probing goes on past the slot, put() reuses it
+            e->PartyDetailsListReqID = 0;
+            sync();
+            return true;
+        }
+
+        /**
+         * @brief call f(const entry_t &) for every entry last confirmed before
+         * not_after (ns since epoch), these are worth a PartyDetailsListRequest537
+         */
+        template <typename F>
+        void for_each_stale(uint64_t not_after, F &&f) const
+        {
+            for (uint64_t i = 0; i < header->capacity; ++i)
+            {
+                auto &e = entries[i];
+                if (e.key && e.PartyDetailsListReqID && e.confirmed < not_after)
+                    f(e);
+            }
+        }
+
+        /**
+         * @brief call f(const entry_t &) for every entry
+         */
+        template <typename F>
+        void for_each(F &&f) const
+        {
+            for (uint64_t i = 0; i < header->capacity; ++i)
+            {
+                auto &e = entries[i];
+                if (e.key && e.PartyDetailsListReqID)
+                    f(e);
+            }
+        }
+
+        size_t capacity() const noexcept { return header->capacity; }
+
+        void sync() noexcept
+        {
+            if (msync(header, size, MS_SYNC) < 0)
+                perror("party registry msync");
+        }
+
+    private:
+        file_header_t *header;
+        entry_t *entries;
+        size_t size;
+
+        Registry(void *p, size_t _size)
+            : header(static_cast<file_header_t *>(p)),
+              entries(reinterpret_cast<entry_t *>(static_cast<char *>(p) + sizeof(file_header_t))),
+              size(_size)
+        {
+        }
+
+        static bool same(const entry_t &e, const std::string &account, const std::string &oper, const std::string &firm) noexcept
+        {
+            return account == e.Account && oper == e.Operator && firm == e.ExecutingFirm;
+        }
+
+        const entry_t *lookup(const std::string &account, const std::string &oper, const std::string &firm) const noexcept
+        {
+            auto key = key_of(account, oper, firm);
+            auto mask = header->capacity - 1;
+            for (uint64_t i = key & mask;; i = (i + 1) & mask)
+            {
+                auto &e = entries[i];
+                if (!e.key)
+                    return nullptr;
+                if (e.key == key && same(e, account, oper, firm))
+                    return e.PartyDetailsListReqID ? &e : nullptr;
+            }
+        }
+
+        entry_t *by_reqid(uint64_t reqid) noexcept
+        {
+            if (!reqid)
+                return nullptr;
+            for (uint64_t i = 0; i < header->capacity; ++i)
+                if (entries[i].key && entries[i].PartyDetailsListReqID == reqid)
+                    return &entries[i];
+            return nullptr;
+        }
+    };
+}
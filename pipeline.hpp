@@ -0,0 +1,492 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ilink_v8/OrderCancelReject535.h"
+#include "ilink_v8/OrderCancelReplaceReject536.h"
+
+#include "sock_help.hpp"
+#include "spsc_ring.hpp"
+#include "exec_report.hpp"
+#include "arena.hpp"
+#include "ILinkCBIF.hpp"
+#include "ILinkRcv.hpp"
+
+/***************************************************************
+ *
+ * Receive pipeline: I/O thread -> strategy threads
+ *
+ * Without it the CBIF runs on the thread calling
+ * process_message_from_msgw(), so a slow handler delays reading the
+ * socket. With it a (pinned) I/O thread only frames and decodes, and
+ * hands fixed size POD events to one or more strategy threads over
+ * SpscRings:
+ *
+ *   ExecutionReport 522 523 524 525 531 532 534  -> exec_report_t (exec_report.hpp)
+ *   OrderCancelReject 535, 536                   -> cancel_reject_t
+ *   anything else                                -> the raw frame, decoded
+ *                                                   with process_message()
+ *                                                   on the strategy thread
+ *
+ * POD events go to EventIF, raw frames to the CBIF as before. No
+ * std::string is built on the I/O thread. A frame larger than
+ * MAX_FRAME_BODY is decoded on the I/O thread into overflow_cbif.
+ *
+ * Events are routed with route(), by default exec reports by
+ * SecurityID % number of strategies and everything else to strategy 0.
+ * Cancel rejects carry no SecurityID, route them by ClOrdID if orders
+ * of one strategy can be rejected on another.
+ *
+ * When a ring is full the I/O thread spins until there is space
+ * (counted in stalls()), so size the rings for the worst burst.
+ *
+ *   pipeline::Pipeline<> p(sock, 2);
+ *   p.start_io(2);                     // I/O thread on cpu 2
+ *   p.start_strategy(0, &ev0, &cb0, 3); // strategy threads on 3 and 4
+ *   p.start_strategy(1, &ev1, &cb1, 4);
+ *   ...
+ *   p.stop();
+ *
+ * or call poll() from your own threads instead of start_strategy().
+ *
+ * *************************************************************/
+
+namespace m2::ilink::pipeline
+{
+    static constexpr size_t EVENT_SIZE = 1024;
+
+    using m2::ilink::exec_report_t;
+
+    /**
+     * @brief cancel reject with no heap fields
+     * @see CBIF::canc_rej_param_t
+     */
+    struct cancel_reject_t
+    {
+        uint16_t templateId;
+        uint32_t SeqNum;
+        uint64_t UUID;
+        char ExecID[40];
+        char ClOrdID[20];
+        uint64_t PartyDetailsListReqID;
+        uint64_t OrderID;
+        uint64_t TransactTime;
+        uint64_t SendingTime;
+        uint64_t OrderRequestID;
+        uint32_t CxlRejReason;
+        sbe::ManualOrdIndReq::Value ManualOrderIndicator;
+        char OrdStatus;
+        bool PossRetransFlag;
+    };
+
+    enum class EventType : uint8_t
+    {
+        ExecutionReport,
+        CancelReject,
+        Frame
+    };
+
+    // type on the first cache line, the POD event from the second, the body after it
+    static constexpr size_t EVENT_HEAD_SIZE =
+        CACHE_LINE_SIZE + (std::max(sizeof(exec_report_t), sizeof(cancel_reject_t)) + CACHE_LINE_SIZE - 1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+    static constexpr size_t MAX_FRAME_BODY = EVENT_SIZE - EVENT_HEAD_SIZE;
+
+    struct alignas(CACHE_LINE_SIZE) event_t
+    {
+        EventType type;
+        // exec_report_t is cache line aligned, exec.hot is one line
+        union
+        {
+            exec_report_t exec;
+            cancel_reject_t reject;
+            struct
+            {
+                sockhelp::cme_msg_header_t header;
+            } frame;
+        };
+        // body of a Frame, starts on its own cache line
+        alignas(CACHE_LINE_SIZE) char body[MAX_FRAME_BODY];
+    };
+    static_assert(sizeof(event_t) == EVENT_SIZE);
+    static_assert(std::is_trivially_copyable_v<event_t>);
+
+    /**
+     * @brief strategy side handler for POD events
+     */
+    struct EventIF
+    {
+        virtual ~EventIF() = default;
+        virtual void executionReport(const exec_report_t &ev) = 0;
+        virtual void cancelReject(const cancel_reject_t &ev) = 0;
+    };
+
+    /**
+     * @brief pin a thread to a cpu, cpu < 0 leaves it alone
+     */
+    static bool set_affinity(pthread_t thread, int cpu) noexcept
+    {
+        if (cpu < 0)
+            return true;
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        auto rc = pthread_setaffinity_np(thread, sizeof set, &set);
+        if (rc != 0)
+        {
+            std::cerr << "pthread_setaffinity_np cpu " << cpu << " failed: " << strerror(rc) << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    //
+    // decode on the I/O thread
+    //
+
+    template <typename M>
+    static void decode_reject(M &msg, cancel_reject_t &ev) noexcept
+    {
+        ev.templateId = M::sbeTemplateId();
+        ev.UUID = msg.uUID();
+        ev.SeqNum = msg.seqNum();
+        memcpy(ev.ExecID, msg.execID(), sizeof ev.ExecID);
+        memcpy(ev.ClOrdID, msg.clOrdID(), sizeof ev.ClOrdID);
+        ev.PartyDetailsListReqID = msg.partyDetailsListReqID();
+        ev.OrderID = msg.orderID();
+        ev.TransactTime = msg.transactTime();
+        ev.SendingTime = msg.sendingTimeEpoch();
+        ev.OrderRequestID = msg.orderRequestID();
+        ev.CxlRejReason = msg.cxlRejReason();
+        ev.ManualOrderIndicator = msg.manualOrderIndicator();
+        ev.PossRetransFlag = msg.possRetransFlag();
+        ev.OrdStatus = msg.ordStatus()[0];
+    }
+
+    /**
+     * @brief decode a message into a POD event
+     *
+     * @return false if the message has no POD form and goes as a Frame
+     */
+    static bool decode(const sockhelp::cme_msg_header_t *header, char *msg_buf, event_t &ev) noexcept
+    {
+        if (decode_exec_report(header, msg_buf, ev.exec))
+        {
+            ev.type = EventType::ExecutionReport;
+            return true;
+        }
+        switch (header->TemplateID)
+        {
+        case sbe::OrderCancelReject535::sbeTemplateId():
+        {
+            sbe::OrderCancelReject535 orderCancelReject;
+            auto msg = orderCancelReject.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            ev.type = EventType::CancelReject;
+            decode_reject(msg, ev.reject);
+            return true;
+        }
+        case sbe::OrderCancelReplaceReject536::sbeTemplateId():
+        {
+            sbe::OrderCancelReplaceReject536 orderCancelReplaceReject;
+            auto msg = orderCancelReplaceReject.wrapForDecode(msg_buf, 0, header->BlockLength, header->Version, header->MsgSize);
+            ev.type = EventType::CancelReject;
+            decode_reject(msg, ev.reject);
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * @brief default route: exec reports by SecurityID, the rest to 0
+     */
+    static size_t route_by_security(const event_t &ev, size_t n) noexcept
+    {
+        if (ev.type == EventType::ExecutionReport)
+            return uint32_t(ev.exec.hot.SecurityID) % n;
+        return 0;
+    }
+
+    /**
+     * @tparam Transport as for process_message_from_msgw
+     * @tparam RING_SIZE events per strategy ring, a power of two
+     */
+    template <typename Transport = sockhelp::SocketTransport, size_t RING_SIZE = 4096>
+    class Pipeline
+    {
+    public:
+        using handle_t = typename Transport::handle_t;
+        using ring_t = SpscRing<event_t, RING_SIZE>;
+        using route_t = std::function<size_t(const event_t &, size_t)>;
+
+        /**
+         * @param _sock connection to read from
+         * @param n_strategies number of strategy rings
+         * @param arena if set the rings and the receive buffer are allocated from it
+         */
+        Pipeline(handle_t _sock, size_t n_strategies = 1, route_t _route = route_by_security, arena::Arena *arena = nullptr)
+            : sock(_sock), route(_route)
+        {
+            for (size_t i = 0; i < n_strategies; ++i)
+            {
+                if (arena)
+                    rings.push_back(arena->make<ring_t>());
+                else
+                    rings.push_back(owned_rings.emplace_back(std::make_unique<ring_t>()).get());
+            }
+            if (arena)
+                msg_buf = arena->buffer(MSG_BUF_SIZE);
+            else
+            {
+                owned_msg_buf.reset(new char[MSG_BUF_SIZE]);
+                msg_buf = owned_msg_buf.get();
+            }
+        }
+
+        ~Pipeline()
+        {
+            stop();
+        }
+
+        /**
+         * @brief decode frames too large for an event on the I/O thread
+         * into this CBIF, they are dropped if it is not set
+         */
+        void set_overflow_cbif(CBIF *_overflow_cbif) noexcept
+        {
+            overflow_cbif = _overflow_cbif;
+        }
+
+        /**
+         * @brief start the I/O thread
+         *
+         * @param cpu cpu to pin it to, -1 for none
+         * @param busy_poll spin on the connection instead of blocking in recv
+         */
+        void start_io(int cpu = -1, bool busy_poll = false)
+        {
+            running = true;
+            io_thread = std::thread([this, busy_poll]
+                                    { io_loop(busy_poll); });
+            set_affinity(io_thread.native_handle(), cpu);
+        }
+
+        /**
+         * @brief start a thread polling strategy ring i
+         *
+         * @param cpu cpu to pin it to, -1 for none
+         */
+        void start_strategy(size_t i, EventIF *ev, CBIF *cbif, int cpu = -1)
+        {
+            strategies_running = true;
+            strategy_threads.emplace_back([this, i, ev, cbif]
+                                          {
+                while (strategies_running.load(std::memory_order_acquire))
+                {
+                    if (!poll(i, ev, cbif))
+                        cpu_relax();
+                }
+                // stop() has joined the I/O thread, deliver the rest of the ring
+                while (poll(i, ev, cbif))
+                    ; });
+            set_affinity(strategy_threads.back().native_handle(), cpu);
+        }
+
+        /**
+         * @brief handle up to max events from strategy ring i on the calling thread
+         *
+         * @return number of events handled
+         */
+        size_t poll(size_t i, EventIF *ev, CBIF *cbif, size_t max = 64) noexcept
+        {
+            auto &ring = *rings[i];
+            size_t n = 0;
+            while (n < max)
+            {
+                auto e = ring.front();
+                if (!e)
+                    break;
+                switch (e->type)
+                {
+                case EventType::ExecutionReport:
+                    ev->executionReport(e->exec);
+                    break;
+                case EventType::CancelReject:
+                    ev->cancelReject(e->reject);
+                    break;
+                case EventType::Frame:
+                    receiver::process_message(&e->frame.header, e->body, cbif);
+                    break;
+                }
+                ring.pop();
+                ++n;
+            }
+            return n;
+        }
+
+        /**
+         * @brief stop the I/O thread and the strategy threads
+         *
+         * A blocking I/O thread returns when the next message arrives
+         * or the connection is closed. The strategy threads are stopped
+         * after it and deliver every event it pushed.
+         */
+        void stop()
+        {
+            running = false;
+            if (io_thread.joinable())
+                io_thread.join();
+            strategies_running = false;
+            for (auto &t : strategy_threads)
+                if (t.joinable())
+                    t.join();
+            strategy_threads.clear();
+        }
+
+        /**
+         * @brief set when the I/O thread has exited, e.g. the connection closed
+         */
+        bool disconnected() const noexcept { return io_done.load(std::memory_order_acquire); }
+
+        /**
+         * @brief times the I/O thread found a strategy ring full
+         */
+        uint64_t stalls() const noexcept { return n_stalls.load(std::memory_order_relaxed); }
+
+        uint64_t dropped() const noexcept { return n_dropped.load(std::memory_order_relaxed); }
+
+        size_t strategies() const noexcept { return rings.size(); }
+
+    private:
+        handle_t sock;
+        route_t route;
+        static constexpr size_t MSG_BUF_SIZE = 64 * 1024;
+
+        std::vector<ring_t *> rings;
+        std::vector<std::unique_ptr<ring_t>> owned_rings;
+        char *msg_buf;
+        std::unique_ptr<char[]> owned_msg_buf;
+        CBIF *overflow_cbif = nullptr;
+        std::atomic<bool> running{false};
+        std::atomic<bool> strategies_running{false};
+        std::atomic<bool> io_done{false};
+        std::atomic<uint64_t> n_stalls{0};
+        std::atomic<uint64_t> n_dropped{0};
+        std::thread io_thread;
+        std::vector<std::thread> strategy_threads;
+
+        event_t *claim(ring_t &ring) noexcept
+        {
+            auto slot = ring.claim();
+            if (slot)
+                return slot;
+            n_stalls.fetch_add(1, std::memory_order_relaxed);
+            while (!(slot = ring.claim()))
+                cpu_relax();
+            return slot;
+        }
+
+        void io_loop(bool busy_poll) noexcept
+        {
+            event_t scratch;
+            while (running.load(std::memory_order_relaxed))
+            {
+                auto header = Transport::recv_message(sock, msg_buf, !busy_poll);
+                if (!header)
+                {
+                    if (busy_poll)
+                        continue;
+                    break;
+                }
+
+                if (decode(&*header, msg_buf, scratch))
+                {
+                    auto &ring = *rings[route(scratch, rings.size())];
+                    auto slot = claim(ring);
+                    slot->type = scratch.type;
+                    if (scratch.type == EventType::ExecutionReport)
+                        slot->exec = scratch.exec;
+                    else
+                        slot->reject = scratch.reject;
+                    ring.publish();
+                    continue;
+                }
+
+                size_t body_sz = header->MsgSize - sockhelp::SOFH_AND_SBE_HEADER_SIZE;
+                if (header->BlockLength > body_sz)
+                    body_sz = header->BlockLength;
+                if (body_sz > MAX_FRAME_BODY)
+                {
+                    if (overflow_cbif)
+                        receiver::process_message(&*header, msg_buf, overflow_cbif);
+                    else
+                    {
+                        n_dropped.fetch_add(1, std::memory_order_relaxed);
+                        std::cerr << "pipeline: dropped template " << header->TemplateID
+                                  << " size " << body_sz << std::endl;
+                    }
+                    continue;
+                }
+                scratch.type = EventType::Frame;
+                scratch.frame.header = *header;
+                auto &ring = *rings[route(scratch, rings.size())];
+                auto slot = claim(ring);
+                slot->type = EventType::Frame;
+                slot->frame.header = *header;
+                memcpy(slot->body, msg_buf, body_sz);
+                ring.publish();
+            }
+            io_done.store(true, std::memory_order_release);
+        }
+    };
+}
@@ -0,0 +1,512 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+
+#include "ilink_v8/ExecutionReportTradeOutright525.h"
+#include "ilink_v8/ExecutionReportTradeSpread526.h"
+#include "ilink_v8/ExecutionReportTradeSpreadLeg527.h"
+#include "ilink_v8/ExecutionReportTradeAddendumOutright548.h"
+#include "ilink_v8/ExecutionReportTradeAddendumSpread549.h"
+
+#include "ILinkCBIF.hpp"
+#include "spsc_ring.hpp"
+
+/***************************************************************
+ *
+ * Per instrument position, VWAP and realised P&L
+ *
+ * Positions is fed from the receive thread with every fill
+ * (525, 526, 527) and trade addendum (548, 549):
+ *
+ *   void executionReport(const exec_report_param_t &param) override
+ *   {
+ *       positions.on_exec(param);
+ *       ...
+ *   }
+ *
+ * and read from any other thread without locks:
+ *
+ *   position::position_t p;
+ *   if (positions.snapshot(securityID, p)) ...
+ *
+ * All values are int64 fixed point. Prices are PRICE9 mantissas,
+ * P&L is PRICE9 mantissa x quantity, multiply by the contract
+ * multiplier and divide by PRICE9_SCALE for currency.
+ * Position cost is carried at average price, quantities that
+ * reduce a position realise P&L against the average open price.
+ *
+ * Instruments live in a flat, open addressed array keyed by
+ * SecurityID. Every fill is kept in a preallocated log indexed by
+ * SideTradeID, so retransmitted fills are counted once and an
+ * addendum can find its original through OrigSideTradeID:
+ *
+ *   ExecType H (trade cancel)     the original fill is busted
+ *   ExecType G (trade correction) the original fill takes the
+ *                                 corrected LastPx and LastQty
+ *
+ * after which the instrument is rebuilt from its remaining fills.
+ * Busts are rare, fills never allocate.
+ *
+ * Each instrument is published under a seqlock: the writer bumps
+ * the sequence to odd, stores the words and bumps it to even,
+ * readers retry while the sequence is odd or has moved. There is
+ * one writer, the thread calling on_exec().
+ *
+ * *************************************************************/
+
+namespace m2::ilink::position
+{
+    static constexpr int64_t PRICE9_SCALE = 1000000000;
+
+    /**
+     * @brief published position of one instrument
+     */
+    struct position_t
+    {
+        int64_t SecurityID;
+        int64_t Position;      // net quantity, long is positive
+        int64_t AvgPx;         // average open price of Position
+        int64_t BuyQty;
+        int64_t SellQty;
+        int64_t BuyVWAP;
+        int64_t SellVWAP;
+        int64_t RealizedPnL;
+        int64_t LastPx;
+        int64_t Fills;
+        int64_t Busts;
+        int64_t Corrections;
+    };
+
+    static_assert(sizeof(position_t) % sizeof(int64_t) == 0, "position_t is published as int64 words");
+
+    /**
+     * @brief P&L of the open position marked at markPx
+     */
+    static inline int64_t unrealized(const position_t &p, int64_t markPx)
+    {
+        return p.Position * (markPx - p.AvgPx);
+    }
+
+    class Positions
+    {
+    public:
+        /**
+         * @param max_instruments instruments tracked
+         * @param max_fills fills kept for busts and corrections
+         */
+        explicit Positions(size_t max_instruments = 1024, size_t max_fills = 1 << 20)
+        {
+            slot_mask = pow2(max_instruments * 2) - 1;
+            shared.reset(new shared_t[slot_mask + 1]);
+            state.reset(new state_t[slot_mask + 1]);
+            for (size_t i = 0; i <= slot_mask; ++i)
+                shared[i].key.store(EMPTY_SECURITY_ID, std::memory_order_relaxed);
+
+            fill_capacity = max_fills;
+            log.reset(new fill_t[fill_capacity]);
+
+            trade_mask = pow2(max_fills * 2) - 1;
+            trade_keys.reset(new uint64_t[trade_mask + 1]());
+            trade_fills.reset(new uint32_t[trade_mask + 1]);
+        }
+
+        /**
+         * @brief apply a fill or trade addendum
+         * @return true if a position changed
+         */
+        bool on_exec(const CBIF::exec_report_param_t &param)
+        {
+            switch (param.templateId)
+            {
+            case sbe::ExecutionReportTradeOutright525::sbeTemplateId():
+            case sbe::ExecutionReportTradeSpread526::sbeTemplateId():
+            case sbe::ExecutionReportTradeSpreadLeg527::sbeTemplateId():
+                return on_fill(param.SecurityID, param.Side, param.LastQty,
+                               (int64_t)param.lastPx_mantissa, param.SideTradeID);
+
+            case sbe::ExecutionReportTradeAddendumOutright548::sbeTemplateId():
+            case sbe::ExecutionReportTradeAddendumSpread549::sbeTemplateId():
+                if (param.ExecType.empty())
+                    return false;
+                if (param.ExecType[0] == 'H')
+                    return on_bust(param.OrigSideTradeID);
+                if (param.ExecType[0] == 'G')
+                    return on_correct(param.OrigSideTradeID, param.SideTradeID,
+                                      param.LastQty, (int64_t)param.lastPx_mantissa);
+                return false;
+
+            default:
+                return false;
+            }
+        }
+
+        /**
+         * @brief apply a fill, a SideTradeID seen before is ignored
+         */
+        bool on_fill(int32_t securityID, sbe::SideReq::Value side, uint32_t lastQty,
+                     int64_t lastPx, uint64_t sideTradeID)
+        {
+            if (!lastQty)
+                return false;
+            if (sideTradeID && find_trade(sideTradeID) != NONE)
+                return false;
+
+            if (fill_count == fill_capacity)
+            {
+                std::cerr << "position: fill log full, " << fill_capacity << " fills" << std::endl;
+                abort();
+            }
+
+            auto s = slot_for(securityID);
+            auto &st = state[s];
+
+            auto f = (uint32_t)fill_count++;
+            log[f].px = lastPx;
+            log[f].qty = side == sbe::SideReq::Sell ? -(int64_t)lastQty : (int64_t)lastQty;
+            log[f].slot = (uint32_t)s;
+            log[f].next = NONE;
+            log[f].busted = false;
+            if (st.last_fill == NONE)
+                st.first_fill = f;
+            else
+                log[st.last_fill].next = f;
+            st.last_fill = f;
+            if (sideTradeID)
+                add_trade(sideTradeID, f);
+
+            apply(st, log[f].qty, lastPx);
+            publish(s);
+            return true;
+        }
+
+        /**
+         * @brief remove the fill origSideTradeID from its position
+         */
+        bool on_bust(uint64_t origSideTradeID)
+        {
+            auto f = find_trade(origSideTradeID);
+            if (f == NONE || log[f].busted)
+                return false;
+
+            log[f].busted = true;
+            auto s = log[f].slot;
+            ++state[s].pub.Busts;
+            rebuild(s);
+            return true;
+        }
+
+        /**
+         * @brief replace quantity and price of the fill origSideTradeID,
+         * sideTradeID then refers to the same fill
+         */
+        bool on_correct(uint64_t origSideTradeID, uint64_t sideTradeID, uint32_t lastQty, int64_t lastPx)
+        {
+            auto f = find_trade(origSideTradeID);
+            if (f == NONE || log[f].busted)
+                return false;
+            if (sideTradeID && find_trade(sideTradeID) != NONE)
+                return false;
+
+            log[f].qty = log[f].qty < 0 ? -(int64_t)lastQty : (int64_t)lastQty;
+            log[f].px = lastPx;
+            if (sideTradeID)
+                add_trade(sideTradeID, f);
+
+            auto s = log[f].slot;
+            ++state[s].pub.Corrections;
+            rebuild(s);
+            return true;
+        }
+
+        /**
+         * @brief consistent copy of one position, callable from any thread
+         * @return false if the instrument has no fills
+         */
+        bool snapshot(int32_t securityID, position_t &out) const
+        {
+            for (auto s = hash(securityID) & slot_mask;; s = (s + 1) & slot_mask)
+            {
+                auto key = shared[s].key.load(std::memory_order_acquire);
+                if (key == securityID)
+                {
+                    read(s, out);
+                    return true;
+                }
+                if (key == EMPTY_SECURITY_ID)
+                    return false;
+            }
+        }
+
+        /**
+         * @brief call f(const position_t&) with a snapshot of every instrument
+         */
+        template <typename F>
+        void for_each(F &&f) const
+        {
+            position_t p;
+            for (size_t s = 0; s <= slot_mask; ++s)
+            {
+                if (shared[s].key.load(std::memory_order_acquire) == EMPTY_SECURITY_ID)
+                    continue;
+                read(s, p);
+                f(p);
+            }
+        }
+
+        size_t instruments() const { return instrument_count; }
+        size_t fills() const { return fill_count; }
+
+    private:
+        static constexpr int32_t EMPTY_SECURITY_ID = INT32_MIN;
+        static constexpr uint32_t NONE = UINT32_MAX;
+        static constexpr size_t WORDS = sizeof(position_t) / sizeof(int64_t);
+
+        // read by other threads
+        struct alignas(CACHE_LINE_SIZE) shared_t
+        {
+            std::atomic<uint64_t> seq{0};
+            std::atomic<int32_t> key;
+            std::atomic<int64_t> words[WORDS];
+        };
+
+        // receive thread only
+        struct alignas(CACHE_LINE_SIZE) state_t
+        {
+            position_t pub{};
+            __int128 open_cost = 0;
+            __int128 buy_notional = 0;
+            __int128 sell_notional = 0;
+            uint32_t first_fill = NONE;
+            uint32_t last_fill = NONE;
+        };
+
+        struct fill_t
+        {
+            int64_t px;
+            int64_t qty;
+            uint32_t slot;
+            uint32_t next;
+            bool busted;
+        };
+
+        static size_t pow2(size_t n)
+        {
+            size_t p = 1;
+            while (p < n)
+                p <<= 1;
+            return p;
+        }
+
+        static size_t hash(uint64_t key)
+        {
+            return (size_t)((key * 0x9E3779B97F4A7C15ull) >> 17);
+        }
+
+        size_t slot_for(int32_t securityID)
+        {
+            for (auto s = hash(securityID) & slot_mask;; s = (s + 1) & slot_mask)
+            {
+                auto key = shared[s].key.load(std::memory_order_relaxed);
+                if (key == securityID)
+                    return s;
+                if (key != EMPTY_SECURITY_ID)
+                    continue;
+
+                if (++instrument_count > (slot_mask + 1) / 2)
+                {
+                    std::cerr << "position: too many instruments, " << instrument_count << std::endl;
+                    abort();
+                }
+                state[s].pub.SecurityID = securityID;
+                for (size_t w = 0; w < WORDS; ++w)
+                    shared[s].words[w].store(0, std::memory_order_relaxed);
+                shared[s].words[0].store(securityID, std::memory_order_relaxed);
+                shared[s].key.store(securityID, std::memory_order_release);
+                return s;
+            }
+        }
+
+        uint32_t find_trade(uint64_t sideTradeID) const
+        {
+            for (auto t = hash(sideTradeID) & trade_mask;; t = (t + 1) & trade_mask)
+            {
+                if (trade_keys[t] == sideTradeID)
+                    return trade_fills[t];
+                if (!trade_keys[t])
+                    return NONE;
+            }
+        }
+
+        void add_trade(uint64_t sideTradeID, uint32_t f)
+        {
+            if (++trade_count > (trade_mask + 1) * 3 / 4)
+            {
+                std::cerr << "position: trade index full, " << trade_count << " trades" << std::endl;
+                abort();
+            }
+            auto t = hash(sideTradeID) & trade_mask;
+            while (trade_keys[t])
+                t = (t + 1) & trade_mask;
+            trade_keys[t] = sideTradeID;
+            trade_fills[t] = f;
+        }
+
+        /**
+         * @brief average cost update for a signed quantity at px
+         */
+        static void apply(state_t &st, int64_t qty, int64_t px)
+        {
+            auto &p = st.pub;
+            auto q = qty < 0 ? -qty : qty;
+            auto notional = (__int128)px * q;
+            if (qty > 0)
+            {
+                p.BuyQty += q;
+                st.buy_notional += notional;
+                p.BuyVWAP = (int64_t)(st.buy_notional / p.BuyQty);
+            }
+            else
+            {
+                p.SellQty += q;
+                st.sell_notional += notional;
+                p.SellVWAP = (int64_t)(st.sell_notional / p.SellQty);
+            }
+
+            if (p.Position && (p.Position > 0) != (qty > 0))
+            {
+                // reduce, realise against the average open price
+                auto sign = p.Position < 0 ? -1 : 1;
+                auto open = sign * p.Position;
+                auto close = q < open ? q : open;
+                auto cost = st.open_cost * close / open;
+                p.RealizedPnL += (int64_t)((__int128)sign * px * close - cost);
+                st.open_cost -= cost;
+                p.Position -= sign * close;
+                qty += sign * close;
+            }
+            st.open_cost += (__int128)px * qty;
+            p.Position += qty;
+            p.AvgPx = p.Position ? (int64_t)(st.open_cost / p.Position) : 0;
+            p.LastPx = px;
+            ++p.Fills;
+        }
+
+        void rebuild(size_t s)
+        {
+            auto &st = state[s];
+            auto &p = st.pub;
+            auto busts = p.Busts;
+            auto corrections = p.Corrections;
+            p = position_t{};
+            p.SecurityID = shared[s].key.load(std::memory_order_relaxed);
+            p.Busts = busts;
+            p.Corrections = corrections;
+            st.open_cost = st.buy_notional = st.sell_notional = 0;
+
+            for (auto f = st.first_fill; f != NONE; f = log[f].next)
+            {
+                if (!log[f].busted)
+                    apply(st, log[f].qty, log[f].px);
+            }
+            publish(s);
+        }
+
+        /**
+         * @brief seqlock write of the receive thread copy
+         */
+        void publish(size_t s)
+        {
+            int64_t w[WORDS];
+            memcpy(w, &state[s].pub, sizeof(w));
+
+            auto &sh = shared[s];
+            auto seq = sh.seq.load(std::memory_order_relaxed);
+            sh.seq.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (size_t i = 0; i < WORDS; ++i)
+                sh.words[i].store(w[i], std::memory_order_relaxed);
+            sh.seq.store(seq + 2, std::memory_order_release);
+        }
+
+        /**
+         * @brief seqlock read, retries while the writer is active
+         */
+        void read(size_t s, position_t &out) const
+        {
+            auto &sh = shared[s];
+            int64_t w[WORDS];
+            for (;;)
+            {
+                auto seq = sh.seq.load(std::memory_order_acquire);
+                if (seq & 1)
+                {
+                    cpu_relax();
+                    continue;
+                }
+                for (size_t i = 0; i < WORDS; ++i)
+                    w[i] = sh.words[i].load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (sh.seq.load(std::memory_order_relaxed) == seq)
+                    break;
+            }
+            memcpy(&out, w, sizeof(out));
+        }
+
+        size_t slot_mask;
+        std::unique_ptr<shared_t[]> shared;
+        std::unique_ptr<state_t[]> state;
+        size_t instrument_count = 0;
+
+        std::unique_ptr<fill_t[]> log;
+        size_t fill_capacity;
+        size_t fill_count = 0;
+
+        size_t trade_mask;
+        std::unique_ptr<uint64_t[]> trade_keys;
+        std::unique_ptr<uint32_t[]> trade_fills;
+        size_t trade_count = 0;
+    };
+}
@@ -0,0 +1,194 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ilink_v8/ExecutionReportStatus532.h"
+
+#include "ILinkCBIF.hpp"
+#include "ilink/ilink_null.hpp"
+
+namespace m2::ilink
+{
+    /**
+     * @brief state of one working order as reported by ExecutionReportStatus532
+     *
+     */
+    struct order_status_t
+    {
+        uint64_t OrderID;
+        uint64_t OrderRequestID;
+        int64_t Price_mantissa;
+        int32_t SecurityID;
+        uint32_t OrderQty;
+        uint32_t CumQty;
+        uint32_t LeavesQty;
+        sbe::SideReq::Value Side;
+        char OrdStatus;
+        char ClOrdID[21];
+    };
+
+    /**
+     * @brief Interface called when all replies to a status request are in
+     *
+     */
+    struct ReconcileIF
+    {
+        /**
+         * @brief one complete reply to send_order_status_request or
+         * send_order_mass_status_request.
+         * Any order the caller believes working and that is not in
+         * orders is no longer working at CME.
+         */
+        virtual void orderStatusBatch(
+            uint64_t StatusReqID,
+            const std::vector<order_status_t> &orders) = 0;
+    };
+
+    /**
+     * @brief Collects ExecutionReportStatus532 replies into one batch per request
+     *
+     * After a reconnect send one OrderMassStatusRequest530, call expect()
+     * with its MassStatusReqID and pass every execution report to
+     * on_execution_report() from CBIF::executionReport(). When the last
+     * report for the request arrives the whole batch is passed to
+     * ReconcileIF::orderStatusBatch() so order state can be updated in one pass.
+     *
+     */
+    class StatusReconciler
+    {
+    public:
+        explicit StatusReconciler(ReconcileIF *_rif) : rif(_rif) {}
+
+        /**
+         * @brief register a request id before sending the request
+         *
+         */
+        void expect(uint64_t StatusReqID, size_t reserve = 1024)
+        {
+            auto &p = pending[StatusReqID];
+            p.orders.clear();
+            p.orders.reserve(reserve);
+            p.total = UINT32_NULL;
+        }
+
+        /**
+         * @brief feed an execution report
+         *
+         * @return true if the report answered a pending status request
+         */
+        bool on_execution_report(const CBIF::exec_report_param_t &param)
+        {
+            if (param.templateId != sbe::ExecutionReportStatus532::sbeTemplateId())
+                return false;
+
+            auto reqid = param.MassStatusReqID != UINT64_NULL ? param.MassStatusReqID : param.OrdStatusReqID;
+            auto it = pending.find(reqid);
+            if (it == pending.end())
+                return false;
+
+            auto &p = it->second;
+            order_status_t os;
+            os.OrderID = param.OrderID;
+            os.OrderRequestID = param.OrderRequestID;
+            os.Price_mantissa = param.Price_mantissa;
+            os.SecurityID = param.SecurityID;
+            os.OrderQty = param.OrderQty;
+            os.CumQty = param.CumQty;
+            os.LeavesQty = param.LeavesQty;
+            os.Side = param.Side;
+            os.OrdStatus = param.OrdStatus.empty() ? 0 : param.OrdStatus[0];
+            memset(os.ClOrdID, 0, sizeof os.ClOrdID);
+            strncpy(os.ClOrdID, param.ClOrdID.c_str(), sizeof os.ClOrdID - 1);
+            p.orders.push_back(os);
+
+            if (param.TotNumReports != UINT32_NULL)
+                p.total = param.TotNumReports;
+
+            //
+            // single order status replies have no report count
+            //
+            bool done = param.LastRptRequested ||
+                        param.MassStatusReqID == UINT64_NULL ||
+                        (p.total != UINT32_NULL && p.orders.size() >= p.total);
+            if (done)
+                complete(it);
+            return true;
+        }
+
+        /**
+         * @brief deliver whatever has been received for a request,
+         * e.g. on timeout when no order is working and no report will come
+         *
+         */
+        void flush(uint64_t StatusReqID)
+        {
+            auto it = pending.find(StatusReqID);
+            if (it != pending.end())
+                complete(it);
+        }
+
+        size_t outstanding() const noexcept { return pending.size(); }
+
+    private:
+        struct pending_t
+        {
+            std::vector<order_status_t> orders;
+            uint32_t total;
+        };
+
+        void complete(std::unordered_map<uint64_t, pending_t>::iterator it)
+        {
+            auto reqid = it->first;
+            auto orders = std::move(it->second.orders);
+            pending.erase(it);
+            rif->orderStatusBatch(reqid, orders);
+        }
+
+        ReconcileIF *rif;
+        std::unordered_map<uint64_t, pending_t> pending;
+    };
+}
@@ -0,0 +1,164 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <sys/socket.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <time.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "ILinkRcv.hpp"
+#include "capture.hpp"
+
+/***************************************************************
+ *
+ * Replay a capture through the receive path
+ *
+ * The messages received from CME in a capture are written into one end
+ * of a unix socketpair by a feeder thread and read back on the calling
+ * thread with receiver::process_message_from_msgw(), so framing, decode
+ * and the CBIF run exactly as they do on a live session.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::replay
+{
+    struct result_t
+    {
+        uint64_t messages;
+        double seconds;
+        double messages_per_sec;
+    };
+
+    /**
+     * @brief replay the FromCME records of a capture into cbif
+     *
+     * @param paced true to keep the recorded spacing between messages,
+     *              false to replay as fast as possible
+     * @param loops number of times the capture is replayed
+     */
+    static result_t run(capture::Reader &reader, CBIF *cbif, bool paced = false, int loops = 1, bool debug = false)
+    {
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+        {
+            perror("socketpair");
+            abort();
+        }
+        int sz = 4 * 1024 * 1024;
+        setsockopt(fds[0], SOL_SOCKET, SO_SNDBUF, &sz, sizeof sz);
+        setsockopt(fds[1], SOL_SOCKET, SO_RCVBUF, &sz, sizeof sz);
+
+        uint64_t expected = 0;
+        capture::record_t rec;
+        reader.rewind();
+        while (reader.next(rec))
+        {
+            if (rec.direction == capture::FromCME)
+                ++expected;
+        }
+        expected *= loops;
+
+        std::thread feeder([&]
+                           {
+            std::vector<char> batch;
+            batch.reserve(256 * 1024);
+            // false once the reader has stopped and shut the socket down
+            auto flush = [&]
+            {
+                size_t off = 0;
+                while (off < batch.size())
+                {
+                    auto n = send(fds[0], batch.data() + off, batch.size() - off, MSG_NOSIGNAL);
+                    if (n <= 0)
+                        return false;
+                    off += n;
+                }
+                batch.clear();
+                return true;
+            };
+            capture::record_t rec;
+            for (int l = 0; l < loops; ++l)
+            {
+                reader.rewind();
+                uint64_t first_ts = 0;
+                auto start = std::chrono::steady_clock::now();
+                while (reader.next(rec))
+                {
+                    if (rec.direction != capture::FromCME)
+                        continue;
+                    if (paced)
+                    {
+                        if (!first_ts)
+                            first_ts = rec.timestamp;
+                        auto due = start + std::chrono::nanoseconds(rec.timestamp - first_ts);
+                        while (std::chrono::steady_clock::now() < due)
+                            ;
+                    }
+                    batch.insert(batch.end(), rec.frame, rec.frame + rec.length);
+                    if ((paced || batch.size() >= 128 * 1024) && !flush())
+                        return;
+                }
+                if (!flush())
+                    return;
+            } });
+
+        auto msg_buf = std::make_unique<char[]>(64 * 1024);
+        auto t0 = std::chrono::steady_clock::now();
+        uint64_t n = 0;
+        while (n < expected && receiver::process_message_from_msgw(fds[1], msg_buf.get(), cbif, true, debug))
+            ++n;
+        auto t1 = std::chrono::steady_clock::now();
+
+        // the reader may stop early (bad frame), fail the feeder's send
+        shutdown(fds[1], SHUT_RDWR);
+        feeder.join();
+        close(fds[0]);
+        close(fds[1]);
+
+        double secs = std::chrono::duration<double>(t1 - t0).count();
+        return {n, secs, secs > 0 ? n / secs : 0};
+    }
+}
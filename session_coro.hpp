@@ -0,0 +1,641 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <coroutine>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ILinkSnd.hpp"
+#include "ILinkRcv.hpp"
+#include "ILinkCBIF.hpp"
+#include "event_loop.hpp"
+
+/***************************************************************
+ *
+ * Coroutine session layer
+ *
+ * Session bring-up and recovery as straight line code instead of a
+ * state machine spread over CBIF callbacks:
+ *
+ *   coro::Task<void> run(coro::EventLoop &loop, coro::Session &s,
+ *                        std::string host, int port)
+ *   {
+ *       for (;;)
+ *       {
+ *           s.sender().reset_uuid();
+ *           if (co_await s.connect(host, port, 2 * coro::SEC) &&
+ *               co_await s.negotiate() &&
+ *               co_await s.establish())
+ *           {
+ *               // trade with s.sender() on s.socket() ...
+ *               co_await s.closed();
+ *           }
+ *           s.close();
+ *           co_await loop.sleep(coro::SEC);
+ *       }
+ *   }
+ *
+ *   loop.spawn(run(loop, session, host, port));  // one per session
+ *   loop.run();
+ *
+ * To continue the previous UUID after a restart, attach a session
+ * state file (ILinkSndT::set_session_state()) and skip reset_uuid()
+ * and negotiate() while it resumes, see session_state.hpp. establish()
+ * then continues from the SeqNum from CME the file last recorded.
+ * failover.hpp keeps a standby connection for a Session and
+ * re-establishes on it when the active one is lost.
+ *
+ * Session sends with sockhelp::SocketTransport, which aborts when a
+ * send fails. A session that must survive its connection uses
+ * SessionT<sockhelp::DisconnectingSocketTransport> and
+ * ILinkSndT<sockhelp::DisconnectingSocketTransport>: a failed send
+ * shuts the socket down and the session reports Disconnected.
+ *
+ * Every awaitable returns a session_result_t that converts to true
+ * on success, and fails with Timeout after timeout_ns (0 for none),
+ * Disconnected when the socket closes, Terminated on a Terminate507
+ * and Rejected on a reject from CME. One operation per session can be
+ * outstanding at a time.
+ *
+ * Session is the CBIF of its socket. Every message is also passed on
+ * to the application CBIF, so the usual handlers keep working.
+ * retransmit() completes once the retransmitted application messages
+ * announced by Retransmission509 have been passed on.
+ *
+ * All sessions of a loop run on its thread. A frame whose header has
+ * arrived is read to the end with a blocking recv.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::coro
+{
+    static constexpr uint64_t MS = 1000000;
+    static constexpr uint64_t SEC = 1000 * MS;
+
+    enum class Status
+    {
+        Ok,
+        Rejected,
+        Timeout,
+        Disconnected,
+        Terminated
+    };
+
+    static const char *status_name(Status s) noexcept
+    {
+        static const char *names[] = {"ok", "rejected", "timeout", "disconnected", "terminated"};
+        return names[int(s)];
+    }
+
+    struct session_result_t
+    {
+        Status status = Status::Ok;
+        uint16_t ErrorCodes = 0;
+        std::string Reason;
+        // negotiate and establish
+        uint32_t PreviousSeqNo = 0;
+        uint64_t PreviousUUID = 0;
+        sbe::FTI::Value FTI = sbe::FTI::Primary;
+        // establish
+        uint32_t NextSeqNo = 0;
+        uint16_t KeepAliveInterval = 0;
+        // retransmit
+        uint32_t MsgCount = 0;
+
+        explicit operator bool() const noexcept { return status == Status::Ok; }
+    };
+
+    /**
+     * @brief session of a loop, Transport is the socket transport of its
+     * ILinkSndT and of the receive side
+     */
+    template <typename Transport = sockhelp::SocketTransport>
+    class SessionT : public CBIF, IOHandler, TimerHandler
+    {
+    public:
+        using sender_t = ILinkSndT<Transport>;
+
+        static constexpr size_t MSG_BUF_SIZE = 64 * 1024;
+
+        /**
+         * @param _snd encoder of this session
+         * @param _app gets every message received, may be nullptr
+         */
+        SessionT(EventLoop &_loop, sender_t &_snd, CBIF *_app = nullptr)
+            : loop(_loop), snd(_snd), app(_app ? _app : &null_cbif), msg_buf(new char[MSG_BUF_SIZE])
+        {
+        }
+
+        ~SessionT()
+        {
+            if (timer_set)
+                loop.cancel_timer(timer);
+            close_socket();
+        }
+
+        SessionT(const SessionT &) = delete;
+        SessionT &operator=(const SessionT &) = delete;
+
+        int socket() const noexcept { return sock; }
+        sender_t &sender() noexcept { return snd; }
+
+        /**
+         * @brief SeqNum expected in the next application message from CME,
+         * 1 after negotiate(), compared with NextSeqNo of EstablishmentAck504
+         * to find what was missed while disconnected
+         */
+        uint32_t next_expected_seq_no() const noexcept { return next_expected; }
+
+        /**
+         * @brief e.g. restored after a restart, before establish(),
+         * done by establish() when the sender has a session state file
+         */
+        void set_next_expected_seq_no(uint32_t seq_no) noexcept
+        {
+            next_expected = seq_no;
+            save_next_expected();
+        }
+
+        /**
+         * @brief use a socket connected elsewhere, the session closes it
+         */
+        void attach(int _sock) noexcept
+        {
+            close_socket();
+            sock = _sock;
+            loop.add(sock, EPOLLIN | EPOLLRDHUP, this);
+        }
+
+        /**
+         * @brief close the socket, an outstanding operation fails with Disconnected
+         */
+        void close() noexcept
+        {
+            close_socket();
+            finish(Status::Disconnected);
+            resume_ready();
+        }
+
+        /**
+         * @brief connect without blocking the loop
+         */
+        Task<session_result_t> connect(std::string host, int port, uint64_t timeout_ns = 5 * SEC)
+        {
+            close_socket();
+            int s = ::socket(PF_INET, SOCK_STREAM | SOCK_NONBLOCK, IPPROTO_TCP);
+            if (s < 0)
+            {
+                perror("socket");
+                co_return disconnected();
+            }
+            int flag = 1;
+            setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof flag);
+            struct sockaddr_in addr;
+            memset(&addr, 0, sizeof addr);
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = inet_addr(host.c_str());
+            addr.sin_port = htons(port);
+            if (::connect(s, (struct sockaddr *)&addr, sizeof addr) < 0 && errno != EINPROGRESS)
+            {
+                ::close(s);
+                co_return disconnected();
+            }
+            sock = s;
+            loop.add(sock, EPOLLOUT, this);
+            auto r = co_await wait(Op::Connect, timeout_ns);
+            if (!r)
+                close_socket();
+            co_return r;
+        }
+
+        /**
+         * @brief send Negotiate500, wait for NegotiationResponse501 or Reject
+         */
+        Task<session_result_t> negotiate(uint64_t timeout_ns = 5 * SEC)
+        {
+            if (sock < 0)
+                co_return disconnected();
+            snd.send_nogotiate_message(sock);
+            co_return co_await wait(Op::Negotiate, timeout_ns);
+        }
+
+        /**
+         * @brief send Establish503, wait for EstablishmentAck504 or Reject
+         */
+        Task<session_result_t> establish(uint64_t timeout_ns = 5 * SEC)
+        {
+            if (sock < 0)
+                co_return disconnected();
+            // continue where the state file left off after a restart
+            if (auto state = snd.get_session_state())
+                next_expected = std::max(next_expected, state->NextExpectedSeqNo.load(std::memory_order_relaxed));
+            snd.send_establish_message(sock);
+            co_return co_await wait(Op::Establish, timeout_ns);
+        }
+
+        /**
+         * @brief send RetransmitRequest508, wait for Retransmission509 and
+         * the messages it announces, or RetransmitReject510
+         */
+        Task<session_result_t> retransmit(uint32_t from_seq_no, uint16_t msg_count, uint64_t timeout_ns = 5 * SEC)
+        {
+            if (sock < 0)
+                co_return disconnected();
+            snd.send_retransmission_request(sock, from_seq_no, msg_count);
+            co_return co_await wait(Op::Retransmit, timeout_ns);
+        }
+
+        /**
+         * @brief wait until the socket closes or CME terminates the session
+         */
+        Task<session_result_t> closed()
+        {
+            if (sock < 0)
+                co_return disconnected();
+            co_return co_await wait(Op::Closed, 0);
+        }
+
+        //
+        // session layer
+        //
+
+        void sequence(uint32_t NextSeqNo, sbe::FTI::Value FaultToleranceIndicator, sbe::KeepAliveLapsed::Value KeepAliveLapsed) override
+        {
+            // CME tells which connection is primary, e.g. after a failover on its side
+            snd.set_fault_tolerance_indicator(FaultToleranceIndicator);
+            app->sequence(NextSeqNo, FaultToleranceIndicator, KeepAliveLapsed);
+        }
+
+        void negotiationResponse(uint64_t RequestTimeStamp, uint64_t UUID, sbe::FTI::Value FTI, uint32_t PreviousSeqNo, uint64_t PreviousUUID) override
+        {
+            if (pending == Op::Negotiate)
+            {
+                result.PreviousSeqNo = PreviousSeqNo;
+                result.PreviousUUID = PreviousUUID;
+                result.FTI = FTI;
+                next_expected = 1;
+                save_next_expected();
+                finish(Status::Ok);
+            }
+            app->negotiationResponse(RequestTimeStamp, UUID, FTI, PreviousSeqNo, PreviousUUID);
+        }
+
+        void negotiationReject(uint64_t RequestTimeStamp, uint64_t UUID, sbe::FTI::Value FTI, uint16_t errorCodes, const std::string &Reason) override
+        {
+            if (pending == Op::Negotiate)
+            {
+                result.FTI = FTI;
+                result.ErrorCodes = errorCodes;
+                result.Reason = Reason;
+                finish(Status::Rejected);
+            }
+            app->negotiationReject(RequestTimeStamp, UUID, FTI, errorCodes, Reason);
+        }
+
+        void establishementAck(uint64_t RequestTimeStamp, uint64_t UUID, sbe::FTI::Value FTI, uint32_t PreviousSeqNo, uint64_t PreviousUUID, uint32_t NextSeqNo, uint16_t KeepAliveInterval) override
+        {
+            if (pending == Op::Establish)
+            {
+                result.PreviousSeqNo = PreviousSeqNo;
+                result.PreviousUUID = PreviousUUID;
+                result.NextSeqNo = NextSeqNo;
+                result.KeepAliveInterval = KeepAliveInterval;
+                result.FTI = FTI;
+                snd.set_fault_tolerance_indicator(FTI);
+                finish(Status::Ok);
+            }
+            app->establishementAck(RequestTimeStamp, UUID, FTI, PreviousSeqNo, PreviousUUID, NextSeqNo, KeepAliveInterval);
+        }
+
+        void establishmentReject(uint64_t RequestTimeStamp, uint64_t UUID, sbe::FTI::Value FTI, uint32_t NextSeqNo, uint16_t errorCodes, const std::string &Reason) override
+        {
+            if (pending == Op::Establish)
+            {
+                result.NextSeqNo = NextSeqNo;
+                result.FTI = FTI;
+                result.ErrorCodes = errorCodes;
+                result.Reason = Reason;
+                finish(Status::Rejected);
+            }
+            app->establishmentReject(RequestTimeStamp, UUID, FTI, NextSeqNo, errorCodes, Reason);
+        }
+
+        void notApplied(uint64_t UUID, uint32_t FromSeqNo, uint32_t MsgCount) override
+        {
+            app->notApplied(UUID, FromSeqNo, MsgCount);
+        }
+
+        void retransmission(uint64_t UUID, uint64_t RequestTimestamp, uint64_t LastUUID, uint32_t FromSeqNo, uint32_t MsgCount) override
+        {
+            if (pending == Op::Retransmit)
+            {
+                result.MsgCount = MsgCount;
+                retransmit_remaining = MsgCount;
+                if (!MsgCount)
+                    finish(Status::Ok);
+            }
+            app->retransmission(UUID, RequestTimestamp, LastUUID, FromSeqNo, MsgCount);
+        }
+
+        void retransmitReject(uint64_t UUID, uint64_t LastUUID, uint64_t RequestTimestamp, uint16_t ErrorCodes, const std::string &Reason) override
+        {
+            if (pending == Op::Retransmit)
+            {
+                result.ErrorCodes = ErrorCodes;
+                result.Reason = Reason;
+                finish(Status::Rejected);
+            }
+            app->retransmitReject(UUID, LastUUID, RequestTimestamp, ErrorCodes, Reason);
+        }
+
+        void terminate(uint64_t UUID, uint16_t ErrorCodes, const std::string &Reason) override
+        {
+            if (pending != Op::None)
+            {
+                result.ErrorCodes = ErrorCodes;
+                result.Reason = Reason;
+                finish(Status::Terminated);
+            }
+            app->terminate(UUID, ErrorCodes, Reason);
+        }
+
+        //
+        // application layer, counted for retransmit()
+        //
+
+        void businessReject(uint64_t UUID, uint32_t SeqNum, const std::string &Text, uint64_t SendingTime, uint64_t BusinessRejectRefID,
+                            uint32_t RefSeqNum, uint16_t TagId, uint16_t BusinessRejectReason, const std::string &RefMsgType, bool PossRetransFlag) override
+        {
+            app->businessReject(UUID, SeqNum, Text, SendingTime, BusinessRejectRefID, RefSeqNum, TagId, BusinessRejectReason, RefMsgType, PossRetransFlag);
+            application_message(SeqNum);
+        }
+
+        void executionReport(const exec_report_param_t &param) override
+        {
+            app->executionReport(param);
+            application_message(param.SeqNum);
+        }
+
+        void cancelReject(const canc_rej_param_t &param) override
+        {
+            app->cancelReject(param);
+            application_message(param.SeqNum);
+        }
+
+        void orderMassActionReport(const mass_action_report_param_t &param) override
+        {
+            app->orderMassActionReport(param);
+            application_message(param.SeqNum);
+        }
+
+        void massActionAffectedOrder(uint64_t MassActionReportID, const std::string &OrigClOrdID, uint64_t AffectedOrderID, uint32_t CxlQuantity) override
+        {
+            app->massActionAffectedOrder(MassActionReportID, OrigClOrdID, AffectedOrderID, CxlQuantity);
+        }
+
+        void massQuoteAck(const mass_quote_ack_param_t &param) override
+        {
+            app->massQuoteAck(param);
+            application_message(param.SeqNum);
+        }
+
+        void massQuoteAckEntry(uint32_t QuoteID, uint32_t QuoteEntryID, int32_t SecurityID, uint16_t QuoteSetID, uint8_t QuoteEntryRejectReason) override
+        {
+            app->massQuoteAckEntry(QuoteID, QuoteEntryID, SecurityID, QuoteSetID, QuoteEntryRejectReason);
+        }
+
+        void quoteCancelAck(const quote_cancel_ack_param_t &param) override
+        {
+            app->quoteCancelAck(param);
+            application_message(param.SeqNum);
+        }
+
+        void quoteCancelAckEntry(uint32_t QuoteID, int32_t SecurityID) override
+        {
+            app->quoteCancelAckEntry(QuoteID, SecurityID);
+        }
+
+        void quoteCancelAckSet(uint32_t QuoteID, uint16_t QuoteSetID) override
+        {
+            app->quoteCancelAckSet(QuoteID, QuoteSetID);
+        }
+
+        void partyDetailAck(uint64_t UUID, uint32_t SeqNum, uint64_t PartyDetailsListReqID, uint64_t SendingTime, uint8_t PartyRequestStatus, bool PossRetransFlag,
+                            const std::vector<std::string> &partyDetailID,
+                            const std::vector<std::string> &partyDetailSource,
+                            const std::vector<sbe::PartyDetailRole::Value> &partyDetailRole) override
+        {
+            app->partyDetailAck(UUID, SeqNum, PartyDetailsListReqID, SendingTime, PartyRequestStatus, PossRetransFlag,
+                                partyDetailID, partyDetailSource, partyDetailRole);
+            application_message(SeqNum);
+        }
+
+        void partyDetailReport(uint64_t UUID, uint32_t SeqNum, uint64_t PartyDetailsListReqID, uint64_t SendingTime,
+                               const std::vector<std::string> &partyDetailID,
+                               const std::vector<std::string> &partyDetailSource) override
+        {
+            app->partyDetailReport(UUID, SeqNum, PartyDetailsListReqID, SendingTime, partyDetailID, partyDetailSource);
+            application_message(SeqNum);
+        }
+
+    private:
+        enum class Op
+        {
+            None,
+            Connect,
+            Negotiate,
+            Establish,
+            Retransmit,
+            Closed
+        };
+
+        struct awaiter_t
+        {
+            SessionT &s;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) noexcept { s.waiting = h; }
+            session_result_t await_resume() noexcept { return std::move(s.result); }
+        };
+
+        awaiter_t wait(Op op, uint64_t timeout_ns) noexcept
+        {
+            pending = op;
+            result = session_result_t();
+            retransmit_remaining = 0;
+            if (timeout_ns)
+            {
+                timer = loop.add_timer(now_ns() + timeout_ns, this);
+                timer_set = true;
+            }
+            return awaiter_t{*this};
+        }
+
+        static session_result_t disconnected()
+        {
+            session_result_t r;
+            r.status = Status::Disconnected;
+            return r;
+        }
+
+        // completes the outstanding operation, it resumes in resume_ready()
+        void finish(Status status) noexcept
+        {
+            if (pending == Op::None)
+                return;
+            if (timer_set)
+            {
+                loop.cancel_timer(timer);
+                timer_set = false;
+            }
+            pending = Op::None;
+            result.status = status;
+            ready = std::exchange(waiting, {});
+        }
+
+        // outside of message processing, the coroutine may close or reuse the session
+        void resume_ready() noexcept
+        {
+            if (auto h = std::exchange(ready, {}))
+                h.resume();
+        }
+
+        void application_message(uint32_t SeqNum) noexcept
+        {
+            if (SeqNum >= next_expected)
+            {
+                next_expected = SeqNum + 1;
+                save_next_expected();
+            }
+            if (pending == Op::Retransmit && retransmit_remaining && --retransmit_remaining == 0)
+                finish(Status::Ok);
+        }
+
+        void save_next_expected() noexcept
+        {
+            if (auto state = snd.get_session_state())
+                state->NextExpectedSeqNo.store(next_expected, std::memory_order_relaxed);
+        }
+
+        void close_socket() noexcept
+        {
+            if (sock < 0)
+                return;
+            loop.remove(sock);
+            ::close(sock);
+            sock = -1;
+        }
+
+        void on_timer() noexcept override
+        {
+            timer_set = false;
+            finish(Status::Timeout);
+            resume_ready();
+        }
+
+        void on_io(uint32_t events) noexcept override
+        {
+            if (pending == Op::Connect)
+            {
+                int err = 0;
+                socklen_t len = sizeof err;
+                getsockopt(sock, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err || (events & (EPOLLERR | EPOLLHUP)))
+                {
+                    finish(Status::Disconnected);
+                }
+                else
+                {
+                    // blocking sends, reads only when epoll says so
+                    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) & ~O_NONBLOCK);
+                    loop.modify(sock, EPOLLIN | EPOLLRDHUP, this);
+                    finish(Status::Ok);
+                }
+                resume_ready();
+                return;
+            }
+
+            while (sock >= 0 && process_message_from_msgw<Transport>(sock, msg_buf.get(), this, false))
+                resume_ready();
+
+            if (sock >= 0)
+            {
+                char c;
+                auto n = recv(sock, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+                {
+                    close_socket();
+                    finish(Status::Disconnected);
+                }
+            }
+            resume_ready();
+        }
+
+        EventLoop &loop;
+        sender_t &snd;
+        CBIF *app;
+        NullCBIF null_cbif;
+        std::unique_ptr<char[]> msg_buf;
+        int sock = -1;
+
+        Op pending = Op::None;
+        session_result_t result;
+        uint32_t retransmit_remaining = 0;
+        uint32_t next_expected = 1;
+        std::coroutine_handle<> waiting;
+        std::coroutine_handle<> ready;
+        EventLoop::timer_id_t timer;
+        bool timer_set = false;
+    };
+
+    using Session = SessionT<>;
+}
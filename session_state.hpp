@@ -0,0 +1,231 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <atomic>
+#include <string>
+
+/***************************************************************
+ *
+ * Persisted session state
+ *
+ * UUID, NextSeqNo and OrderRequestID of a session live in a small
+ * memory mapped file, with the SeqNum expected in the next message
+ * from CME. ILinkSndT writes them there on every send, coro::SessionT
+ * on every application message received, with plain relaxed stores,
+ * no msync or fsync on the hot path: the page cache keeps the file up
+ * to date across a crash of the process (not of the machine). sync()
+ * flushes it, e.g. on a clean shutdown.
+ *
+ * After a restart the session continues with its previous UUID:
+ * Establish503 with the persisted NextSeqNo, no Negotiate500. A
+ * coro::SessionT continues from the persisted NextExpectedSeqNo, so
+ * only what CME sent after it is retransmitted.
+ *
+ *   auto state = session_state::State::open("/var/lib/ilink/ABC.state", "ABC", "001");
+ *   bool resume = snd.set_session_state(state);
+ *   connect ...
+ *   if (!resume)
+ *       negotiate ...
+ *   establish ...
+ *   if rejected: snd.reset_uuid(), negotiate and establish again
+ *
+ * Numbers are taken before the message is sent, so a crash between
+ * the two leaves a gap, never a reused SeqNum. CME reports the gap
+ * with NotApplied513, answer it with send_sequence().
+ *
+ * One process per file. Open it with State::open() before trading;
+ * State::read() opens it read only, e.g. for monitoring.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::session_state
+{
+    static constexpr uint64_t MAGIC = 0x3154535353494c32; // "2ILSSST1"
+    static constexpr uint32_t VERSION = 2;
+
+    /**
+     * @brief the file, mapped
+     */
+    struct State
+    {
+        uint64_t magic;
+        uint32_t version;
+        uint32_t size;
+        char SessionID[8];
+        char FirmID[8];
+
+        // written by the session's send thread
+        alignas(64) std::atomic<uint64_t> UUID;
+        std::atomic<uint64_t> OrderRequestID;
+        std::atomic<uint32_t> NextSeqNo;
+        // written by the session's receive thread
+        std::atomic<uint32_t> NextExpectedSeqNo;
+
+        static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+        /**
+         * @brief true if this holds a session that can be resumed
+         */
+        bool resumable() const noexcept
+        {
+            return UUID.load(std::memory_order_relaxed) != 0;
+        }
+
+        /**
+         * @brief a new UUID starts CME's sequence numbers from 1 as well
+         */
+        void save(uint64_t uuid, uint32_t next_seq_no, uint64_t order_request_id) noexcept
+        {
+            if (UUID.load(std::memory_order_relaxed) != uuid)
+                NextExpectedSeqNo.store(1, std::memory_order_relaxed);
+            UUID.store(uuid, std::memory_order_relaxed);
+            NextSeqNo.store(next_seq_no, std::memory_order_relaxed);
+            OrderRequestID.store(order_request_id, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief write the file to disk, not on the hot path
+         */
+        void sync() noexcept
+        {
+            if (msync(this, sizeof(State), MS_SYNC) < 0)
+                perror("session state msync");
+        }
+
+        /**
+         * @brief map the state file of session/firm, create it if needed
+         *
+         * A file of another session, or of another layout, is reset with
+         * a warning so nothing is resumed.
+         *
+         * @return State* or nullptr on failure
+         */
+        static State *open(const std::string &path, const std::string &session, const std::string &firm) noexcept
+        {
+            int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+            if (fd < 0)
+            {
+                perror("session state open");
+                return nullptr;
+            }
+            struct stat st;
+            if (fstat(fd, &st) < 0 || (st.st_size != sizeof(State) && ftruncate(fd, sizeof(State)) < 0))
+            {
+                perror("session state ftruncate");
+                close(fd);
+                return nullptr;
+            }
+            void *p = mmap(nullptr, sizeof(State), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+            {
+                perror("session state mmap");
+                return nullptr;
+            }
+            auto state = static_cast<State *>(p);
+            if (!state->matches(session, firm))
+            {
+                if (state->magic == MAGIC)
+                    fprintf(stderr, "session state: %s is of another session or version, starting a new one\n", path.c_str());
+                memset(p, 0, sizeof(State));
+                state->version = VERSION;
+                state->size = sizeof(State);
+                strncpy(state->SessionID, session.c_str(), sizeof state->SessionID - 1);
+                strncpy(state->FirmID, firm.c_str(), sizeof state->FirmID - 1);
+                state->sync();
+                state->magic = MAGIC;
+                state->sync();
+            }
+            return state;
+        }
+
+        /**
+         * @brief map a state file read only
+         *
+         * @return const State* or nullptr if missing or not a state file
+         */
+        static const State *read(const std::string &path) noexcept
+        {
+            int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                return nullptr;
+            struct stat st;
+            if (fstat(fd, &st) < 0 || st.st_size != sizeof(State))
+            {
+                close(fd);
+                return nullptr;
+            }
+            void *p = mmap(nullptr, sizeof(State), PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+                return nullptr;
+            auto state = static_cast<const State *>(p);
+            if (state->magic != MAGIC || state->version != VERSION || state->size != sizeof(State))
+            {
+                munmap(p, sizeof(State));
+                return nullptr;
+            }
+            return state;
+        }
+
+        static void close_state(const State *state) noexcept
+        {
+            if (state)
+                munmap(const_cast<State *>(state), sizeof(State));
+        }
+
+        /**
+         * @brief the file is of this layout and of session/firm
+         */
+        bool matches(const std::string &session, const std::string &firm) const noexcept
+        {
+            return magic == MAGIC && version == VERSION && size == sizeof(State) &&
+                   strncmp(SessionID, session.c_str(), sizeof SessionID) == 0 &&
+                   strncmp(FirmID, firm.c_str(), sizeof FirmID) == 0;
+        }
+    };
+}
@@ -0,0 +1,602 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+
+#include "sock_help.hpp"
+#include "spsc_ring.hpp"
+#include "ILinkSnd.hpp"
+#include "ILinkRcv.hpp"
+#include "pipeline.hpp"
+#include "submit.hpp"
+
+/***************************************************************
+ *
+ * Shared memory order gateway
+ *
+ * One process owns the CME session (ILinkSnd and the socket), strategy
+ * processes submit orders to it through shared memory:
+ *
+ *   strategy process                        session process
+ *   shmgw::Client  -- request ring  -->     shmgw::Gateway -> ILinkSnd -> CME
+ *                  <-- response ring --             <- receiver <-
+ *
+ * Each client has its own SPSC request ring (submit::order_request_t)
+ * and SPSC response ring (POD execution reports and cancel rejects, see
+ * pipeline.hpp), so no two processes write the same cache line.
+ *
+ * A client registers a ClOrdID prefix, every ClOrdID it sends must
+ * start with it. Prefixes of connected clients may not overlap, of two
+ * clients registering overlapping prefixes at once both may be refused. Execution reports and cancel rejects are delivered to
+ * the client whose prefix their ClOrdID starts with, others go to the
+ * gateway's own EventIF. Session messages go to the gateway's CBIF.
+ *
+ * The gateway never blocks on a client: if a response ring is full the
+ * report is dropped and counted in the client's slot, the client can
+ * recover with an order status request. Size the rings accordingly.
+ *
+ * The slot of a client process that died without closing is freed by
+ * the gateway, see Gateway::reap_clients(). A segment left behind by a
+ * gateway that died is replaced by the next create(), one of a running
+ * gateway or of another program is refused.
+ *
+ * session process:
+ *   auto gw = shmgw::Gateway<>::create("/ilink_gw_ABC", snd, sock, &unrouted);
+ *   for (;;) { gw->run_once(msg_buf, &cbif); ... heartbeats ... }
+ *
+ * strategy process:
+ *   auto cl = shmgw::Client::connect("/ilink_gw_ABC", "S1");
+ *   cl->new_order_single(...);
+ *   cl->poll(&events);
+ *
+ * *************************************************************/
+
+namespace m2::ilink::shmgw
+{
+    static constexpr size_t MAX_CLIENTS = 16;
+    static constexpr size_t REQUEST_RING_SIZE = 1024;
+    static constexpr size_t RESPONSE_RING_SIZE = 4096;
+    static constexpr size_t MAX_PREFIX = 8;
+    static constexpr uint64_t MAGIC = 0x494c494e4b475731ULL; // ILINKGW1
+
+    enum ClientState : uint32_t
+    {
+        Free,
+        Claimed, // client is setting up the slot
+        Active,
+        Closing,    // client left, gateway drains and frees the slot
+        Registering // prefix set, client checks it against the others
+    };
+
+    struct response_t
+    {
+        pipeline::EventType type;
+        union
+        {
+            pipeline::exec_report_t exec;
+            pipeline::cancel_reject_t reject;
+        };
+    };
+
+    struct client_slot_t
+    {
+        alignas(CACHE_LINE_SIZE) std::atomic<uint32_t> state{Free};
+        uint32_t pid = 0;
+        uint32_t prefix_len = 0;
+        char prefix[MAX_PREFIX + 1] = {};
+        std::atomic<uint64_t> dropped{0};     // responses lost to a full ring
+        std::atomic<uint64_t> bad_prefix{0};  // requests refused
+        SpscRing<submit::order_request_t, REQUEST_RING_SIZE> requests;
+        SpscRing<response_t, RESPONSE_RING_SIZE> responses;
+    };
+
+    struct shm_layout_t
+    {
+        uint64_t magic = 0;
+        uint32_t gateway_pid = 0;
+        client_slot_t clients[MAX_CLIENTS];
+    };
+
+    static bool has_prefix(const char *ClOrdID, const client_slot_t &c) noexcept
+    {
+        return memcmp(ClOrdID, c.prefix, c.prefix_len) == 0;
+    }
+
+    /**
+     * @brief the session side, single threaded
+     */
+    template <typename Transport = sockhelp::SocketTransport>
+    class Gateway : public pipeline::EventIF
+    {
+    public:
+        using handle_t = typename Transport::handle_t;
+
+        /**
+         * @param unrouted receives reports that match no client, may be nullptr
+         * @return nullptr on failure, or if name is in use by a running
+         * gateway or by something else than a gateway
+         */
+        static std::unique_ptr<Gateway> create(const std::string &name, ILinkSndT<Transport> &snd, handle_t sock,
+                                               pipeline::EventIF *unrouted = nullptr)
+        {
+            int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            if (fd < 0 && errno == EEXIST && left_by_dead_gateway(name))
+            {
+                // its clients keep their mapping of the old segment
+                shm_unlink(name.c_str());
+                fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+            }
+            if (fd < 0)
+            {
+                perror("shm_open");
+                return nullptr;
+            }
+            if (ftruncate(fd, sizeof(shm_layout_t)) < 0)
+            {
+                perror("ftruncate");
+                close(fd);
+                return nullptr;
+            }
+            void *p = mmap(nullptr, sizeof(shm_layout_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+            {
+                perror("mmap");
+                return nullptr;
+            }
+            auto shm = new (p) shm_layout_t;
+            shm->gateway_pid = getpid();
+            std::atomic_thread_fence(std::memory_order_release);
+            shm->magic = MAGIC;
+            return std::unique_ptr<Gateway>(new Gateway(name, shm, snd, sock, unrouted));
+        }
+
+        ~Gateway()
+        {
+            shm->magic = 0;
+            munmap(shm, sizeof(shm_layout_t));
+            shm_unlink(name.c_str());
+        }
+
+        /**
+         * @brief free the slots of client processes that exited without
+         * closing, so their prefix can be registered again
+         *
+         * Called by run_once() every REAP_EVERY calls. A client that dies
+         * while connecting, before its slot is Active, is not detected.
+         *
+         * @return number of slots freed
+         */
+        size_t reap_clients() noexcept
+        {
+            size_t n = 0;
+            for (auto &c : shm->clients)
+            {
+                uint32_t expected = Active;
+                // pid is written before the slot is published Active
+                if (c.state.load(std::memory_order_acquire) == Active && kill(c.pid, 0) != 0 &&
+                    c.state.compare_exchange_strong(expected, Closing, std::memory_order_acq_rel))
+                {
+                    std::cerr << "shmgw: client " << c.prefix << " pid " << c.pid << " is gone, slot freed" << std::endl;
+                    ++n;
+                }
+            }
+            return n;
+        }
+
+        static constexpr size_t REAP_EVERY = 1 << 16;
+
+        /**
+         * @brief send up to max requests of each client
+         *
+         * @return number of requests sent
+         */
+        size_t poll_requests(size_t max = 16) noexcept
+        {
+            size_t n = 0;
+            for (auto &c : shm->clients)
+            {
+                auto state = c.state.load(std::memory_order_acquire);
+                if (state == Closing)
+                {
+                    while (c.requests.front())
+                        c.requests.pop();
+                    c.state.store(Free, std::memory_order_release);
+                    continue;
+                }
+                if (state != Active)
+                    continue;
+                for (size_t i = 0; i < max; ++i)
+                {
+                    auto r = c.requests.front();
+                    if (!r)
+                        break;
+                    if (has_prefix(r->ClOrdID, c))
+                    {
+                        submit::send_request(snd, sock, *r, cloid);
+                        ++n;
+                    }
+                    else
+                        c.bad_prefix.fetch_add(1, std::memory_order_relaxed);
+                    c.requests.pop();
+                }
+            }
+            return n;
+        }
+
+        /**
+         * @brief send waiting requests, then handle messages waiting from CME
+         *
+         * @param msg_buf receive buffer
+         * @param cbif receives everything that is not routed to a client
+         * @return number of messages received
+         */
+        size_t run_once(char *msg_buf, CBIF *cbif) noexcept
+        {
+            if (++runs % REAP_EVERY == 0)
+                reap_clients();
+            poll_requests();
+            size_t n = 0;
+            for (; n < 16; ++n)
+            {
+                auto header = Transport::recv_message(sock, msg_buf, false);
+                if (!header)
+                    break;
+                if (pipeline::decode(&*header, msg_buf, event))
+                {
+                    if (event.type == pipeline::EventType::ExecutionReport)
+                        executionReport(event.exec);
+                    else
+                        cancelReject(event.reject);
+                }
+                else
+                    receiver::process_message(&*header, msg_buf, cbif);
+            }
+            return n;
+        }
+
+        void executionReport(const pipeline::exec_report_t &ev) override
+        {
+            if (auto c = route(ev.cold.ClOrdID))
+            {
+                if (auto s = c->responses.claim())
+                {
+                    s->type = pipeline::EventType::ExecutionReport;
+                    s->exec = ev;
+                    c->responses.publish();
+                }
+                else
+                    c->dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            else if (unrouted)
+                unrouted->executionReport(ev);
+        }
+
+        void cancelReject(const pipeline::cancel_reject_t &ev) override
+        {
+            if (auto c = route(ev.ClOrdID))
+            {
+                if (auto s = c->responses.claim())
+                {
+                    s->type = pipeline::EventType::CancelReject;
+                    s->reject = ev;
+                    c->responses.publish();
+                }
+                else
+                    c->dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            else if (unrouted)
+                unrouted->cancelReject(ev);
+        }
+
+        const client_slot_t &client(size_t i) const noexcept { return shm->clients[i]; }
+
+    private:
+        Gateway(const std::string &_name, shm_layout_t *_shm, ILinkSndT<Transport> &_snd, handle_t _sock,
+                pipeline::EventIF *_unrouted)
+            : name(_name), shm(_shm), snd(_snd), sock(_sock), unrouted(_unrouted)
+        {
+            cloid.reserve(sizeof submit::order_request_t::ClOrdID);
+        }
+
+        /**
+         * @brief name is a gateway segment whose gateway process is gone
+         */
+        static bool left_by_dead_gateway(const std::string &name) noexcept
+        {
+            int fd = shm_open(name.c_str(), O_RDONLY, 0);
+            if (fd < 0)
+                return false;
+            struct stat st;
+            if (fstat(fd, &st) < 0 || size_t(st.st_size) < sizeof(shm_layout_t))
+            {
+                close(fd);
+                std::cerr << "shmgw: " << name << " is not a gateway segment" << std::endl;
+                return false;
+            }
+            void *p = mmap(nullptr, sizeof(shm_layout_t), PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+                return false;
+            auto layout = static_cast<const shm_layout_t *>(p);
+            bool dead = false;
+            if (layout->magic != MAGIC)
+                std::cerr << "shmgw: " << name << " is not a gateway segment" << std::endl;
+            else if (kill(layout->gateway_pid, 0) == 0)
+                std::cerr << "shmgw: " << name << " is in use by gateway pid " << layout->gateway_pid << std::endl;
+            else
+                dead = true;
+            munmap(p, sizeof(shm_layout_t));
+            return dead;
+        }
+
+        client_slot_t *route(const char *ClOrdID) noexcept
+        {
+            for (auto &c : shm->clients)
+                if (c.state.load(std::memory_order_acquire) == Active && has_prefix(ClOrdID, c))
+                    return &c;
+            return nullptr;
+        }
+
+        std::string name;
+        shm_layout_t *shm;
+        ILinkSndT<Transport> &snd;
+        handle_t sock;
+        pipeline::EventIF *unrouted;
+        std::string cloid;
+        pipeline::event_t event;
+        size_t runs = 0;
+    };
+
+    /**
+     * @brief the strategy side, one thread per Client
+     */
+    class Client
+    {
+    public:
+        /**
+         * @param prefix ClOrdID prefix of this client, unique among clients
+         * @return nullptr if there is no gateway, no free slot or the prefix is taken
+         */
+        static std::unique_ptr<Client> connect(const std::string &name, const std::string &prefix)
+        {
+            if (prefix.empty() || prefix.size() > MAX_PREFIX)
+            {
+                std::cerr << "shmgw: prefix must be 1 to " << MAX_PREFIX << " characters" << std::endl;
+                return nullptr;
+            }
+            int fd = shm_open(name.c_str(), O_RDWR, 0);
+            if (fd < 0)
+                return nullptr;
+            void *p = mmap(nullptr, sizeof(shm_layout_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED)
+            {
+                perror("mmap");
+                return nullptr;
+            }
+            auto shm = static_cast<shm_layout_t *>(p);
+            if (shm->magic != MAGIC)
+            {
+                munmap(p, sizeof(shm_layout_t));
+                return nullptr;
+            }
+            for (auto &c : shm->clients)
+            {
+                uint32_t expected = Free;
+                if (!c.state.compare_exchange_strong(expected, Claimed, std::memory_order_acq_rel))
+                    continue;
+                c.pid = getpid();
+                c.prefix_len = prefix.size();
+                memset(c.prefix, 0, sizeof c.prefix);
+                memcpy(c.prefix, prefix.data(), prefix.size());
+                // publish the prefix before looking at the others, of two
+                // clients registering at once at least one sees the other
+                c.state.store(Registering, std::memory_order_seq_cst);
+                if (overlaps(shm, c))
+                {
+                    std::cerr << "shmgw: prefix " << prefix << " overlaps a connected client" << std::endl;
+                    c.state.store(Free, std::memory_order_release);
+                    munmap(p, sizeof(shm_layout_t));
+                    return nullptr;
+                }
+                c.dropped.store(0, std::memory_order_relaxed);
+                c.bad_prefix.store(0, std::memory_order_relaxed);
+                // responses left over from the previous client
+                while (c.responses.front())
+                    c.responses.pop();
+                c.state.store(Active, std::memory_order_release);
+                return std::unique_ptr<Client>(new Client(shm, &c));
+            }
+            std::cerr << "shmgw: no free client slot" << std::endl;
+            munmap(p, sizeof(shm_layout_t));
+            return nullptr;
+        }
+
+        ~Client()
+        {
+            slot->state.store(Closing, std::memory_order_release);
+            munmap(shm, sizeof(shm_layout_t));
+        }
+
+        Client(const Client &) = delete;
+        Client &operator=(const Client &) = delete;
+
+        /**
+         * @return false if the request ring is full or cloid lacks the prefix
+         */
+        bool new_order_single(
+            double price,
+            uint32_t qty,
+            int32_t securityID,
+            sbe::SideReq::Value side,
+            const char *cloid,
+            double stop_px,
+            uint32_t min_qty,
+            uint32_t display_qty,
+            sbe::OrderTypeReq::Value ord_type,
+            sbe::TimeInForce::Value time_in_force) noexcept
+        {
+            auto r = claim(cloid);
+            if (!r)
+                return false;
+            submit::set_new_order_single(*r, price, qty, securityID, side, cloid, stop_px, min_qty, display_qty, ord_type, time_in_force);
+            slot->requests.publish();
+            return true;
+        }
+
+        bool cancel_replace(
+            double price,
+            uint32_t qty,
+            int32_t securityID,
+            sbe::SideReq::Value side,
+            const char *cloid,
+            uint64_t ord_id,
+            double stop_px,
+            uint32_t min_qty,
+            uint32_t display_qty,
+            sbe::OrderTypeReq::Value ord_type,
+            sbe::TimeInForce::Value time_in_force) noexcept
+        {
+            auto r = claim(cloid);
+            if (!r)
+                return false;
+            submit::set_cancel_replace(*r, price, qty, securityID, side, cloid, ord_id, stop_px, min_qty, display_qty, ord_type, time_in_force);
+            slot->requests.publish();
+            return true;
+        }
+
+        bool cancel(
+            uint64_t orig_ordid,
+            const char *cloid,
+            int32_t securityID,
+            sbe::SideReq::Value side) noexcept
+        {
+            auto r = claim(cloid);
+            if (!r)
+                return false;
+            submit::set_cancel(*r, orig_ordid, cloid, securityID, side);
+            slot->requests.publish();
+            return true;
+        }
+
+        /**
+         * @brief deliver up to max responses
+         *
+         * @return number delivered
+         */
+        size_t poll(pipeline::EventIF *ev, size_t max = 64) noexcept
+        {
+            size_t n = 0;
+            while (n < max)
+            {
+                auto r = slot->responses.front();
+                if (!r)
+                    break;
+                if (r->type == pipeline::EventType::ExecutionReport)
+                    ev->executionReport(r->exec);
+                else
+                    ev->cancelReject(r->reject);
+                slot->responses.pop();
+                ++n;
+            }
+            return n;
+        }
+
+        /**
+         * @brief responses the gateway dropped because the ring was full
+         */
+        uint64_t dropped() const noexcept { return slot->dropped.load(std::memory_order_relaxed); }
+
+        bool gateway_alive() const noexcept
+        {
+            return shm->magic == MAGIC && kill(shm->gateway_pid, 0) == 0;
+        }
+
+    private:
+        Client(shm_layout_t *_shm, client_slot_t *_slot) : shm(_shm), slot(_slot) {}
+
+        /**
+         * @brief another registering or connected client has a prefix
+         * that starts with the one of slot, or the other way round
+         */
+        static bool overlaps(shm_layout_t *shm, const client_slot_t &slot) noexcept
+        {
+            for (auto &c : shm->clients)
+            {
+                if (&c == &slot)
+                    continue;
+                auto state = c.state.load(std::memory_order_seq_cst);
+                if ((state == Registering || state == Active) &&
+                    memcmp(slot.prefix, c.prefix, std::min(slot.prefix_len, c.prefix_len)) == 0)
+                    return true;
+            }
+            return false;
+        }
+
+        submit::order_request_t *claim(const char *cloid) noexcept
+        {
+            if (strncmp(cloid, slot->prefix, slot->prefix_len) != 0)
+            {
+                std::cerr << "shmgw: ClOrdID " << cloid << " does not start with " << slot->prefix << std::endl;
+                return nullptr;
+            }
+            return slot->requests.claim();
+        }
+
+        shm_layout_t *shm;
+        client_slot_t *slot;
+    };
+}
@@ -1,5 +1,7 @@
 // using Crypto++ library version 5.6.5 from https://www.cryptopp.com/
 
+#pragma once
+
 #include <string>
 #include <cstdlib>
 #include "cryptopp/cryptlib.h"
@@ -51,3 +53,47 @@ static std::string calculateHMAC(const std::string &key, const std::string &cano
 
     return calculatedHmac;
 }
+
+/**
+ * @brief calculateHMAC() with the key decoded once and the HMAC
+ * context kept, so Negotiate and Establish (e.g. on failover) do not
+ * decode the key and set up SHA256 again
+ */
+class HMACSigner
+{
+public:
+    explicit HMACSigner(const std::string &key)
+    {
+        std::string decoded_key;
+        try
+        {
+            CryptoPP::StringSource(key, true,
+                                   new CryptoPP::Base64URLDecoder(
+                                       new CryptoPP::StringSink(decoded_key)));
+            hmac.SetKey((const byte *)decoded_key.data(), decoded_key.size());
+        }
+        catch (const CryptoPP::Exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            abort();
+        }
+    }
+
+    HMACSigner(const HMACSigner &) = delete;
+    HMACSigner &operator=(const HMACSigner &) = delete;
+
+    /**
+     * @brief same result as calculateHMAC(key, canonicalRequest)
+     */
+    std::string sign(const std::string &canonicalRequest)
+    {
+        std::string calculatedHmac(CryptoPP::HMAC<CryptoPP::SHA256>::DIGESTSIZE, '\0');
+        hmac.Update((const byte *)canonicalRequest.data(), canonicalRequest.size());
+        // Final() also resets the context for the next message
+        hmac.Final((byte *)&calculatedHmac[0]);
+        return calculatedHmac;
+    }
+
+private:
+    CryptoPP::HMAC<CryptoPP::SHA256> hmac;
+};
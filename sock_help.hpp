@@ -45,8 +45,11 @@ https://opensource.org/licenses/MIT
 #include <unistd.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <errno.h>
 #include <iostream>
 #include <optional>
+#include <type_traits>
+#include <utility>
 
 #include "ilink_v8/NegotiationResponse501.h"
 
@@ -112,12 +115,13 @@ namespace m2::ilink::sockhelp
     };
 
     /**
-     * @brief Send a message to the socket
+     * @brief Write the SOFH in front of an encoded message
      *
-     * @param msg
-     * @return auto
+     * @param msg buffer the message was encoded into at SOFH_HEADER_SIZE
+     * @param sz encoded length of the message
+     * @return total framed size
      */
-    static auto send_message(int sock, const char *msg, int sz, bool add_cred = false) noexcept
+    static ssize_t frame_message(const char *msg, int sz, bool add_cred = false) noexcept
     {
         ssize_t totmsgsz = sz + SOFH_AND_SBE_HEADER_SIZE;
         if (add_cred)
@@ -126,6 +130,18 @@ namespace m2::ilink::sockhelp
         auto header = (uint16_t *)msg;
         *header++ = totmsgsz;
         *header++ = 0xCAFE;
+        return totmsgsz;
+    }
+
+    /**
+     * @brief Send a message to the socket
+     *
+     * @param msg
+     * @return auto
+     */
+    static auto send_message(int sock, const char *msg, int sz, bool add_cred = false) noexcept
+    {
+        auto totmsgsz = frame_message(msg, sz, add_cred);
         auto bytes = send(sock, msg, totmsgsz, 0);
         if (bytes < totmsgsz)
         {
@@ -135,6 +151,20 @@ namespace m2::ilink::sockhelp
         return bytes;
     }
 
+    /**
+     * @brief run the send path for a message without sending it
+     *
+     * Frames msg and makes a zero length send() on the socket, which
+     * goes through the syscall and TCP send code but puts nothing
+     * on the wire. Used by ILinkSndT::warm_up().
+     */
+    static auto warm_message(int sock, const char *msg, int sz, bool add_cred = false) noexcept
+    {
+        auto totmsgsz = frame_message(msg, sz, add_cred);
+        send(sock, msg, 0, MSG_DONTWAIT | MSG_NOSIGNAL);
+        return totmsgsz;
+    }
+
     /**
      * @brief Receive a message from the socket
      * @see https://www.cmegroup.com/confluence/display/EPICSANDBOX/iLink+3+Message+Header
@@ -153,7 +183,7 @@ namespace m2::ilink::sockhelp
         int flags = 0;
         if (!block)
         {
-            auto avail_bytes = recv(sock, buffer, SOFH_AND_SBE_HEADER_SIZE, MSG_PEEK);
+            auto avail_bytes = recv(sock, buffer, SOFH_AND_SBE_HEADER_SIZE, MSG_PEEK | MSG_DONTWAIT);
             if (avail_bytes < (decltype(avail_bytes))SOFH_AND_SBE_HEADER_SIZE)
                 return {};
         }
@@ -231,4 +261,183 @@ namespace m2::ilink::sockhelp
         return header;
     }
 
+    /**
+     * @brief Transport policy for ILinkSndT and process_message_from_msgw
+     *
+     * A transport has a handle_t naming the connection and
+     *   send_message(handle_t, const char *msg, int sz, bool add_cred)
+     *     frame (see frame_message) and send a message encoded at SOFH_HEADER_SIZE
+     *   recv_message(handle_t, char *msg_buf, bool block)
+     *     read one message, header returned and body placed in msg_buf
+     *
+     * Transports: SocketTransport, BusyPollSocketTransport and
+     * DisconnectingSocketTransport here,
+     * inproc::InprocTransport (in process or shared memory rings) in inproc.hpp,
+     * timestamping::TimestampingTransport in timestamping.hpp and
+     * capture::CapturingTransport (journals another transport) in capture.hpp.
+     *
+     * This one is the CME TCP socket.
+     */
+    struct SocketTransport
+    {
+        using handle_t = int;
+
+        static auto send_message(handle_t sock, const char *msg, int sz, bool add_cred = false) noexcept
+        {
+            return sockhelp::send_message(sock, msg, sz, add_cred);
+        }
+
+        static auto warm_message(handle_t sock, const char *msg, int sz, bool add_cred = false) noexcept
+        {
+            return sockhelp::warm_message(sock, msg, sz, add_cred);
+        }
+
+        static std::optional<cme_msg_header_t>
+        recv_message(handle_t sock, char *msg_buf, bool block = true) noexcept
+        {
+            return sockhelp::recv_message(sock, msg_buf, block);
+        }
+    };
+
+    /**
+     * @brief CME TCP socket, receive spins instead of sleeping in the kernel
+     *
+     * For a receive thread that has a core to itself. set_busy_poll()
+     * also asks the kernel to busy poll the NIC queue (SO_BUSY_POLL,
+     * needs CAP_NET_ADMIN for values above net.core.busy_poll).
+     */
+    struct BusyPollSocketTransport
+    {
+        using handle_t = int;
+
+        static bool set_busy_poll(handle_t sock, int usecs = 50) noexcept
+        {
+#ifdef SO_BUSY_POLL
+            if (setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &usecs, sizeof usecs) == 0)
+                return true;
+            perror("setsockopt SO_BUSY_POLL");
+#endif
+            return false;
+        }
+
+        static auto send_message(handle_t sock, const char *msg, int sz, bool add_cred = false) noexcept
+        {
+            return sockhelp::send_message(sock, msg, sz, add_cred);
+        }
+
+        static auto warm_message(handle_t sock, const char *msg, int sz, bool add_cred = false) noexcept
+        {
+            return sockhelp::warm_message(sock, msg, sz, add_cred);
+        }
+
+        static std::optional<cme_msg_header_t>
+        recv_message(handle_t sock, char *msg_buf, bool block = true) noexcept
+        {
+            for (;;)
+            {
+                auto header = sockhelp::recv_message(sock, msg_buf, false);
+                if (header || !block)
+                    return header;
+                // recv_message can not tell an idle socket from a closed one
+                char c;
+                auto n = recv(sock, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK))
+                    return {};
+            }
+        }
+    };
+
+    /**
+     * @brief CME TCP socket for sessions that outlive their connection
+     *
+     * SocketTransport aborts on a failed send. Here a failed send
+     * (peer reset, socket already closed) shuts the socket down and
+     * returns -1, MSG_NOSIGNAL keeps SIGPIPE away. The reader then
+     * sees end of file, so coro::Session reports Disconnected and
+     * failover::Failover can move to the standby.
+     */
+    struct DisconnectingSocketTransport
+    {
+        using handle_t = int;
+
+        static ssize_t send_message(handle_t sock, const char *msg, int sz, bool add_cred = false) noexcept
+        {
+            auto totmsgsz = frame_message(msg, sz, add_cred);
+            ssize_t sent = 0;
+            while (sent < totmsgsz)
+            {
+                auto bytes = send(sock, msg + sent, totmsgsz - sent, MSG_NOSIGNAL);
+                if (bytes < 0 && errno == EINTR)
+                    continue;
+                if (bytes <= 0)
+                {
+                    shutdown(sock, SHUT_RDWR);
+                    return -1;
+                }
+                sent += bytes;
+            }
+            return sent;
+        }
+
+        static auto warm_message(handle_t sock, const char *msg, int sz, bool add_cred = false) noexcept
+        {
+            return sockhelp::warm_message(sock, msg, sz, add_cred);
+        }
+
+        static std::optional<cme_msg_header_t>
+        recv_message(handle_t sock, char *msg_buf, bool block = true) noexcept
+        {
+            return sockhelp::recv_message(sock, msg_buf, block);
+        }
+    };
+
+    /**
+     * @brief compile time checks of the transport policy
+     *
+     * ILinkSndT needs a send transport, process_message_from_msgw a
+     * receive transport.
+     */
+    template <typename T, typename = void>
+    struct is_send_transport : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct is_send_transport<T, std::void_t<
+                                    typename T::handle_t,
+                                    decltype(T::send_message(std::declval<typename T::handle_t>(), (const char *)nullptr, 0, false))>>
+        : std::true_type
+    {
+    };
+
+    /**
+     * @brief transport has warm_message(handle_t, const char *, int, bool),
+     * transports without it are warmed by encoding only
+     */
+    template <typename T, typename = void>
+    struct has_warm_message : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct has_warm_message<T, std::void_t<
+                                   decltype(T::warm_message(std::declval<typename T::handle_t>(), (const char *)nullptr, 0, false))>>
+        : std::true_type
+    {
+    };
+
+    template <typename T, typename = void>
+    struct is_recv_transport : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct is_recv_transport<T, std::void_t<
+                                    typename T::handle_t,
+                                    decltype(T::recv_message(std::declval<typename T::handle_t>(), (char *)nullptr, true))>>
+        : std::is_same<decltype(T::recv_message(std::declval<typename T::handle_t>(), (char *)nullptr, true)),
+                       std::optional<cme_msg_header_t>>
+    {
+    };
+
 }
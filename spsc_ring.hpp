@@ -0,0 +1,179 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <atomic>
+#include <type_traits>
+
+/***************************************************************
+ *
+ * Lock free single producer / single consumer ring of fixed size
+ * trivially copyable slots.
+ *
+ * Producer and consumer indexes live on their own cache lines and each
+ * side keeps a cached copy of the other's index, so in steady state
+ * neither side touches the other's line.
+ *
+ * The slots are inline so a ring can be placed in shared memory,
+ * allocate large rings on the heap.
+ *
+ * Slots are written and read in place:
+ *
+ *   producer: if (auto s = ring.claim()) { fill *s; ring.publish(); }
+ *   consumer: if (auto s = ring.front()) { use *s; ring.pop(); }
+ *
+ * *************************************************************/
+
+namespace m2::ilink
+{
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    /**
+     * @brief spin wait hint
+     */
+    static inline void cpu_relax() noexcept
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+#endif
+    }
+
+    /**
+     * @tparam T slot type
+     * @tparam N number of slots, a power of two
+     */
+    template <typename T, size_t N>
+    class SpscRing
+    {
+        static_assert(N && (N & (N - 1)) == 0, "N must be a power of two");
+        static_assert(std::is_trivially_copyable_v<T>, "slots are copied as bytes");
+
+    public:
+        SpscRing() = default;
+
+        /**
+         * @brief next free slot, nullptr if the ring is full
+         */
+        T *claim() noexcept
+        {
+            auto h = head.load(std::memory_order_relaxed);
+            if (h - cached_tail == N)
+            {
+                cached_tail = tail.load(std::memory_order_acquire);
+                if (h - cached_tail == N)
+                    return nullptr;
+            }
+            return &slots[h & (N - 1)];
+        }
+
+        /**
+         * @brief make the claimed slot visible to the consumer
+         */
+        void publish() noexcept
+        {
+            head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        bool try_push(const T &v) noexcept
+        {
+            auto s = claim();
+            if (!s)
+                return false;
+            *s = v;
+            publish();
+            return true;
+        }
+
+        /**
+         * @brief oldest slot, nullptr if the ring is empty
+         */
+        T *front() noexcept
+        {
+            auto t = tail.load(std::memory_order_relaxed);
+            if (t == cached_head)
+            {
+                cached_head = head.load(std::memory_order_acquire);
+                if (t == cached_head)
+                    return nullptr;
+            }
+            return &slots[t & (N - 1)];
+        }
+
+        /**
+         * @brief release the slot returned by front()
+         */
+        void pop() noexcept
+        {
+            tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
+        bool try_pop(T &v) noexcept
+        {
+            auto s = front();
+            if (!s)
+                return false;
+            v = *s;
+            pop();
+            return true;
+        }
+
+        size_t size() const noexcept
+        {
+            return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+        }
+
+        static constexpr size_t capacity() noexcept { return N; }
+
+    private:
+        // producer
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> head{0};
+        uint64_t cached_tail = 0;
+        // consumer
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tail{0};
+        uint64_t cached_head = 0;
+        alignas(CACHE_LINE_SIZE) T slots[N];
+    };
+}
@@ -0,0 +1,597 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "sock_help.hpp"
+#include "spsc_ring.hpp"
+#include "ILinkSnd.hpp"
+
+/***************************************************************
+ *
+ * Order submission from several threads into one iLink session
+ *
+ * ILinkSnd owns NextSeqNo and OrderRequestID and is not thread safe.
+ * Two ways to share one session between producer threads without a
+ * mutex, both with a single sender thread that owns the connection:
+ *
+ * QueueSubmitter: producers push small order_request_t PODs into a
+ *   bounded lock free MPSC queue, the sender thread encodes them with
+ *   the session's ILinkSnd and sends. Sequence numbers are assigned by
+ *   the one encoder, in queue order.
+ *
+ * ReserveSubmitter: producers take a ticket with one atomic add, the
+ *   ticket fixes the SeqNum and OrderRequestID, then encode in parallel
+ *   with their own Encoder into the ticket's slot of an ordered ring.
+ *   The sender thread sends slots strictly in ticket order. Encoding
+ *   is off the sender thread, the only shared write is the ticket.
+ *   Every ticket must be used for exactly one message that takes a
+ *   SeqNum, a producer that stops between ticket and send stalls the
+ *   session.
+ *
+ * In both modes session messages go through the session's ILinkSnd,
+ * which is kept in step by the sender thread. Heartbeats are sent with
+ * sequence() so they carry the right NextSeqNo.
+ *
+ * Negotiate and Establish before start(), send nothing on the session's
+ * ILinkSnd between start() and stop().
+ *
+ * *************************************************************/
+
+namespace m2::ilink::submit
+{
+    /**
+     * @brief bounded multi producer single consumer ring
+     *
+     * Producers take tickets with fetch_add and wait for their slot to
+     * be free, the consumer takes slots in ticket order. After D. Vyukov's
+     * bounded queue.
+     */
+    template <typename T, size_t N>
+    class MpscRing
+    {
+        static_assert(N && (N & (N - 1)) == 0, "N must be a power of two");
+
+    public:
+        struct alignas(CACHE_LINE_SIZE) slot_t
+        {
+            std::atomic<uint64_t> turn;
+            T value;
+        };
+
+        MpscRing() : slots(new slot_t[N])
+        {
+            for (size_t i = 0; i < N; ++i)
+                slots[i].turn.store(i, std::memory_order_relaxed);
+        }
+
+        /**
+         * @brief take the next ticket, spins while its slot is in use
+         */
+        uint64_t reserve() noexcept
+        {
+            auto ticket = next_ticket.fetch_add(1, std::memory_order_relaxed);
+            auto &s = slots[ticket & (N - 1)];
+            while (s.turn.load(std::memory_order_acquire) != ticket)
+                cpu_relax();
+            return ticket;
+        }
+
+        T &at(uint64_t ticket) noexcept
+        {
+            return slots[ticket & (N - 1)].value;
+        }
+
+        void publish(uint64_t ticket) noexcept
+        {
+            slots[ticket & (N - 1)].turn.store(ticket + 1, std::memory_order_release);
+        }
+
+        /**
+         * @brief oldest slot if it is published, else nullptr
+         */
+        T *front() noexcept
+        {
+            auto &s = slots[head & (N - 1)];
+            if (s.turn.load(std::memory_order_acquire) != head + 1)
+                return nullptr;
+            return &s.value;
+        }
+
+        void pop() noexcept
+        {
+            slots[head & (N - 1)].turn.store(head + N, std::memory_order_release);
+            ++head;
+        }
+
+        /**
+         * @brief tickets taken so far
+         */
+        uint64_t reserved() const noexcept
+        {
+            return next_ticket.load(std::memory_order_relaxed);
+        }
+
+        static constexpr size_t capacity() noexcept { return N; }
+
+    private:
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> next_ticket{0};
+        // consumer
+        alignas(CACHE_LINE_SIZE) uint64_t head = 0;
+        std::unique_ptr<slot_t[]> slots;
+    };
+
+    //
+    // QUEUE MODE
+    //
+
+    enum class RequestType : uint8_t
+    {
+        NewOrderSingle,
+        CancelReplace,
+        Cancel
+    };
+
+    /**
+     * @brief arguments of the ILinkSnd send_* call
+     */
+    struct order_request_t
+    {
+        RequestType type;
+        char ClOrdID[21]; // nul terminated
+        double price;
+        double stop_px;
+        uint64_t OrderID;
+        uint32_t qty;
+        uint32_t min_qty;
+        uint32_t display_qty;
+        int32_t securityID;
+        sbe::SideReq::Value side;
+        sbe::OrderTypeReq::Value ord_type;
+        sbe::TimeInForce::Value time_in_force;
+    };
+
+    static void copy_cloid(order_request_t &r, const char *cloid) noexcept
+    {
+        strncpy(r.ClOrdID, cloid, sizeof r.ClOrdID - 1);
+        r.ClOrdID[sizeof r.ClOrdID - 1] = 0;
+    }
+
+    /**
+     * @brief fill a request with the arguments of ILinkSnd::send_new_order_single()
+     */
+    static void set_new_order_single(
+        order_request_t &r,
+        double price,
+        uint32_t qty,
+        int32_t securityID,
+        sbe::SideReq::Value side,
+        const char *cloid,
+        double stop_px,
+        uint32_t min_qty,
+        uint32_t display_qty,
+        sbe::OrderTypeReq::Value ord_type,
+        sbe::TimeInForce::Value time_in_force) noexcept
+    {
+        r.type = RequestType::NewOrderSingle;
+        copy_cloid(r, cloid);
+        r.price = price;
+        r.qty = qty;
+        r.securityID = securityID;
+        r.side = side;
+        r.OrderID = 0;
+        r.stop_px = stop_px;
+        r.min_qty = min_qty;
+        r.display_qty = display_qty;
+        r.ord_type = ord_type;
+        r.time_in_force = time_in_force;
+    }
+
+    /**
+     * @brief fill a request with the arguments of ILinkSnd::send_cancel_replace()
+     */
+    static void set_cancel_replace(
+        order_request_t &r,
+        double price,
+        uint32_t qty,
+        int32_t securityID,
+        sbe::SideReq::Value side,
+        const char *cloid,
+        uint64_t ord_id,
+        double stop_px,
+        uint32_t min_qty,
+        uint32_t display_qty,
+        sbe::OrderTypeReq::Value ord_type,
+        sbe::TimeInForce::Value time_in_force) noexcept
+    {
+        set_new_order_single(r, price, qty, securityID, side, cloid, stop_px, min_qty, display_qty, ord_type, time_in_force);
+        r.type = RequestType::CancelReplace;
+        r.OrderID = ord_id;
+    }
+
+    /**
+     * @brief fill a request with the arguments of ILinkSnd::send_cancel()
+     */
+    static void set_cancel(
+        order_request_t &r,
+        uint64_t orig_ordid,
+        const char *cloid,
+        int32_t securityID,
+        sbe::SideReq::Value side) noexcept
+    {
+        r.type = RequestType::Cancel;
+        copy_cloid(r, cloid);
+        r.OrderID = orig_ordid;
+        r.securityID = securityID;
+        r.side = side;
+    }
+
+    /**
+     * @brief encode and send one request
+     *
+     * @param cloid scratch string, reused between calls
+     */
+    template <typename Transport>
+    static void send_request(ILinkSndT<Transport> &snd, typename Transport::handle_t sock,
+                             const order_request_t &r, std::string &cloid) noexcept
+    {
+        cloid.assign(r.ClOrdID);
+        switch (r.type)
+        {
+        case RequestType::NewOrderSingle:
+            snd.send_new_order_single(sock, r.price, r.qty, r.securityID, r.side, cloid,
+                                      r.stop_px, r.min_qty, r.display_qty, r.ord_type, r.time_in_force);
+            break;
+        case RequestType::CancelReplace:
+            snd.send_cancel_replace(sock, r.price, r.qty, r.securityID, r.side, cloid, r.OrderID,
+                                    r.stop_px, r.min_qty, r.display_qty, r.ord_type, r.time_in_force);
+            break;
+        case RequestType::Cancel:
+            snd.send_cancel(sock, r.OrderID, cloid, r.securityID, r.side);
+            break;
+        }
+    }
+
+    template <typename Transport = sockhelp::SocketTransport, size_t N = 4096>
+    class QueueSubmitter
+    {
+    public:
+        using handle_t = typename Transport::handle_t;
+
+        QueueSubmitter(ILinkSndT<Transport> &_snd, handle_t _sock)
+            : snd(_snd), sock(_sock) {}
+
+        ~QueueSubmitter()
+        {
+            stop();
+        }
+
+        /**
+         * @brief start the sender thread, cpu < 0 leaves it unpinned
+         */
+        void start(int cpu = -1)
+        {
+            running = true;
+            sender = std::thread([this]
+                                 { run(); });
+            if (cpu >= 0)
+            {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                pthread_setaffinity_np(sender.native_handle(), sizeof set, &set);
+            }
+        }
+
+        /**
+         * @brief send everything queued, then stop the sender thread
+         */
+        void stop()
+        {
+            running = false;
+            if (sender.joinable())
+                sender.join();
+        }
+
+        void new_order_single(
+            double price,
+            uint32_t qty,
+            int32_t securityID,
+            sbe::SideReq::Value side,
+            const char *cloid,
+            double stop_px,
+            uint32_t min_qty,
+            uint32_t display_qty,
+            sbe::OrderTypeReq::Value ord_type,
+            sbe::TimeInForce::Value time_in_force) noexcept
+        {
+            auto t = queue.reserve();
+            set_new_order_single(queue.at(t), price, qty, securityID, side, cloid, stop_px, min_qty, display_qty, ord_type, time_in_force);
+            queue.publish(t);
+        }
+
+        void cancel_replace(
+            double price,
+            uint32_t qty,
+            int32_t securityID,
+            sbe::SideReq::Value side,
+            const char *cloid,
+            uint64_t ord_id,
+            double stop_px,
+            uint32_t min_qty,
+            uint32_t display_qty,
+            sbe::OrderTypeReq::Value ord_type,
+            sbe::TimeInForce::Value time_in_force) noexcept
+        {
+            auto t = queue.reserve();
+            set_cancel_replace(queue.at(t), price, qty, securityID, side, cloid, ord_id, stop_px, min_qty, display_qty, ord_type, time_in_force);
+            queue.publish(t);
+        }
+
+        void cancel(
+            uint64_t orig_ordid,
+            const char *cloid,
+            int32_t securityID,
+            sbe::SideReq::Value side) noexcept
+        {
+            auto t = queue.reserve();
+            set_cancel(queue.at(t), orig_ordid, cloid, securityID, side);
+            queue.publish(t);
+        }
+
+        /**
+         * @brief send Sequence506 from the sender thread, in place of
+         * ILinkSnd::send_sequence()
+         */
+        void sequence(bool lapsed = false) noexcept
+        {
+            pending_sequence.store(lapsed ? 2 : 1, std::memory_order_release);
+        }
+
+    private:
+        ILinkSndT<Transport> &snd;
+        handle_t sock;
+        MpscRing<order_request_t, N> queue;
+        std::atomic<bool> running{false};
+        std::atomic<int> pending_sequence{0};
+        std::thread sender;
+        uint64_t sent = 0;
+
+        void run() noexcept
+        {
+            std::string cloid;
+            cloid.reserve(sizeof order_request_t::ClOrdID);
+            for (;;)
+            {
+                if (auto seq = pending_sequence.exchange(0, std::memory_order_acquire))
+                    snd.send_sequence(sock, seq == 2);
+
+                auto r = queue.front();
+                if (!r)
+                {
+                    // stop once every request queued has been sent
+                    if (!running.load(std::memory_order_acquire) && sent == queue.reserved())
+                        break;
+                    cpu_relax();
+                    continue;
+                }
+                send_request(snd, sock, *r, cloid);
+                queue.pop();
+                ++sent;
+            }
+        }
+    };
+
+    //
+    // RESERVE MODE
+    //
+
+    static constexpr size_t MAX_FRAME_SIZE = 1024 - 8;
+
+    struct frame_t
+    {
+        uint16_t len;
+        char data[MAX_FRAME_SIZE];
+    };
+
+    /**
+     * @brief Transport that frames into a ticket's slot
+     */
+    struct SlotTransport
+    {
+        using handle_t = frame_t *;
+
+        static auto send_message(handle_t slot, const char *msg, int sz, bool add_cred = false) noexcept
+        {
+            auto totmsgsz = sockhelp::frame_message(msg, sz, add_cred);
+            if (slot->len || (size_t)totmsgsz > MAX_FRAME_SIZE)
+            {
+                std::cerr << "submit: one message of at most " << MAX_FRAME_SIZE << " bytes per ticket" << std::endl;
+                abort();
+            }
+            memcpy(slot->data, msg, totmsgsz);
+            slot->len = totmsgsz;
+            return totmsgsz;
+        }
+    };
+
+    /**
+     * @brief a producer's encoder
+     */
+    using Encoder = ILinkSndT<SlotTransport>;
+
+    template <typename Transport = sockhelp::SocketTransport, size_t N = 4096>
+    class ReserveSubmitter
+    {
+    public:
+        using handle_t = typename Transport::handle_t;
+
+        /**
+         * @param _snd the session, tickets start at its next SeqNum and OrderRequestID
+         */
+        ReserveSubmitter(ILinkSndT<Transport> &_snd, handle_t _sock)
+            : snd(_snd), sock(_sock),
+              seq_base(_snd.get_next_seq_no()),
+              req_base(_snd.get_order_request_id()) {}
+
+        ~ReserveSubmitter()
+        {
+            stop();
+        }
+
+        /**
+         * @brief encoder for one producer thread, do not share it
+         * call before start()
+         */
+        std::unique_ptr<Encoder> make_encoder() const
+        {
+            return std::make_unique<Encoder>(snd);
+        }
+
+        /**
+         * @brief encode and queue one message
+         *
+         * f(Encoder&, SlotTransport::handle_t) calls one send_* method of
+         * the encoder with the handle, e.g.
+         *
+         *   sub.submit(*enc, [&](auto &e, auto slot)
+         *     { e.send_cancel(slot, order_id, cloid, security_id, side); });
+         */
+        template <typename F>
+        void submit(Encoder &enc, F &&f) noexcept
+        {
+            auto t = ring.reserve();
+            auto &slot = ring.at(t);
+            slot.len = 0;
+            enc.set_next_ids(seq_base + t, req_base + t);
+            f(enc, &slot);
+            if (!slot.len)
+            {
+                std::cerr << "submit: ticket " << t << " was not used" << std::endl;
+                abort();
+            }
+            ring.publish(t);
+        }
+
+        void start(int cpu = -1)
+        {
+            running = true;
+            sender = std::thread([this]
+                                 { run(); });
+            if (cpu >= 0)
+            {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                pthread_setaffinity_np(sender.native_handle(), sizeof set, &set);
+            }
+        }
+
+        /**
+         * @brief send everything published, then stop the sender thread
+         * the session's ILinkSnd continues after the last ticket
+         */
+        void stop()
+        {
+            running = false;
+            if (sender.joinable())
+                sender.join();
+        }
+
+        /**
+         * @see QueueSubmitter::sequence()
+         */
+        void sequence(bool lapsed = false) noexcept
+        {
+            pending_sequence.store(lapsed ? 2 : 1, std::memory_order_release);
+        }
+
+    private:
+        ILinkSndT<Transport> &snd;
+        handle_t sock;
+        uint32_t seq_base;
+        uint64_t req_base;
+        MpscRing<frame_t, N> ring;
+        std::atomic<bool> running{false};
+        std::atomic<int> pending_sequence{0};
+        std::thread sender;
+        uint64_t sent = 0;
+
+        void run() noexcept
+        {
+            for (;;)
+            {
+                if (auto seq = pending_sequence.exchange(0, std::memory_order_acquire))
+                    snd.send_sequence(sock, seq == 2);
+
+                auto f = ring.front();
+                if (!f)
+                {
+                    // stop once every ticket taken has been sent
+                    if (!running.load(std::memory_order_acquire) && sent == ring.reserved())
+                        break;
+                    cpu_relax();
+                    continue;
+                }
+                // send what is published, then bring the session up to date
+                // once for the batch, it saves the session state
+                size_t batch = 0;
+                do
+                {
+                    Transport::send_message(sock, f->data, f->len - sockhelp::SOFH_AND_SBE_HEADER_SIZE);
+                    ring.pop();
+                    ++sent;
+                } while (++batch < N && (f = ring.front()));
+                snd.set_next_ids(seq_base + sent, req_base + sent);
+            }
+        }
+    };
+}
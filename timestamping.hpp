@@ -0,0 +1,390 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+// after time.h, errqueue.h uses struct timespec
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+
+#include <iostream>
+#include <optional>
+
+#include "ilink_v8/NewOrderSingle514.h"
+#include "ilink_v8/OrderCancelReplaceRequest515.h"
+#include "ilink_v8/OrderCancelRequest516.h"
+#include "ilink_v8/MassQuote517.h"
+#include "ilink_v8/PartyDetailsDefinitionRequest518.h"
+#include "ilink_v8/QuoteCancel528.h"
+#include "ilink_v8/OrderMassActionRequest529.h"
+#include "ilink_v8/OrderMassStatusRequest530.h"
+#include "ilink_v8/OrderStatusRequest533.h"
+#include "ilink_v8/PartyDetailsListRequest537.h"
+
+#include "sock_help.hpp"
+#include "latency.hpp"
+
+/***************************************************************
+ *
+ * Kernel RX/TX timestamps (SO_TIMESTAMPING)
+ *
+ * Measures the time a message spends in the kernel on each side of
+ * the session socket:
+ *
+ *   RX: kernel received the first byte of a message (software RX
+ *       timestamp) -> recv_message returned it
+ *   TX: send() called -> kernel handed the message to the device
+ *       (software TX timestamp, SOF_TIMESTAMPING_TX_SOFTWARE)
+ *
+ * TimestampingTransport is a transport policy (see sock_help.hpp) over
+ * a TimestampedSocket:
+ *
+ *   timestamping::TimestampedSocket ts(sock, stats);
+ *   ILinkSndT<timestamping::TimestampingTransport> snd(...);
+ *   snd.send_new_order_single(&ts, ...);
+ *   process_message_from_msgw<timestamping::TimestampingTransport>(&ts, msg_buf, &cbif);
+ *   // in the CBIF: ts.rx_kernel_ns(), ts.rx_user_ns() of the current message
+ *   ts.poll_tx([](const timestamping::tx_stamp_t &t) { ... });
+ *
+ * TX timestamps come back on the socket error queue. poll_tx() reads
+ * them and matches them to sends by byte offset (SOF_TIMESTAMPING_OPT_ID),
+ * each is reported with the SeqNum of the message sent. Call it from
+ * the session loop, stamps wait in the error queue until then. Offsets
+ * count from the TimestampedSocket constructor, so every later send on
+ * the socket must go through it.
+ *
+ * With a latency::Stats both intervals also go to the SocketRx and
+ * SocketTx histograms.
+ *
+ * Receiving costs one extra recvmsg(MSG_PEEK) per message for the
+ * timestamp. All timestamps are CLOCK_REALTIME ns. Software timestamps
+ * work on loopback, so this can be tried against the mock gateway.
+ *
+ * *************************************************************/
+
+namespace m2::ilink::timestamping
+{
+    static constexpr int FLAGS =
+        SOF_TIMESTAMPING_RX_SOFTWARE |
+        SOF_TIMESTAMPING_TX_SOFTWARE |
+        SOF_TIMESTAMPING_SOFTWARE |
+        SOF_TIMESTAMPING_OPT_ID |
+        SOF_TIMESTAMPING_OPT_TSONLY;
+
+    /**
+     * @brief an outbound message and when it left
+     */
+    struct tx_stamp_t
+    {
+        uint32_t SeqNum; // 0 for session messages
+        uint16_t TemplateID;
+        uint64_t user_ns;   // send() called
+        uint64_t kernel_ns; // handed to the device
+    };
+
+    static inline uint64_t now_ns() noexcept
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    template <typename M>
+    static uint32_t read_seq_num(const char *frame) noexcept
+    {
+        uint32_t seq;
+        memcpy(&seq, frame + sockhelp::SOFH_AND_SBE_HEADER_SIZE + M::seqNumEncodingOffset(), sizeof seq);
+        return seq;
+    }
+
+    /**
+     * @brief SeqNum of a framed application message sent by ILinkSnd, 0 for others
+     */
+    static uint32_t seq_num_of(const char *frame, uint16_t template_id) noexcept
+    {
+        switch (template_id)
+        {
+        case sbe::NewOrderSingle514::sbeTemplateId():
+            return read_seq_num<sbe::NewOrderSingle514>(frame);
+        case sbe::OrderCancelReplaceRequest515::sbeTemplateId():
+            return read_seq_num<sbe::OrderCancelReplaceRequest515>(frame);
+        case sbe::OrderCancelRequest516::sbeTemplateId():
+            return read_seq_num<sbe::OrderCancelRequest516>(frame);
+        case sbe::MassQuote517::sbeTemplateId():
+            return read_seq_num<sbe::MassQuote517>(frame);
+        case sbe::PartyDetailsDefinitionRequest518::sbeTemplateId():
+            return read_seq_num<sbe::PartyDetailsDefinitionRequest518>(frame);
+        case sbe::QuoteCancel528::sbeTemplateId():
+            return read_seq_num<sbe::QuoteCancel528>(frame);
+        case sbe::OrderMassActionRequest529::sbeTemplateId():
+            return read_seq_num<sbe::OrderMassActionRequest529>(frame);
+        case sbe::OrderMassStatusRequest530::sbeTemplateId():
+            return read_seq_num<sbe::OrderMassStatusRequest530>(frame);
+        case sbe::OrderStatusRequest533::sbeTemplateId():
+            return read_seq_num<sbe::OrderStatusRequest533>(frame);
+        case sbe::PartyDetailsListRequest537::sbeTemplateId():
+            return read_seq_num<sbe::PartyDetailsListRequest537>(frame);
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * @brief timestamp from an SCM_TIMESTAMPING control message, 0 if none
+     */
+    static uint64_t software_stamp(struct msghdr &mh) noexcept
+    {
+        for (auto c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c))
+        {
+            if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_TIMESTAMPING)
+            {
+                struct scm_timestamping tss;
+                memcpy(&tss, CMSG_DATA(c), sizeof tss);
+                return tss.ts[0].tv_sec * 1000000000ULL + tss.ts[0].tv_nsec;
+            }
+        }
+        return 0;
+    }
+
+    /**
+     * @brief a connected session socket with SO_TIMESTAMPING enabled
+     */
+    class TimestampedSocket
+    {
+    public:
+        // sends whose TX timestamp has not been read yet
+        static constexpr size_t MAX_PENDING = 4096;
+
+        /**
+         * @param _sock connected TCP socket
+         * @param _stats if set, intervals are recorded in SocketRx and SocketTx
+         */
+        explicit TimestampedSocket(int _sock, latency::Stats *_stats = nullptr)
+            : sock(_sock), stats(_stats)
+        {
+            int flags = FLAGS;
+            if (setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof flags) < 0)
+                perror("setsockopt SO_TIMESTAMPING");
+            else
+                enabled = true;
+        }
+
+        int fd() const noexcept { return sock; }
+        bool timestamping() const noexcept { return enabled; }
+
+        /**
+         * @brief when the kernel received the message last returned by recv_message
+         */
+        uint64_t rx_kernel_ns() const noexcept { return rx_kernel; }
+
+        /**
+         * @brief when recv_message returned it
+         */
+        uint64_t rx_user_ns() const noexcept { return rx_user; }
+
+        /**
+         * @brief sends not matched to a TX timestamp yet
+         */
+        size_t pending() const noexcept { return head - tail; }
+
+        /**
+         * @brief sends dropped from tracking because poll_tx() was not called often enough
+         */
+        uint64_t lost() const noexcept { return n_lost; }
+
+        auto send_message(const char *msg, int sz, bool add_cred) noexcept
+        {
+            auto user_ns = now_ns();
+            auto bytes = sockhelp::send_message(sock, msg, sz, add_cred);
+            bytes_sent += bytes;
+            if (!enabled)
+                return bytes;
+            if (head - tail == MAX_PENDING)
+            {
+                ++tail;
+                ++n_lost;
+            }
+            uint16_t template_id;
+            memcpy(&template_id, msg + sockhelp::SOFH_HEADER_SIZE + 2, sizeof template_id);
+            auto &p = sends[head++ % MAX_PENDING];
+            p.last_byte = bytes_sent - 1;
+            p.stamp.SeqNum = seq_num_of(msg, template_id);
+            p.stamp.TemplateID = template_id;
+            p.stamp.user_ns = user_ns;
+            p.stamp.kernel_ns = 0;
+            return bytes;
+        }
+
+        std::optional<sockhelp::cme_msg_header_t> recv_message(char *msg_buf, bool block) noexcept
+        {
+            if (enabled)
+            {
+                // the timestamp of the segment holding the start of the message
+                char c;
+                char control[256];
+                struct iovec iov = {&c, 1};
+                struct msghdr mh;
+                memset(&mh, 0, sizeof mh);
+                mh.msg_iov = &iov;
+                mh.msg_iovlen = 1;
+                mh.msg_control = control;
+                mh.msg_controllen = sizeof control;
+                if (recvmsg(sock, &mh, MSG_PEEK | (block ? 0 : MSG_DONTWAIT)) <= 0)
+                    return {};
+                rx_kernel = software_stamp(mh);
+            }
+            auto header = sockhelp::recv_message(sock, msg_buf, block);
+            if (header)
+            {
+                rx_user = now_ns();
+                if (stats && rx_kernel)
+                    stats->record_ns(latency::SocketRx, rx_user - rx_kernel);
+            }
+            return header;
+        }
+
+        /**
+         * @brief read TX timestamps from the error queue, never blocks
+         *
+         * @param on_tx called with a tx_stamp_t for every send that left
+         * @return number of sends reported
+         */
+        template <typename F>
+        size_t poll_tx(F &&on_tx) noexcept
+        {
+            size_t n = 0;
+            if (!enabled)
+                return n;
+            for (;;)
+            {
+                char control[512];
+                struct msghdr mh;
+                memset(&mh, 0, sizeof mh);
+                mh.msg_control = control;
+                mh.msg_controllen = sizeof control;
+                if (recvmsg(sock, &mh, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+                {
+                    if (errno != EAGAIN && errno != EWOULDBLOCK)
+                        perror("recvmsg MSG_ERRQUEUE");
+                    return n;
+                }
+                uint64_t kernel_ns = 0;
+                uint32_t key = 0;
+                bool have_key = false;
+                for (auto c = CMSG_FIRSTHDR(&mh); c; c = CMSG_NXTHDR(&mh, c))
+                {
+                    if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SO_TIMESTAMPING)
+                    {
+                        struct scm_timestamping tss;
+                        memcpy(&tss, CMSG_DATA(c), sizeof tss);
+                        kernel_ns = tss.ts[0].tv_sec * 1000000000ULL + tss.ts[0].tv_nsec;
+                    }
+                    else if ((c->cmsg_level == SOL_IP && c->cmsg_type == IP_RECVERR) ||
+                             (c->cmsg_level == SOL_IPV6 && c->cmsg_type == IPV6_RECVERR))
+                    {
+                        struct sock_extended_err err;
+                        memcpy(&err, CMSG_DATA(c), sizeof err);
+                        if (err.ee_origin == SO_EE_ORIGIN_TIMESTAMPING && err.ee_info == SCM_TSTAMP_SND)
+                        {
+                            key = err.ee_data;
+                            have_key = true;
+                        }
+                    }
+                }
+                if (!have_key || !kernel_ns)
+                    continue;
+                // every send up to the stamped byte left with it, sends that
+                // were coalesced into one segment share its timestamp
+                while (tail != head && int32_t(key - sends[tail % MAX_PENDING].last_byte) >= 0)
+                {
+                    auto &s = sends[tail++ % MAX_PENDING].stamp;
+                    s.kernel_ns = kernel_ns;
+                    if (stats)
+                        stats->record_ns(latency::SocketTx, kernel_ns - s.user_ns);
+                    on_tx(s);
+                    ++n;
+                }
+            }
+        }
+
+    private:
+        struct pending_t
+        {
+            uint32_t last_byte; // OPT_ID key of the send, the offset of its last byte
+            tx_stamp_t stamp;
+        };
+
+        int sock;
+        latency::Stats *stats;
+        bool enabled = false;
+        uint64_t rx_kernel = 0;
+        uint64_t rx_user = 0;
+        uint32_t bytes_sent = 0;
+        uint64_t head = 0;
+        uint64_t tail = 0;
+        uint64_t n_lost = 0;
+        pending_t sends[MAX_PENDING];
+    };
+
+    /**
+     * @brief transport policy over a TimestampedSocket
+     */
+    struct TimestampingTransport
+    {
+        using handle_t = TimestampedSocket *;
+
+        static auto send_message(handle_t s, const char *msg, int sz, bool add_cred = false) noexcept
+        {
+            return s->send_message(msg, sz, add_cred);
+        }
+
+        static std::optional<sockhelp::cme_msg_header_t>
+        recv_message(handle_t s, char *msg_buf, bool block = true) noexcept
+        {
+            return s->recv_message(msg_buf, block);
+        }
+    };
+}
@@ -0,0 +1,100 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+/***************************************************************
+ *
+ * Convert a columnar audit file (audit_columnar.hpp) to CSV
+ *
+ * build (from the directory containing ilink/ and the SBE headers):
+ *   g++ -std=c++17 -O2 -I. ilink/tools/ilink_audit_csv.cpp -o ilink_audit_csv
+ *
+ * run:
+ *   ./ilink_audit_csv [-n] audit_file [csv_file]
+ *     -n  no header line
+ *   writes to stdout without csv_file
+ *
+ * *************************************************************/
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "ilink/audit_columnar.hpp"
+
+int main(int argc, char **argv)
+{
+    bool header = true;
+    int c;
+    while ((c = getopt(argc, argv, "n")) != -1)
+    {
+        switch (c)
+        {
+        case 'n':
+            header = false;
+            break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-n] audit_file [csv_file]" << std::endl;
+            return 1;
+        }
+    }
+    if (optind >= argc)
+    {
+        std::cerr << "usage: " << argv[0] << " [-n] audit_file [csv_file]" << std::endl;
+        return 1;
+    }
+
+    m2::ilink::columnar::Reader reader(argv[optind]);
+    if (!reader.ok())
+        return 1;
+
+    FILE *out = stdout;
+    if (optind + 1 < argc)
+    {
+        out = fopen(argv[optind + 1], "w");
+        if (!out)
+        {
+            perror("fopen");
+            return 1;
+        }
+    }
+    auto n = reader.to_csv(out, header);
+    if (out != stdout)
+        fclose(out);
+    std::cerr << "records: " << n << std::endl;
+    return 0;
+}
@@ -0,0 +1,220 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+/***************************************************************
+ *
+ * Failover against the mock gateway, see failover.hpp
+ *
+ * Starts mock::Gateway in process with a primary and a backup port,
+ * dropping every connection after drop_after client messages, and
+ * sends orders through failover::Failover. Each dropped connection
+ * is replaced by the standby with one Establish503. Orders sent on a
+ * dropped connection fail without aborting and are sent again after
+ * the failover. Prints the time of every failover and checks that
+ * every order was acknowledged.
+ *
+ * build (from the directory containing ilink/ and the SBE headers):
+ *   g++ -std=c++20 -O2 -I. ilink/tools/ilink_failover.cpp -lcryptopp -lpthread -o ilink_failover
+ *
+ * run:
+ *   ./ilink_failover [-p port] [-b backup_port] [-d drop_after] [-n orders]
+ *
+ * *************************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ilink/mock_gateway.hpp"
+#include "ilink/failover.hpp"
+
+using namespace m2::ilink;
+
+static const std::string SECRET_KEY = "dGhpc2lzYXNlY3JldGtleWZvcnRoZWJlbmNobWFyaw";
+
+struct AckCounter : NullCBIF
+{
+    std::vector<char> acked;
+    uint64_t acks = 0;
+
+    explicit AckCounter(uint64_t orders) : acked(orders) {}
+
+    void executionReport(const exec_report_param_t &param) override
+    {
+        if (param.ExecType != "0" || param.ClOrdID.compare(0, 2, "FO") != 0)
+            return;
+        auto n = strtoull(param.ClOrdID.c_str() + 2, nullptr, 10);
+        if (n < acked.size() && !acked[n])
+        {
+            acked[n] = 1;
+            ++acks;
+        }
+    }
+};
+
+struct run_t
+{
+    uint64_t orders = 1000;
+    uint64_t sent = 0;
+    uint64_t resent = 0;
+    uint64_t failover_ns = 0;
+    bool ok = false;
+};
+
+// orders sent between two turns of the event loop
+static constexpr uint64_t BURST = 16;
+
+static void send_order(failover::Sender &snd, int sock, uint64_t n)
+{
+    snd.send_new_order_single(sock, 4500.25, 1, 12345, sbe::SideReq::Buy, "FO" + std::to_string(n), 0, 0, 0,
+                              sbe::OrderTypeReq::Limit, sbe::TimeInForce::Day);
+}
+
+static coro::Task<void> drive(coro::EventLoop &loop, failover::Session &s, failover::Failover &fo,
+                              AckCounter &app, run_t &run)
+{
+    auto r = co_await fo.start();
+    if (!r)
+    {
+        std::cerr << "start failed: " << coro::status_name(r.status) << " " << r.Reason << std::endl;
+        loop.stop();
+        co_return;
+    }
+    auto &snd = s.sender();
+    uint64_t last_acks = 0;
+    uint64_t last_progress = coro::now_ns();
+    while (app.acks < run.orders)
+    {
+        if (s.socket() < 0)
+        {
+            r = co_await fo.fail_over();
+            if (!r)
+            {
+                std::cerr << "failover failed: " << coro::status_name(r.status) << " " << r.Reason << std::endl;
+                loop.stop();
+                co_return;
+            }
+            run.failover_ns += fo.last_failover_time();
+            std::cerr << "failover " << fo.failover_count() << " to port " << fo.active_endpoint().port
+                      << " FTI " << (snd.get_fault_tolerance_indicator() == sbe::FTI::Primary ? "primary" : "backup")
+                      << " in " << fo.last_failover_time() / 1000 << " us, NextSeqNo " << snd.get_next_seq_no()
+                      << std::endl;
+            // the session has read every reply of the lost connection,
+            // what is still not acknowledged never reached the gateway
+            for (uint64_t n = 0; n < run.sent; ++n)
+            {
+                if (!app.acked[n])
+                {
+                    send_order(snd, s.socket(), n);
+                    ++run.resent;
+                }
+            }
+        }
+        for (uint64_t i = 0; i < BURST && run.sent < run.orders; ++i)
+            send_order(snd, s.socket(), run.sent++);
+
+        if (app.acks != last_acks)
+        {
+            last_acks = app.acks;
+            last_progress = coro::now_ns();
+        }
+        else if (coro::now_ns() - last_progress > coro::SEC)
+        {
+            std::cerr << "no acknowledgement for 1 s" << std::endl;
+            break;
+        }
+        // the loop reads the replies and notices a lost connection
+        co_await loop.sleep(run.sent < run.orders ? 0 : coro::MS);
+    }
+    run.ok = app.acks == run.orders;
+    loop.stop();
+}
+
+int main(int argc, char **argv)
+{
+    mock::config_t cfg;
+    cfg.port = 9100;
+    cfg.backup_port = 9101;
+    cfg.secret_key = SECRET_KEY;
+    cfg.drop_after = 100;
+    run_t run;
+    int c;
+    while ((c = getopt(argc, argv, "p:b:d:n:")) != -1)
+    {
+        switch (c)
+        {
+        case 'p':
+            cfg.port = atoi(optarg);
+            break;
+        case 'b':
+            cfg.backup_port = atoi(optarg);
+            break;
+        case 'd':
+            cfg.drop_after = strtoull(optarg, nullptr, 10);
+            break;
+        case 'n':
+            run.orders = strtoull(optarg, nullptr, 10);
+            break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-p port] [-b backup_port] [-d drop_after] [-n orders]" << std::endl;
+            return 1;
+        }
+    }
+    mock::Gateway gateway(cfg);
+    gateway.start();
+
+    failover::Sender snd(10000, "ACCOUNT", "ACCESSKEYID0000000000", SECRET_KEY, "ABC", "001",
+                         "ilink_failover", "1.0", "m2", "001", "US,IL", 42);
+    AckCounter app(run.orders);
+    coro::EventLoop loop;
+    failover::Session s(loop, snd, &app);
+    failover::Failover fo(loop, s, {{"127.0.0.1", cfg.port}, {"127.0.0.1", cfg.backup_port}});
+    loop.spawn(drive(loop, s, fo, app, run));
+    loop.run();
+
+    std::cerr << "orders sent: " << run.sent << " acknowledged: " << app.acks << " resent: " << run.resent
+              << " failovers: " << fo.failover_count();
+    if (fo.failover_count())
+        std::cerr << " average: " << run.failover_ns / fo.failover_count() / 1000 << " us";
+    std::cerr << std::endl;
+    return run.ok ? 0 : 2;
+}
@@ -0,0 +1,80 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+/***************************************************************
+ *
+ * Print the latency histograms of a running session
+ *
+ * build:
+ *   g++ -std=c++17 -O2 -I. ilink/tools/ilink_latency.cpp -o ilink_latency
+ *
+ * run:
+ *   ./ilink_latency <SessionID> [interval seconds]
+ *
+ * *************************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "ilink/latency.hpp"
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <SessionID> [interval seconds]" << std::endl;
+        return 1;
+    }
+    auto stats = m2::ilink::latency::Stats::open(argv[1]);
+    if (!stats)
+    {
+        std::cerr << "no latency stats for session " << argv[1] << std::endl;
+        return 1;
+    }
+    int interval = argc > 2 ? atoi(argv[2]) : 0;
+    do
+    {
+        stats->print(std::cout);
+        if (interval)
+            sleep(interval);
+    } while (interval);
+    return 0;
+}
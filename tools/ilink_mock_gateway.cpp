@@ -0,0 +1,112 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+/***************************************************************
+ *
+ * Mock CME iLink3 gateway, see mock_gateway.hpp
+ *
+ * build (from the directory containing ilink/ and the SBE headers):
+ *   g++ -std=c++17 -O2 -I. ilink/tools/ilink_mock_gateway.cpp -lcryptopp -lpthread -o ilink_mock_gateway
+ *
+ * run:
+ *   ./ilink_mock_gateway -k secret_key [-p port] [-b backup_port] [-f fill_pct] [-g gap_every]
+ *                        [-d drop_after] [-F flood_count] [-v]
+ *
+ * *************************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "ilink/mock_gateway.hpp"
+
+int main(int argc, char **argv)
+{
+    m2::ilink::mock::config_t cfg;
+    int c;
+    while ((c = getopt(argc, argv, "k:p:b:f:g:d:F:v")) != -1)
+    {
+        switch (c)
+        {
+        case 'k':
+            cfg.secret_key = optarg;
+            break;
+        case 'p':
+            cfg.port = atoi(optarg);
+            break;
+        case 'b':
+            cfg.backup_port = atoi(optarg);
+            break;
+        case 'f':
+            cfg.fill_pct = atoi(optarg);
+            break;
+        case 'g':
+            cfg.gap_every = strtoul(optarg, nullptr, 10);
+            break;
+        case 'd':
+            cfg.drop_after = strtoull(optarg, nullptr, 10);
+            break;
+        case 'F':
+            cfg.flood = strtoull(optarg, nullptr, 10);
+            break;
+        case 'v':
+            cfg.debug = true;
+            break;
+        default:
+            std::cerr << "usage: " << argv[0]
+                      << " -k secret_key [-p port] [-b backup_port] [-f fill_pct] [-g gap_every] [-d drop_after] [-F flood_count] [-v]"
+                      << std::endl;
+            return 1;
+        }
+    }
+    if (cfg.secret_key.empty())
+    {
+        std::cerr << "secret key required (-k)" << std::endl;
+        return 1;
+    }
+
+    m2::ilink::mock::Gateway gateway(cfg);
+    gateway.start();
+    std::cerr << "mock gateway listening on 127.0.0.1:" << cfg.port << std::endl;
+    if (cfg.backup_port)
+        std::cerr << "backup gateway listening on 127.0.0.1:" << cfg.backup_port << std::endl;
+    pause();
+    return 0;
+}
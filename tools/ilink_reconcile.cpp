@@ -0,0 +1,863 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+/***************************************************************
+ *
+ * Offline reconciliation of outbound and inbound journals
+ *
+ * build (from the directory containing ilink/ and the SBE headers):
+ *   g++ -std=c++17 -O2 -I. ilink/tools/ilink_reconcile.cpp -lpthread -o ilink_reconcile
+ *
+ * run:
+ *   ./ilink_reconcile [-t threads] [-s shards] [-q] capture_file...
+ *     -t  worker threads, all cores by default
+ *     -s  shards the orders are split into, 8 per thread by default
+ *     -q  print the summary only
+ *
+ * Input is one or more capture files (capture.hpp), e.g. a journal
+ * written through capture::CapturingTransport, which holds both
+ * directions of a session, or separate outbound and inbound captures.
+ * Files are memory mapped.
+ *
+ * An order is followed through its OrderID once CME has assigned one,
+ * so a cancel or replace with a new ClOrdID (515/516 and the 531, 534,
+ * 535 or 536 answering it) stays with the order its 514 started.
+ *
+ * Pass 1 splits every file into chunks of records. Threads decode
+ * chunks in parallel into a small event for every order message and
+ * note the OrderID reported for each ClOrdID.
+ * Pass 2 gives every event the OrderID of its ClOrdID (a 514 does not
+ * carry one) and appends it to the shard of its OrderID, or of its
+ * ClOrdID while CME has not reported one.
+ * Pass 3 hands shards to threads. Each puts its events back in
+ * capture order (merged by timestamp across files), rebuilds the
+ * lifecycle of every order and reports:
+ *
+ *   no_ack                  NewOrderSingle514 without 522 or 523
+ *   duplicate_new           ClOrdID sent twice
+ *   duplicate_ack           a second 522 that is not a retransmission
+ *   unknown_order           report for a ClOrdID never sent
+ *                           (only when outbound messages are present)
+ *   ack_request_id_mismatch 522 OrderRequestID differs from the 514
+ *   duplicate_fill          SideTradeID seen twice, not a retransmission
+ *   unknown_trade           548/549 for a SideTradeID not seen
+ *   cum_qty_mismatch        CumQty differs from the sum of the fills
+ *   overfill                fills above OrderQty
+ *   report_after_done       fill or cancel after the order was done
+ *   cancel_unanswered       516 without 534 or 535
+ *   replace_unanswered      515 without 531 or 536
+ *
+ * Events take 88 bytes per order message, plus 32 per report for
+ * the OrderID of its ClOrdID.
+ *
+ * *************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "ilink_v8/NewOrderSingle514.h"
+#include "ilink_v8/OrderCancelReplaceRequest515.h"
+#include "ilink_v8/OrderCancelRequest516.h"
+#include "ilink_v8/ExecutionReportTradeSpread526.h"
+#include "ilink_v8/ExecutionReportTradeAddendumOutright548.h"
+#include "ilink_v8/ExecutionReportTradeAddendumSpread549.h"
+#include "ilink_v8/OrderCancelReject535.h"
+#include "ilink_v8/OrderCancelReplaceReject536.h"
+
+#include "ilink/capture.hpp"
+#include "ilink/exec_report.hpp"
+
+using namespace m2::ilink;
+
+namespace
+{
+    constexpr size_t CHUNK_RECORDS = 1 << 20;
+
+    enum Kind : uint8_t
+    {
+        New,
+        Replace,
+        Cancel,
+        Ack,
+        Reject,
+        Elimination,
+        Fill,
+        Modified,
+        Canceled,
+        CancelReject,
+        ReplaceReject,
+        Addendum
+    };
+
+    struct event_t
+    {
+        uint64_t timestamp;
+        uint64_t OrderID; // 0 while CME has not assigned one
+        uint64_t OrderRequestID;
+        uint64_t SideTradeID;
+        uint64_t OrigSideTradeID;
+        uint32_t SeqNum;
+        uint32_t OrderQty;
+        uint32_t LastQty;
+        uint32_t CumQty;
+        uint32_t LeavesQty;
+        Kind kind;
+        char ExecType;
+        bool PossRetransFlag;
+        char ClOrdID[20];
+    };
+
+    struct order_id_t
+    {
+        uint64_t OrderID;
+        char ClOrdID[20];
+    };
+
+    enum Anomaly
+    {
+        NoAck,
+        DuplicateNew,
+        DuplicateAck,
+        UnknownOrder,
+        AckRequestIDMismatch,
+        DuplicateFill,
+        UnknownTrade,
+        CumQtyMismatch,
+        Overfill,
+        ReportAfterDone,
+        CancelUnanswered,
+        ReplaceUnanswered,
+        ANOMALY_COUNT
+    };
+
+    const char *anomaly_name[ANOMALY_COUNT] = {
+        "no_ack",
+        "duplicate_new",
+        "duplicate_ack",
+        "unknown_order",
+        "ack_request_id_mismatch",
+        "duplicate_fill",
+        "unknown_trade",
+        "cum_qty_mismatch",
+        "overfill",
+        "report_after_done",
+        "cancel_unanswered",
+        "replace_unanswered"};
+
+    struct chunk_t
+    {
+        size_t file;
+        size_t begin; // byte offsets of the records in the file
+        size_t end;
+    };
+
+    std::string_view clordid(const char (&id)[20])
+    {
+        return std::string_view(id, strnlen(id, sizeof id));
+    }
+
+    size_t shard_of(const char (&id)[20], size_t shards)
+    {
+        uint64_t h = 14695981039346656037ULL; // FNV-1a
+        for (size_t i = 0; i < sizeof id && id[i]; ++i)
+        {
+            h ^= (uint8_t)id[i];
+            h *= 1099511628211ULL;
+        }
+        return h % shards;
+    }
+
+    size_t shard_of(uint64_t OrderID, size_t shards)
+    {
+        return ((OrderID * 0x9E3779B97F4A7C15ULL) >> 32) % shards;
+    }
+
+    /**
+     * @brief split a capture into chunks of CHUNK_RECORDS records
+     */
+    void split(const capture::Reader &reader, size_t file, std::vector<chunk_t> &chunks)
+    {
+        auto data = reader.data();
+        auto end = reader.size();
+        auto pos = sizeof(capture::file_header_t);
+        auto begin = pos;
+        size_t n = 0;
+        while (pos + sizeof(capture::record_header_t) <= end)
+        {
+            auto rh = reinterpret_cast<const capture::record_header_t *>(data + pos);
+            if (pos + sizeof(capture::record_header_t) + rh->length > end)
+                break;
+            pos += sizeof(capture::record_header_t) + capture::align8(rh->length);
+            if (++n == CHUNK_RECORDS)
+            {
+                chunks.push_back({file, begin, pos});
+                begin = pos;
+                n = 0;
+            }
+        }
+        if (n)
+            chunks.push_back({file, begin, pos});
+    }
+
+    template <typename M>
+    uint64_t order_id(M &msg)
+    {
+        auto id = msg.orderID();
+        return id == M::orderIDNullValue() ? 0 : id;
+    }
+
+    template <typename M>
+    void decode_request(M &msg, event_t &ev)
+    {
+        ev.SeqNum = msg.seqNum();
+        ev.OrderRequestID = msg.orderRequestID();
+        memcpy(ev.ClOrdID, msg.clOrdID(), sizeof ev.ClOrdID);
+    }
+
+    template <typename M>
+    void decode_reply(M &msg, event_t &ev)
+    {
+        ev.SeqNum = msg.seqNum();
+        ev.OrderID = order_id(msg);
+        ev.OrderRequestID = msg.orderRequestID();
+        ev.PossRetransFlag = msg.possRetransFlag();
+        memcpy(ev.ClOrdID, msg.clOrdID(), sizeof ev.ClOrdID);
+    }
+
+    template <typename M>
+    void decode_addendum(M &msg, event_t &ev)
+    {
+        ev.kind = Addendum;
+        ev.SeqNum = msg.seqNum();
+        ev.OrderID = order_id(msg);
+        ev.LastQty = msg.lastQty();
+        ev.SideTradeID = msg.sideTradeID();
+        ev.OrigSideTradeID = msg.origSideTradeID();
+        ev.ExecType = (char)msg.execType();
+        ev.PossRetransFlag = msg.possRetransFlag();
+        memcpy(ev.ClOrdID, msg.clOrdID(), sizeof ev.ClOrdID);
+    }
+
+    /**
+     * @brief event for one captured order message
+     * @return false for session and other messages
+     */
+    bool decode(const capture::record_t &rec, event_t &ev)
+    {
+        auto header = rec.header();
+        auto body = const_cast<char *>(rec.body());
+        memset(&ev, 0, sizeof ev);
+        ev.timestamp = rec.timestamp;
+
+        if (rec.direction == capture::ToCME)
+        {
+            switch (header.TemplateID)
+            {
+            case sbe::NewOrderSingle514::sbeTemplateId():
+            {
+                sbe::NewOrderSingle514 newOrderSingle;
+                auto msg = newOrderSingle.wrapForDecode(body, 0, header.BlockLength, header.Version, header.MsgSize);
+                decode_request(msg, ev);
+                ev.kind = New;
+                ev.OrderQty = msg.orderQty();
+                return true;
+            }
+            case sbe::OrderCancelReplaceRequest515::sbeTemplateId():
+            {
+                sbe::OrderCancelReplaceRequest515 cancelReplace;
+                auto msg = cancelReplace.wrapForDecode(body, 0, header.BlockLength, header.Version, header.MsgSize);
+                decode_request(msg, ev);
+                ev.kind = Replace;
+                ev.OrderID = order_id(msg);
+                ev.OrderQty = msg.orderQty();
+                return true;
+            }
+            case sbe::OrderCancelRequest516::sbeTemplateId():
+            {
+                sbe::OrderCancelRequest516 cancel;
+                auto msg = cancel.wrapForDecode(body, 0, header.BlockLength, header.Version, header.MsgSize);
+                decode_request(msg, ev);
+                ev.kind = Cancel;
+                ev.OrderID = order_id(msg);
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+
+        switch (header.TemplateID)
+        {
+        case sbe::ExecutionReportTradeSpread526::sbeTemplateId():
+        {
+            sbe::ExecutionReportTradeSpread526 executionReportTradeSpread;
+            auto msg = executionReportTradeSpread.wrapForDecode(body, 0, header.BlockLength, header.Version, header.MsgSize);
+            decode_reply(msg, ev);
+            ev.kind = Fill;
+            ev.OrderQty = msg.orderQty();
+            ev.LastQty = msg.lastQty();
+            ev.CumQty = msg.cumQty();
+            ev.LeavesQty = msg.leavesQty();
+            ev.SideTradeID = msg.sideTradeID();
+            return true;
+        }
+        case sbe::ExecutionReportTradeAddendumOutright548::sbeTemplateId():
+        {
+            sbe::ExecutionReportTradeAddendumOutright548 executionReportTradeAddendumOutright;
+            auto msg = executionReportTradeAddendumOutright.wrapForDecode(body, 0, header.BlockLength, header.Version, header.MsgSize);
+            decode_addendum(msg, ev);
+            return true;
+        }
+        case sbe::ExecutionReportTradeAddendumSpread549::sbeTemplateId():
+        {
+            sbe::ExecutionReportTradeAddendumSpread549 executionReportTradeAddendumSpread;
+            auto msg = executionReportTradeAddendumSpread.wrapForDecode(body, 0, header.BlockLength, header.Version, header.MsgSize);
+            decode_addendum(msg, ev);
+            return true;
+        }
+        case sbe::OrderCancelReject535::sbeTemplateId():
+        {
+            sbe::OrderCancelReject535 orderCancelReject;
+            auto msg = orderCancelReject.wrapForDecode(body, 0, header.BlockLength, header.Version, header.MsgSize);
+            decode_reply(msg, ev);
+            ev.kind = CancelReject;
+            return true;
+        }
+        case sbe::OrderCancelReplaceReject536::sbeTemplateId():
+        {
+            sbe::OrderCancelReplaceReject536 orderCancelReplaceReject;
+            auto msg = orderCancelReplaceReject.wrapForDecode(body, 0, header.BlockLength, header.Version, header.MsgSize);
+            decode_reply(msg, ev);
+            ev.kind = ReplaceReject;
+            return true;
+        }
+        }
+
+        exec_report_t er;
+        if (!decode_exec_report(&header, body, er))
+            return false;
+        switch (er.hot.templateId)
+        {
+        case sbe::ExecutionReportNew522::sbeTemplateId():
+            ev.kind = Ack;
+            break;
+        case sbe::ExecutionReportReject523::sbeTemplateId():
+            ev.kind = Reject;
+            break;
+        case sbe::ExecutionReportElimination524::sbeTemplateId():
+            ev.kind = Elimination;
+            break;
+        case sbe::ExecutionReportTradeOutright525::sbeTemplateId():
+            ev.kind = Fill;
+            break;
+        case sbe::ExecutionReportModify531::sbeTemplateId():
+            ev.kind = Modified;
+            break;
+        case sbe::ExecutionReportCancel534::sbeTemplateId():
+            ev.kind = Canceled;
+            break;
+        default:
+            return false; // status replies
+        }
+        ev.SeqNum = er.hot.SeqNum;
+        ev.OrderID = er.hot.OrderID;
+        ev.OrderRequestID = er.hot.OrderRequestID;
+        ev.OrderQty = er.cold.OrderQty;
+        ev.LastQty = er.hot.LastQty;
+        ev.CumQty = er.hot.CumQty;
+        ev.LeavesQty = er.hot.LeavesQty;
+        ev.SideTradeID = er.cold.SideTradeID;
+        ev.PossRetransFlag = er.hot.PossRetransFlag;
+        memcpy(ev.ClOrdID, er.cold.ClOrdID, sizeof ev.ClOrdID);
+        return true;
+    }
+
+    struct order_t
+    {
+        uint64_t OrderRequestID = 0;
+        uint32_t OrderQty = 0;
+        uint32_t filled = 0;
+        uint32_t news = 0;
+        uint32_t acks = 0;
+        uint32_t cancels = 0;  // outstanding
+        uint32_t replaces = 0; // outstanding
+        bool answered = false;
+        bool done = false;
+        bool unknown_reported = false;
+        bool qty_reported = false;
+        bool addenda = false;
+        std::vector<std::pair<uint64_t, uint32_t>> trades; // SideTradeID, LastQty
+    };
+
+    struct shard_result_t
+    {
+        uint64_t orders = 0;
+        uint64_t events = 0;
+        uint64_t counts[ANOMALY_COUNT] = {};
+        std::string report;
+    };
+
+    class Lifecycle
+    {
+    public:
+        Lifecycle(shard_result_t &_result, bool _have_outbound, bool _quiet)
+            : result(_result), have_outbound(_have_outbound), quiet(_quiet) {}
+
+        void on_event(const event_t &ev)
+        {
+            ++result.events;
+            auto &o = order_of(ev);
+            bool inbound = ev.kind >= Ack;
+            if (inbound && !o.news && have_outbound && !o.unknown_reported)
+            {
+                o.unknown_reported = true;
+                report(UnknownOrder, ev);
+            }
+
+            switch (ev.kind)
+            {
+            case New:
+                if (o.news++)
+                    report(DuplicateNew, ev);
+                o.OrderRequestID = ev.OrderRequestID;
+                o.OrderQty = ev.OrderQty;
+                break;
+            case Replace:
+                ++o.replaces;
+                break;
+            case Cancel:
+                ++o.cancels;
+                break;
+            case Ack:
+                if (o.acks++ && !ev.PossRetransFlag)
+                    report(DuplicateAck, ev);
+                if (o.news && ev.OrderRequestID != o.OrderRequestID)
+                    report(AckRequestIDMismatch, ev, "expected OrderRequestID=" + std::to_string(o.OrderRequestID));
+                if (!o.news)
+                    o.OrderQty = ev.OrderQty;
+                o.answered = true;
+                break;
+            case Reject:
+                o.answered = true;
+                o.done = true;
+                break;
+            case Elimination:
+                o.done = true;
+                break;
+            case Fill:
+                on_fill(o, ev);
+                break;
+            case Modified:
+                if (o.replaces)
+                    --o.replaces;
+                o.OrderQty = ev.OrderQty;
+                break;
+            case Canceled:
+                if (o.cancels)
+                    --o.cancels;
+                if (o.done && !ev.PossRetransFlag)
+                    report(ReportAfterDone, ev);
+                o.done = true;
+                break;
+            case CancelReject:
+                if (o.cancels)
+                    --o.cancels;
+                break;
+            case ReplaceReject:
+                if (o.replaces)
+                    --o.replaces;
+                break;
+            case Addendum:
+                on_addendum(o, ev);
+                break;
+            }
+        }
+
+        /**
+         * @brief report orders whose requests were never answered
+         */
+        void finish()
+        {
+            result.orders = orders.size();
+            for (auto &[id, o] : orders)
+            {
+                if (o.news && !o.answered)
+                    report(NoAck, id);
+                if (o.cancels)
+                    report(CancelUnanswered, id);
+                if (o.replaces)
+                    report(ReplaceUnanswered, id);
+            }
+        }
+
+    private:
+        /**
+         * @brief order of an event, by OrderID once known so that a new
+         * ClOrdID of a cancel or replace finds the original order
+         */
+        order_t &order_of(const event_t &ev)
+        {
+            if (ev.OrderID)
+            {
+                auto it = by_order_id.find(ev.OrderID);
+                if (it != by_order_id.end())
+                    return *it->second;
+            }
+            auto &o = orders[clordid(ev.ClOrdID)];
+            if (ev.OrderID)
+                by_order_id.emplace(ev.OrderID, &o);
+            return o;
+        }
+
+        void on_fill(order_t &o, const event_t &ev)
+        {
+            for (auto &t : o.trades)
+            {
+                if (t.first == ev.SideTradeID)
+                {
+                    if (!ev.PossRetransFlag)
+                        report(DuplicateFill, ev, "SideTradeID=" + std::to_string(ev.SideTradeID));
+                    return;
+                }
+            }
+            if (o.done && !ev.PossRetransFlag)
+                report(ReportAfterDone, ev);
+
+            o.trades.emplace_back(ev.SideTradeID, ev.LastQty);
+            o.filled += ev.LastQty;
+            if (!o.addenda && !o.qty_reported && ev.CumQty != o.filled)
+            {
+                o.qty_reported = true;
+                report(CumQtyMismatch, ev, "CumQty=" + std::to_string(ev.CumQty) + " fills=" + std::to_string(o.filled));
+            }
+            if (o.OrderQty && o.filled > o.OrderQty)
+                report(Overfill, ev, "OrderQty=" + std::to_string(o.OrderQty) + " fills=" + std::to_string(o.filled));
+            if (!ev.LeavesQty)
+                o.done = true;
+        }
+
+        void on_addendum(order_t &o, const event_t &ev)
+        {
+            o.addenda = true;
+            for (auto &t : o.trades)
+            {
+                if (t.first != ev.OrigSideTradeID)
+                    continue;
+                o.filled -= t.second;
+                t.second = 0;
+                if (ev.ExecType == 'G')
+                {
+                    o.filled += ev.LastQty;
+                    if (ev.SideTradeID)
+                        o.trades.emplace_back(ev.SideTradeID, ev.LastQty);
+                    else
+                        t.second = ev.LastQty;
+                }
+                return;
+            }
+            report(UnknownTrade, ev, "OrigSideTradeID=" + std::to_string(ev.OrigSideTradeID));
+        }
+
+        void report(Anomaly a, const event_t &ev, const std::string &detail = {})
+        {
+            ++result.counts[a];
+            if (quiet)
+                return;
+            result.report += anomaly_name[a];
+            result.report += " ClOrdID=";
+            result.report += clordid(ev.ClOrdID);
+            result.report += " SeqNum=" + std::to_string(ev.SeqNum);
+            if (ev.PossRetransFlag)
+                result.report += " PossRetrans";
+            if (!detail.empty())
+                result.report += " " + detail;
+            result.report += "\n";
+        }
+
+        void report(Anomaly a, std::string_view id)
+        {
+            ++result.counts[a];
+            if (quiet)
+                return;
+            result.report += anomaly_name[a];
+            result.report += " ClOrdID=";
+            result.report += id;
+            result.report += "\n";
+        }
+
+        shard_result_t &result;
+        bool have_outbound;
+        bool quiet;
+        std::unordered_map<std::string_view, order_t> orders;
+        std::unordered_map<uint64_t, order_t *> by_order_id;
+    };
+
+    /**
+     * @brief events of one shard in capture order, merged by timestamp across files
+     */
+    std::vector<event_t> gather(const std::vector<chunk_t> &chunks,
+                                const std::vector<std::vector<std::vector<event_t>>> &buckets,
+                                size_t shard, size_t files)
+    {
+        std::vector<std::vector<event_t>> per_file(files);
+        for (size_t c = 0; c < chunks.size(); ++c)
+        {
+            auto &b = buckets[c][shard];
+            auto &f = per_file[chunks[c].file];
+            f.insert(f.end(), b.begin(), b.end());
+        }
+        if (files == 1)
+            return std::move(per_file[0]);
+
+        size_t total = 0;
+        for (auto &f : per_file)
+            total += f.size();
+        std::vector<event_t> merged;
+        merged.reserve(total);
+        std::vector<size_t> head(files, 0);
+        while (merged.size() < total)
+        {
+            size_t best = files;
+            for (size_t f = 0; f < files; ++f)
+            {
+                if (head[f] < per_file[f].size() &&
+                    (best == files || per_file[f][head[f]].timestamp < per_file[best][head[best]].timestamp))
+                    best = f;
+            }
+            merged.push_back(per_file[best][head[best]++]);
+        }
+        return merged;
+    }
+
+    template <typename F>
+    void parallel(size_t threads, size_t jobs, F &&f)
+    {
+        std::atomic<size_t> next{0};
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t)
+            workers.emplace_back([&]
+                                 {
+                                     for (size_t j; (j = next.fetch_add(1)) < jobs;)
+                                         f(j);
+                                 });
+        for (auto &w : workers)
+            w.join();
+    }
+
+    void usage(const char *prog)
+    {
+        std::cerr << "usage: " << prog << " [-t threads] [-s shards] [-q] capture_file..." << std::endl;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    size_t threads = std::thread::hardware_concurrency();
+    size_t shards = 0;
+    bool quiet = false;
+    int c;
+    while ((c = getopt(argc, argv, "t:s:q")) != -1)
+    {
+        switch (c)
+        {
+        case 't':
+            threads = atoi(optarg);
+            break;
+        case 's':
+            shards = atoi(optarg);
+            break;
+        case 'q':
+            quiet = true;
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc)
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    if (!threads)
+        threads = 1;
+    if (!shards)
+        shards = threads * 8;
+
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<std::unique_ptr<capture::Reader>> readers;
+    std::vector<chunk_t> chunks;
+    for (int i = optind; i < argc; ++i)
+    {
+        readers.emplace_back(new capture::Reader(argv[i]));
+        if (!readers.back()->ok())
+            return 1;
+        split(*readers.back(), readers.size() - 1, chunks);
+    }
+
+    //
+    // pass 1: decode chunks into events, note the OrderID of every ClOrdID
+    //
+    std::vector<std::vector<event_t>> decoded(chunks.size());
+    std::vector<std::vector<std::vector<order_id_t>>> ids(chunks.size(), std::vector<std::vector<order_id_t>>(shards));
+    std::atomic<uint64_t> messages{0};
+    std::atomic<bool> have_outbound{false};
+    parallel(threads, chunks.size(), [&](size_t j)
+             {
+                 auto &chunk = chunks[j];
+                 auto data = readers[chunk.file]->data();
+                 auto &out = decoded[j];
+                 out.reserve(CHUNK_RECORDS);
+                 uint64_t n = 0;
+                 bool outbound = false;
+                 event_t ev;
+                 for (auto pos = chunk.begin; pos < chunk.end; ++n)
+                 {
+                     auto rh = reinterpret_cast<const capture::record_header_t *>(data + pos);
+                     capture::record_t rec;
+                     rec.timestamp = rh->timestamp;
+                     rec.direction = capture::Direction(rh->direction);
+                     rec.length = rh->length;
+                     rec.frame = data + pos + sizeof(capture::record_header_t);
+                     pos += sizeof(capture::record_header_t) + capture::align8(rh->length);
+
+                     if (!decode(rec, ev))
+                         continue;
+                     outbound |= rec.direction == capture::ToCME;
+                     if (ev.OrderID && ev.kind >= Ack)
+                     {
+                         order_id_t id;
+                         id.OrderID = ev.OrderID;
+                         memcpy(id.ClOrdID, ev.ClOrdID, sizeof id.ClOrdID);
+                         ids[j][shard_of(ev.ClOrdID, shards)].push_back(id);
+                     }
+                     out.push_back(ev);
+                 }
+                 messages += n;
+                 if (outbound)
+                     have_outbound = true;
+             });
+
+    //
+    // pass 2: events to the shard of their order
+    //
+    std::vector<std::unordered_map<std::string_view, uint64_t>> order_ids(shards);
+    parallel(threads, shards, [&](size_t s)
+             {
+                 for (auto &c : ids)
+                     for (auto &id : c[s])
+                         order_ids[s].emplace(clordid(id.ClOrdID), id.OrderID);
+             });
+    std::vector<std::vector<std::vector<event_t>>> buckets(chunks.size(), std::vector<std::vector<event_t>>(shards));
+    parallel(threads, chunks.size(), [&](size_t j)
+             {
+                 auto &out = buckets[j];
+                 for (auto &b : out)
+                     b.reserve(decoded[j].size() / shards);
+                 for (auto &ev : decoded[j])
+                 {
+                     if (!ev.OrderID)
+                     {
+                         auto &m = order_ids[shard_of(ev.ClOrdID, shards)];
+                         auto it = m.find(clordid(ev.ClOrdID));
+                         if (it != m.end())
+                             ev.OrderID = it->second;
+                     }
+                     out[ev.OrderID ? shard_of(ev.OrderID, shards) : shard_of(ev.ClOrdID, shards)].push_back(ev);
+                 }
+                 std::vector<event_t>().swap(decoded[j]);
+             });
+    order_ids.clear();
+    ids.clear();
+    auto t1 = std::chrono::steady_clock::now();
+
+    //
+    // pass 3: rebuild order lifecycles per shard
+    //
+    std::vector<shard_result_t> results(shards);
+    parallel(threads, shards, [&](size_t s)
+             {
+                 auto events = gather(chunks, buckets, s, readers.size());
+                 for (auto &b : buckets)
+                     std::vector<event_t>().swap(b[s]);
+                 Lifecycle lifecycle(results[s], have_outbound, quiet);
+                 for (auto &ev : events)
+                     lifecycle.on_event(ev);
+                 lifecycle.finish();
+             });
+    auto t2 = std::chrono::steady_clock::now();
+
+    uint64_t orders = 0, events = 0, counts[ANOMALY_COUNT] = {};
+    for (auto &r : results)
+    {
+        std::cout << r.report;
+        orders += r.orders;
+        events += r.events;
+        for (int a = 0; a < ANOMALY_COUNT; ++a)
+            counts[a] += r.counts[a];
+    }
+
+    auto secs = [](auto a, auto b)
+    { return std::chrono::duration<double>(b - a).count(); };
+    std::cerr << "messages: " << messages
+              << " order messages: " << events
+              << " orders: " << orders
+              << " decode: " << secs(t0, t1) << "s"
+              << " reconcile: " << secs(t1, t2) << "s"
+              << " messages/sec: " << uint64_t(messages / secs(t0, t2))
+              << std::endl;
+    uint64_t anomalies = 0;
+    for (int a = 0; a < ANOMALY_COUNT; ++a)
+    {
+        if (counts[a])
+            std::cerr << anomaly_name[a] << ": " << counts[a] << std::endl;
+        anomalies += counts[a];
+    }
+    return anomalies ? 2 : 0;
+}
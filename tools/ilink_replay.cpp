@@ -0,0 +1,99 @@
+/*
+
+THIS SOFTWARE IS OPEN SOURCE UNDER THE MIT LICENSE
+
+Copyright 2022 Vincent Maciejewski, Quant Enterprises & M2 Tech
+Contact:
+v@m2te.ch
+mayeski@gmail.com
+https://www.linkedin.com/in/vmayeski/
+http://m2te.ch/
+
+
+Permission is hereby granted, free of charge, to any person
+obtaining a copy of this software and associated documentation
+files (the "Software"), to deal in the Software without
+restriction, including without limitation the rights to use,
+copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following
+conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT
+HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR
+OTHER DEALINGS IN THE SOFTWARE.
+
+https://opensource.org/licenses/MIT
+
+*/
+
+
+
+/***************************************************************
+ *
+ * Replay a wire capture through framing and decode
+ *
+ * build (from the directory containing ilink/ and the SBE headers):
+ *   g++ -std=c++17 -O2 -I. ilink/tools/ilink_replay.cpp -lcryptopp -lpthread -o ilink_replay
+ *
+ * run:
+ *   ./ilink_replay [-p] [-l loops] capture_file
+ *     -p  keep the recorded pace instead of replaying as fast as possible
+ *
+ * To measure your own handlers link them in place of NullCBIF.
+ *
+ * *************************************************************/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <iostream>
+
+#include "ilink/replay.hpp"
+
+int main(int argc, char **argv)
+{
+    bool paced = false;
+    int loops = 1;
+    int c;
+    while ((c = getopt(argc, argv, "pl:")) != -1)
+    {
+        switch (c)
+        {
+        case 'p':
+            paced = true;
+            break;
+        case 'l':
+            loops = atoi(optarg);
+            break;
+        default:
+            std::cerr << "usage: " << argv[0] << " [-p] [-l loops] capture_file" << std::endl;
+            return 1;
+        }
+    }
+    if (optind >= argc)
+    {
+        std::cerr << "usage: " << argv[0] << " [-p] [-l loops] capture_file" << std::endl;
+        return 1;
+    }
+
+    m2::ilink::capture::Reader reader(argv[optind]);
+    if (!reader.ok())
+        return 1;
+
+    m2::ilink::NullCBIF cbif;
+    auto r = m2::ilink::replay::run(reader, &cbif, paced, loops);
+    std::cout << "messages: " << r.messages
+              << " seconds: " << r.seconds
+              << " messages/sec: " << uint64_t(r.messages_per_sec)
+              << std::endl;
+    return 0;
+}